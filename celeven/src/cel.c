@@ -3,6 +3,16 @@
 #include <stdio.h>
 #include <string.h>
 
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+#endif
+
 const char *cel_filename_from_path(const char *path) {
     const char *slash = strrchr(path, '/');
     return slash ? slash + 1 : path;
@@ -32,15 +42,111 @@ int celfs_get_current_dir(char *buffer, size_t size) {
 
 CELAPI int celfs_resolve_full_path(char *out, size_t out_size, const char *relative_path, const char *path) {
     snprintf(out, out_size, "%s/%s", path, relative_path);
-    FILE *f;
-    fopen_s(&f, out, "rb");
-    if (f)
+
+    // a stat is enough to test for existence, no need to open the file
+    struct stat file_stat;
+    return stat(out, &file_stat) == 0;
+}
+
+void celfs_get_exec_dir(char *out, size_t out_size) {
+}
+
+#if defined(_WIN32)
+
+bool celfs_view_open(CELfile_view *view, const char *path) {
+    *view       = (CELfile_view){0};
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) { return false; }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
     {
-        fclose(f);
-        return 1;
+        CloseHandle(file);
+        return false;
     }
-    return 0;
+
+    view->file = (uintptr_t) file;
+    view->size = (size_t) size.QuadPart;
+    return true;
 }
 
-void celfs_get_exec_dir(char *out, size_t out_size) {
+const void *celfs_view_map(CELfile_view *view) {
+    if (view->data || view->size == 0) { return view->data; }
+
+    HANDLE mapping = CreateFileMappingA((HANDLE) view->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) { return NULL; }
+
+    view->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view->data)
+    {
+        CloseHandle(mapping);
+        return NULL;
+    }
+
+    view->mapping = (uintptr_t) mapping;
+    return view->data;
+}
+
+void celfs_view_unmap(CELfile_view *view) {
+    if (view->mapping)
+    {
+        UnmapViewOfFile(view->data);
+        CloseHandle((HANDLE) view->mapping);
+    }
+    if (view->file) { CloseHandle((HANDLE) view->file); }
+    *view = (CELfile_view){0};
+}
+
+bool celfs_replace(const char *from, const char *to) {
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+#else
+
+bool celfs_view_open(CELfile_view *view, const char *path) {
+    *view  = (CELfile_view){0};
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return false; }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    // fd 0 is a valid descriptor, so store it offset by one to keep 0 meaning closed
+    view->file = (uintptr_t) fd + 1;
+    view->size = (size_t) file_stat.st_size;
+    return true;
+}
+
+const void *celfs_view_map(CELfile_view *view) {
+    if (view->data || view->size == 0) { return view->data; }
+
+    void *data = mmap(NULL, view->size, PROT_READ, MAP_PRIVATE, (int) (view->file - 1), 0);
+    if (data == MAP_FAILED) { return NULL; }
+
+    view->data = data;
+    return view->data;
+}
+
+void celfs_view_unmap(CELfile_view *view) {
+    // views without a file borrow their memory from someone else, see celpak_find
+    if (view->file)
+    {
+        if (view->data) { munmap((void *) view->data, view->size); }
+        close((int) (view->file - 1));
+    }
+    *view = (CELfile_view){0};
+}
+
+bool celfs_replace(const char *from, const char *to) {
+    return rename(from, to) == 0;
+}
+
+#endif// _WIN32
+
+size_t celfs_view_size(const CELfile_view *view) {
+    return view->size;
 }
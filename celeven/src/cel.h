@@ -5,14 +5,30 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#define CEL_ARENA_HUGE_PAGES (1u << 0)// back a virtual arena with 2 MiB pages where the os allows it
+
+// an arena either wraps a caller buffer, or reserves address space and commits it as the offset grows
 typedef struct CELarena CELarena;
 struct CELarena {
     unsigned char *buf;
-    size_t buf_len;
+    size_t buf_len;// committed bytes for a virtual arena
+    size_t prev_offset;
+    size_t curr_offset;
+    size_t reserve_len;// 0 when the arena wraps a caller buffer
+    size_t commit_granularity;
+    bool commit_populate;// explicit huge pages are faulted in as they are committed, so a short pool fails the commit
+};
+
+// a saved offset, ending the scope frees everything allocated in the arena since it began
+typedef struct CELarena_temp CELarena_temp;
+struct CELarena_temp {
+    CELarena *arena;
     size_t prev_offset;
     size_t curr_offset;
 };
 
+#define CEL_SCRATCH_ARENA_COUNT 2// per thread, enough to keep a callee's scratch apart from its caller's result arena
+
 typedef struct CELstack_header CELstack_header;
 struct CELstack_header {
     size_t padding;
@@ -37,9 +53,209 @@ struct CELpool {
     unsigned char *buf;
     size_t buf_len;
     size_t chunk_size;
+    size_t chunk_alignment;
+    size_t chunk_count;
+    size_t used_count;
+    size_t fresh_index;// chunks from here on were never handed out, they are bumped instead of sitting on the free list
     CELpool_free_node *head;
 };
 
+#define CEL_SLAB_PAGE_SIZE (64 * 1024)// pages are aligned to their size, so a chunk finds its page by masking
+#define CEL_SLAB_MAX_SIZE 4096
+#define CEL_SLAB_CLASS_COUNT 28// 16 byte steps up to 64, then four classes per power of two up to CEL_SLAB_MAX_SIZE
+
+// a page is a pool of one size class, it sits on its class's partial list while it has free chunks
+typedef struct CELslab_page CELslab_page;
+struct CELslab_page {
+    CELpool pool;
+    CELslab_page *prev;
+    CELslab_page *next;
+    uint32_t class_index;
+};
+
+typedef struct CELslab_class CELslab_class;
+struct CELslab_class {
+    size_t chunk_size;
+    size_t page_count;
+    size_t chunk_count;
+    size_t used_count;
+    CELslab_page *partial;
+};
+
+// not thread safe. pages come from the backing arena and are recycled between classes once empty, never returned
+typedef struct CELslab CELslab;
+struct CELslab {
+    CELarena *backing;
+    CELslab_class classes[CEL_SLAB_CLASS_COUNT];
+    CELslab_page *free_pages;
+    size_t page_count;
+};
+
+#define CEL_ATOMIC_POOL_MAGAZINE_SIZE 31// the count and the chunks fill two cache lines
+#define CEL_MAX_ATOMIC_POOL_THREAD_COUNT 128// live threads at once, a finished thread's slot is handed to the next one
+#define CEL_MAX_ATOMIC_POOL_COUNT 32
+
+// chunks a thread keeps for itself, refilled from and spilled to the shared list in batches.
+// aligned so neighbouring threads' magazines never share a cache line
+typedef struct CELatomic_pool_magazine CELatomic_pool_magazine;
+struct CEL_ALIGN(64) CELatomic_pool_magazine {
+    uint32_t count;
+    uint32_t chunks[CEL_ATOMIC_POOL_MAGAZINE_SIZE];
+};
+
+// a fixed size pool any thread can alloc from and free to without a lock. the shared free list is a treiber
+// stack whose head packs a generation tag above the chunk index, so a head that was popped and pushed back fails the cas.
+// the magazines make it 64 byte aligned, heap copies need arena_alloc_align or an aligned malloc
+typedef struct CELatomic_pool CELatomic_pool;
+struct CELatomic_pool {
+    unsigned char *buf;
+    size_t chunk_size;
+    uint32_t chunk_count;
+    unsigned char head_padding[64];
+    volatile int64_t head;// tag << 32 | chunk index
+    unsigned char tail_padding[64];
+    int32_t registry_index;// where atomic_pool_thread_fini finds it, -1 once finished
+    CELatomic_pool_magazine magazines[CEL_MAX_ATOMIC_POOL_THREAD_COUNT];
+};
+
+#define CEL_TLSF_SL_COUNT_LOG2 5
+#define CEL_TLSF_SL_COUNT (1 << CEL_TLSF_SL_COUNT_LOG2)
+#define CEL_TLSF_FL_COUNT 24// first level classes are powers of two, the last ends at 4 GiB on 64 bit
+
+// a block's header sits right before its payload, the free list links reuse the payload while it is free
+typedef struct CELtlsf_block CELtlsf_block;
+struct CELtlsf_block {
+    CELtlsf_block *prev_phys;
+    size_t size;// payload bytes, the low bit is set while the block is free
+    CELtlsf_block *next_free;
+    CELtlsf_block *prev_free;
+};
+
+// two level segregated fit: free blocks are binned by power of two and then by a linear split of it, two bitmaps
+// find a non empty bin, so alloc, free and resize run in constant time. neighbours are merged as they are freed
+typedef struct CELtlsf CELtlsf;
+struct CELtlsf {
+    unsigned char *buf;
+    size_t buf_len;
+    size_t used_len;// payload bytes handed out
+    size_t used_count;
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[CEL_TLSF_FL_COUNT];
+    CELtlsf_block *blocks[CEL_TLSF_FL_COUNT][CEL_TLSF_SL_COUNT];
+};
+
+#define CEL_HANDLE_INVALID_INDEX UINT32_MAX
+
+// a slot is live while its generation is odd, the free list is threaded through 'next_free' of free slots
+typedef struct CELhandle_slot CELhandle_slot;
+struct CELhandle_slot {
+    uint32_t generation;
+    uint32_t next_free;
+};
+
+typedef struct CELhandle_pool CELhandle_pool;
+struct CELhandle_pool {
+    CELhandle_slot *slots;
+    uint32_t capacity;
+    uint32_t count;// high water mark, slots [0, count) have been handed out at least once
+    uint32_t free_head;
+};
+
+// a read-only view of a whole file, mapped straight from the page cache instead of copied into memory we own
+typedef struct CELfile_view CELfile_view;
+struct CELfile_view {
+    const void *data;// NULL until mapped, and for empty files
+    size_t size;
+    uintptr_t file;
+    uintptr_t mapping;// the file mapping object on windows, unused elsewhere
+};
+
+#define CEL_PAK_MAGIC 0x4b415043u// "CPAK"
+#define CEL_PAK_VERSION 1
+#define CEL_PAK_ALIGNMENT 16
+
+// a pak is the header, the bucket table, the name table, then every file as a 16 byte aligned blob.
+// the table is open addressed on the fnv-1a hash of the '/' separated name, empty buckets hold a zero hash
+typedef struct CELpak_header CELpak_header;
+struct CELpak_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t bucket_count;// power of two
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+typedef struct CELpak_entry CELpak_entry;
+struct CELpak_entry {
+    uint64_t hash;
+    uint64_t offset;
+    uint64_t size;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+
+typedef struct CELpak CELpak;
+struct CELpak {
+    CELfile_view view;
+    const CELpak_header *header;
+    const CELpak_entry *buckets;
+    const char *names;
+};
+
+typedef int (*CELthread_fn)(void *data);
+
+// the thread struct is handed to the new thread, keep it alive until thread_join
+typedef struct CELthread CELthread;
+struct CELthread {
+    uintptr_t handle;
+    CELthread_fn fn;
+    void *data;
+};
+
+// storage for the platform primitive, sized for the largest one we support
+typedef struct CELmutex CELmutex;
+struct CELmutex {
+    union {
+        void *align;
+        unsigned char storage[64];
+    } opaque;
+};
+
+typedef struct CELcondition CELcondition;
+struct CELcondition {
+    union {
+        void *align;
+        unsigned char storage[64];
+    } opaque;
+};
+
+#define CEL_MAX_JOB_THREAD_COUNT 32
+
+typedef void (*CELjob_fn)(void *data);
+typedef void (*CELjob_range_fn)(uint32_t begin, uint32_t end, uint32_t thread_index, void *data);
+
+#define CEL_MAX_PROFILE_THREAD_COUNT 64
+
+// zones are compiled in unless CEL_PROFILE is defined to 0
+#ifndef CEL_PROFILE
+    #define CEL_PROFILE 1
+#endif
+
+#if CEL_PROFILE
+    #define CEL_PROFILE_BEGIN(name) profile_begin(name)
+    #define CEL_PROFILE_END() profile_end()
+#else
+    #define CEL_PROFILE_BEGIN(name) ((void) 0)
+    #define CEL_PROFILE_END() ((void) 0)
+#endif
+
+// every job spawned against a counter holds it up, job_wait returns once they all finished
+typedef struct CELjob_counter CELjob_counter;
+struct CELjob_counter {
+    volatile int32_t pending;
+};
+
 typedef struct CELmemory CELmemory;
 struct CELmemory {
     CELarena transient_arena;
@@ -54,6 +270,11 @@ struct CELconfig {
     uint32_t height;
     uint32_t render_width;
     uint32_t render_height;
+    uint32_t frames_in_flight;     // 0 picks the renderer default
+    uint32_t frame_lead;           // frames the cpu may record ahead of the gpu, 0 allows every frame in flight
+    uint32_t swapchain_image_count;// 0 lets the renderer pick
+    uint32_t worker_count;         // job worker threads besides the main thread, 0 uses one per remaining core
+    uint32_t headless_frames;      // > 0 renders that many frames offscreen with no window or swapchain, then exits
 };
 
 typedef struct CELgame CELgame;
@@ -74,9 +295,50 @@ struct CELgame {
     void *user_data;
 };
 
-CELAPI inline bool is_power_of_two(uintptr_t x) { return (x & (x - 1)) == 0; }
+Internal inline bool is_power_of_two(uintptr_t x) { return (x & (x - 1)) == 0; }
+
+// loads acquire, stores release, read-modify-writes and the fence are sequentially consistent.
+// add returns the new value
+#if defined(_MSC_VER)
+Internal inline int32_t cel_atomic_load_i32(volatile int32_t *p) { return _InterlockedOr((volatile long *) p, 0); }
+Internal inline void cel_atomic_store_i32(volatile int32_t *p, int32_t v) { _InterlockedExchange((volatile long *) p, v); }
+Internal inline int32_t cel_atomic_add_i32(volatile int32_t *p, int32_t v) { return _InterlockedExchangeAdd((volatile long *) p, v) + v; }
+Internal inline bool cel_atomic_cas_i32(volatile int32_t *p, int32_t expected, int32_t desired) { return _InterlockedCompareExchange((volatile long *) p, desired, expected) == expected; }
+Internal inline int64_t cel_atomic_load_i64(volatile int64_t *p) { return _InterlockedOr64((volatile long long *) p, 0); }
+Internal inline void cel_atomic_store_i64(volatile int64_t *p, int64_t v) { _InterlockedExchange64((volatile long long *) p, v); }
+Internal inline int64_t cel_atomic_add_i64(volatile int64_t *p, int64_t v) { return _InterlockedExchangeAdd64((volatile long long *) p, v) + v; }
+Internal inline bool cel_atomic_cas_i64(volatile int64_t *p, int64_t expected, int64_t desired) { return _InterlockedCompareExchange64((volatile long long *) p, desired, expected) == expected; }
+Internal inline void cel_atomic_fence() {
+    volatile long barrier = 0;
+    _InterlockedExchange(&barrier, 1);
+}
+    #if defined(_M_X64) || defined(_M_IX86)
+Internal inline void cel_cpu_pause() { _mm_pause(); }
+    #else
+Internal inline void cel_cpu_pause() { __yield(); }
+    #endif
+#else
+Internal inline int32_t cel_atomic_load_i32(volatile int32_t *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+Internal inline void cel_atomic_store_i32(volatile int32_t *p, int32_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+Internal inline int32_t cel_atomic_add_i32(volatile int32_t *p, int32_t v) { return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST); }
+Internal inline bool cel_atomic_cas_i32(volatile int32_t *p, int32_t expected, int32_t desired) { return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); }
+Internal inline int64_t cel_atomic_load_i64(volatile int64_t *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+Internal inline void cel_atomic_store_i64(volatile int64_t *p, int64_t v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+Internal inline int64_t cel_atomic_add_i64(volatile int64_t *p, int64_t v) { return __atomic_add_fetch(p, v, __ATOMIC_SEQ_CST); }
+Internal inline bool cel_atomic_cas_i64(volatile int64_t *p, int64_t expected, int64_t desired) { return __atomic_compare_exchange_n(p, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); }
+Internal inline void cel_atomic_fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+    #if defined(__x86_64__) || defined(__i386__)
+Internal inline void cel_cpu_pause() { __builtin_ia32_pause(); }
+    #elif defined(__aarch64__) || defined(__arm__)
+Internal inline void cel_cpu_pause() { __asm__ __volatile__("yield"); }
+    #else
+Internal inline void cel_cpu_pause() {}
+    #endif
+#endif
 
 CELAPI void arena_init(CELarena *a, void *backing_buffer, size_t backing_buffer_len);
+CELAPI bool arena_init_virtual(CELarena *a, size_t reserve_len, uint32_t flags);
+CELAPI void arena_fini(CELarena *a);// releases a virtual arena's range, a no-op over a caller buffer
 CELAPI void *arena_alloc(CELarena *a, size_t len);
 CELAPI void *arena_alloc_align(CELarena *a, size_t len, size_t align);
 CELAPI void *arena_resize(CELarena *a, void *oldmem, size_t osize, size_t nsize);
@@ -85,12 +347,27 @@ CELAPI void arena_free(CELarena *a, void *ptr);
 CELAPI void arena_free_all(CELarena *a);
 CELAPI void arena_debug_print(CELarena *a, const char *label);
 
+CELAPI CELarena_temp arena_temp_begin(CELarena *a);
+CELAPI void arena_temp_end(CELarena_temp temp);
+
+// scratch scopes are taken from the calling thread's arenas, skipping any the caller allocates its results in.
+// end them with arena_scratch_release in reverse order, and call arena_scratch_fini before the thread exits
+CELAPI CELarena_temp arena_scratch_get(CELarena *const *conflicts, uint32_t conflict_count);
+CELAPI void arena_scratch_release(CELarena_temp scratch);
+CELAPI void arena_scratch_fini();
+
 #define cel_arena_init(a, backing_buffer, backing_buffer_len) arena_init(a, backing_buffer, backing_buffer_len)
+#define cel_arena_init_virtual(a, reserve_len, flags) arena_init_virtual(a, reserve_len, flags)
+#define cel_arena_fini(a) arena_fini(a)
 #define cel_arena_alloc(a, len) arena_alloc(a, len)
 #define cel_arena_resize(a, old_mem, old_size, new_size) arena_resize(a, old_mem, old_size, new_size)
 #define cel_arena_free(a, ptr) arena_free(a, ptr)
 #define cel_arena_free_all(a) arena_free_all(a)
 #define cel_arena_dbg_print(a, label) arena_debug_print(a, label);
+#define cel_arena_temp_begin(a) arena_temp_begin(a)
+#define cel_arena_temp_end(temp) arena_temp_end(temp)
+#define cel_arena_scratch_get(conflicts, conflict_count) arena_scratch_get(conflicts, conflict_count)
+#define cel_arena_scratch_release(scratch) arena_scratch_release(scratch)
 
 CELAPI void stack_init(CELstack *s, void *backing_buffer, size_t backing_buffer_len);
 CELAPI void *stack_alloc(CELstack *s, size_t len);
@@ -117,6 +394,85 @@ CELAPI void pool_free(CELpool *p, void *ptr);
 CELAPI void pool_free_all(CELpool *p);
 CELAPI void pool_debug_print(CELpool *p, const char *label);
 
+// threads past CEL_MAX_ATOMIC_POOL_THREAD_COUNT skip the magazines and go straight to the shared list.
+// call atomic_pool_thread_fini before a thread exits, it flushes the thread's magazine in every live pool and gives
+// its slot back. a pool is finished once no thread uses it anymore
+CELAPI void atomic_pool_init(CELatomic_pool *p, void *backing_buffer, size_t backing_buffer_len, size_t chunk_size, size_t chunk_alignment);
+CELAPI void atomic_pool_fini(CELatomic_pool *p);
+CELAPI void *atomic_pool_alloc(CELatomic_pool *p);
+CELAPI void atomic_pool_free(CELatomic_pool *p, void *ptr);
+CELAPI void atomic_pool_flush(CELatomic_pool *p);
+CELAPI void atomic_pool_thread_fini();
+
+CELAPI void slab_init(CELslab *s, CELarena *backing);
+CELAPI void *slab_alloc(CELslab *s, size_t len);
+CELAPI void *slab_alloc_align(CELslab *s, size_t len, size_t align);
+CELAPI void *slab_resize(CELslab *s, void *oldmem, size_t osize, size_t nsize);
+CELAPI void slab_free(CELslab *s, void *ptr);
+CELAPI void slab_debug_print(CELslab *s, const char *label);
+
+#define cel_slab_init(s, backing) slab_init(s, backing)
+#define cel_slab_alloc(s, len) slab_alloc(s, len)
+#define cel_slab_resize(s, old_mem, old_size, new_size) slab_resize(s, old_mem, old_size, new_size)
+#define cel_slab_free(s, ptr) slab_free(s, ptr)
+#define cel_slab_dbg_print(s, label) slab_debug_print(s, label);
+
+// not thread safe. the region usually comes from the persistent arena, past the largest block size it is left unused
+CELAPI void tlsf_init(CELtlsf *t, void *backing_buffer, size_t backing_buffer_len);
+CELAPI void *tlsf_alloc(CELtlsf *t, size_t len);
+CELAPI void *tlsf_alloc_align(CELtlsf *t, size_t len, size_t align);
+CELAPI void *tlsf_resize(CELtlsf *t, void *oldmem, size_t osize, size_t nsize);
+CELAPI void tlsf_free(CELtlsf *t, void *ptr);
+CELAPI void tlsf_debug_print(CELtlsf *t, const char *label);
+
+#define cel_tlsf_init(t, backing_buffer, backing_buffer_len) tlsf_init(t, backing_buffer, backing_buffer_len)
+#define cel_tlsf_alloc(t, len) tlsf_alloc(t, len)
+#define cel_tlsf_resize(t, old_mem, old_size, new_size) tlsf_resize(t, old_mem, old_size, new_size)
+#define cel_tlsf_free(t, ptr) tlsf_free(t, ptr)
+#define cel_tlsf_dbg_print(t, label) tlsf_debug_print(t, label);
+
+CELAPI void handle_pool_init(CELhandle_pool *hp, CELhandle_slot *slots, uint32_t capacity);
+CELAPI bool handle_pool_alloc(CELhandle_pool *hp, uint32_t *idx, uint32_t *generation);
+CELAPI bool handle_pool_free(CELhandle_pool *hp, uint32_t idx, uint32_t generation);
+CELAPI bool handle_pool_valid(const CELhandle_pool *hp, uint32_t idx, uint32_t generation);
+CELAPI bool handle_pool_live(const CELhandle_pool *hp, uint32_t idx);
+
+CELAPI bool thread_create(CELthread *t, CELthread_fn fn, void *data);
+CELAPI int thread_join(CELthread *t);
+CELAPI void thread_yield();
+CELAPI void thread_sleep_ms(uint32_t ms);
+CELAPI uint32_t cpu_core_count();
+CELAPI uint64_t time_now_ns();// monotonic
+
+CELAPI void mutex_init(CELmutex *m);
+CELAPI void mutex_fini(CELmutex *m);
+CELAPI void mutex_lock(CELmutex *m);
+CELAPI void mutex_unlock(CELmutex *m);
+
+CELAPI void condition_init(CELcondition *c);
+CELAPI void condition_fini(CELcondition *c);
+CELAPI void condition_wait(CELcondition *c, CELmutex *m);
+CELAPI void condition_signal(CELcondition *c);
+CELAPI void condition_broadcast(CELcondition *c);
+
+// jobs can be spawned from the thread that called job_system_init and from inside other jobs.
+// thread index 0 is that thread, workers are 1..job_thread_count() - 1
+CELAPI bool job_system_init(uint32_t worker_count);
+CELAPI void job_system_fini();
+CELAPI void job_run(CELjob_fn fn, void *data, CELjob_counter *counter);
+CELAPI void job_wait(CELjob_counter *counter);
+CELAPI void job_parallel_for(uint32_t count, uint32_t grain, CELjob_range_fn fn, void *data);
+CELAPI uint32_t job_thread_count();
+CELAPI uint32_t job_thread_index();
+
+// zone names must outlive the profiler, string literals are the intended use.
+// each thread records into its own ring, so the oldest zones are overwritten once it wraps
+CELAPI void profile_begin(const char *name);
+CELAPI void profile_end();
+CELAPI void profile_thread_name(const char *name);
+// writes every zone still held in the rings as chrome trace json (chrome://tracing, perfetto)
+CELAPI bool profile_dump(const char *path);
+
 CELAPI bool application_init(CELgame *game);
 CELAPI bool application_run();
 
@@ -126,3 +482,16 @@ CELAPI int celfs_set_current_dir(const char *path);
 CELAPI int celfs_get_current_dir(char *buffer, size_t size);
 CELAPI int celfs_resolve_full_path(char *out, size_t out_size, const char *relative_path, const char *path);
 CELAPI void celfs_get_exec_dir(char *out, size_t out_size);
+CELAPI bool celfs_replace(const char *from, const char *to);// atomic, 'to' is either the old or the new file
+
+// the mapping stays valid until celfs_view_unmap, which also closes the file
+CELAPI bool celfs_view_open(CELfile_view *view, const char *path);
+CELAPI const void *celfs_view_map(CELfile_view *view);
+CELAPI size_t celfs_view_size(const CELfile_view *view);
+CELAPI void celfs_view_unmap(CELfile_view *view);
+
+CELAPI bool celpak_open(CELpak *pak, const char *path);
+CELAPI void celpak_close(CELpak *pak);
+CELAPI uint64_t celpak_hash(const char *name);
+// the view borrows from the pak, unmapping it is a no-op and it dies with celpak_close
+CELAPI bool celpak_find(const CELpak *pak, const char *name, CELfile_view *view);
@@ -4,30 +4,44 @@
 
 #include <GLFW/glfw3.h>
 
+#define CEL_PROFILE_TRACE_FILE "cel_trace.json"
+
 typedef struct CELfs_path CELfs_path;
 struct CELfs_path {
-    const char *engine_base_path;
-    const char *user_base_path;
+    char engine_base_path[FS_PATH_MAX];
+    char user_base_path[FS_PATH_MAX];
 };
 
 typedef struct CELapp_state CELapp_state;
 struct CELapp_state {
     CELgame *game_inst;
     CELfs_path paths;
+    CELpak pak;
     GLFWwindow *window;
 
     const char *title;
 
     uint32_t actual_width;
     uint32_t actual_height;
+    bool minimized;
+
+    CELvk_present_mode present_mode;// requested, the surface may fall back to another
 };
 
 GlobalVariable bool is_initialized = false;
 GlobalVariable CELapp_state state  = {0};
+GlobalVariable CELmutex log_mutex;
+
+Internal bool application_run_headless(uint32_t frame_count);
+Internal void application_fini();
+Internal void application_resize(uint32_t width, uint32_t height);
 
 Internal void error_callback(int error, const char *description);
 Internal void window_close_callback(GLFWwindow *window);
-Internal void window_size_callback(GLFWwindow *window, int width, int height);
+Internal void framebuffer_size_callback(GLFWwindow *window, int width, int height);
+Internal void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+
+Internal void log_lock(bool lock, void *data);
 
 bool application_init(CELgame *game) {
     state.game_inst = game;
@@ -36,34 +50,57 @@ bool application_init(CELgame *game) {
     state.actual_height = game->config.height;
     state.title         = game->config.title;
 
-    state.paths.user_base_path = game->config.base_path ? game->config.base_path : "";
+    const char *user_base_path = game->config.base_path ? game->config.base_path : "";
 
-    char engine_path[FS_PATH_MAX];
-    char user_path[FS_PATH_MAX];
+    // workers log too, so the logger needs its lock before any of them start
+    profile_thread_name("main");
+    mutex_init(&log_mutex);
+    log_set_lock(log_lock, &log_mutex);
+    if (!log_set_async(true)) { CEL_WARN("failed to start the log writer, logging synchronously"); }
+    if (!job_system_init(game->config.worker_count)) { return false; }
 
     char cwd[FS_PATH_MAX];
     celfs_get_current_dir(cwd, sizeof(cwd));
     CEL_INFO("current working directory %s", cwd);
 
-    snprintf(engine_path, sizeof(engine_path), "%s%c..%c..%cresources", cwd, FS_PATH_SEP, FS_PATH_SEP, FS_PATH_SEP);
-    snprintf(user_path, sizeof(user_path), "%s%c..%c..%c%s", cwd, FS_PATH_SEP, FS_PATH_SEP, FS_PATH_SEP, state.paths.user_base_path);
+    snprintf(state.paths.engine_base_path, sizeof(state.paths.engine_base_path), "%s%c..%c..%cresources", cwd, FS_PATH_SEP, FS_PATH_SEP, FS_PATH_SEP);
+    snprintf(state.paths.user_base_path, sizeof(state.paths.user_base_path), "%s%c..%c..%c%s", cwd, FS_PATH_SEP, FS_PATH_SEP, FS_PATH_SEP, user_base_path);
 
-    state.paths.engine_base_path = engine_path;
-    state.paths.user_base_path   = user_path;
+    // one open for every packed resource, loose files are only read for what the pak does not have
+    char pak_path[FS_PATH_MAX];
+    snprintf(pak_path, sizeof(pak_path), "%s.pak", state.paths.engine_base_path);
+    if (celpak_open(&state.pak, pak_path)) { CEL_INFO("mounted %s (%u files)", pak_path, state.pak.header->entry_count); }
 
-    if (!glfwInit()) { return false; }
+    // headless runs never touch glfw, so they work without a display
+    if (!game->config.headless_frames)
+    {
+        if (!glfwInit()) { return false; }
 
-    glfwSetErrorCallback(error_callback);
-    glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+        glfwSetErrorCallback(error_callback);
+        glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
-    state.window = glfwCreateWindow((int) state.actual_width, (int) state.actual_height, state.title, NULL, NULL);
-    if (!state.window) { return false; }
+        state.window = glfwCreateWindow((int) state.actual_width, (int) state.actual_height, state.title, NULL, NULL);
+        if (!state.window) { return false; }
 
-    glfwSetWindowCloseCallback(state.window, window_close_callback);
-    glfwSetWindowSizeCallback(state.window, window_size_callback);
+        glfwSetWindowCloseCallback(state.window, window_close_callback);
+        glfwSetFramebufferSizeCallback(state.window, framebuffer_size_callback);
+        glfwSetKeyCallback(state.window, key_callback);
+    }
 
     // setup vulkan
-    if (!cel_vulkan_init(state.window)) { return false; };
+    state.present_mode   = CELVK_PRESENT_MODE_MAILBOX;
+    CELvk_state vk_state = {
+        .app_name              = state.title,
+        .engine_path           = state.paths.engine_base_path,
+        .user_path             = state.paths.user_base_path,
+        .pak                   = state.pak.header ? &state.pak : NULL,
+        .frames_in_flight      = game->config.frames_in_flight,
+        .frame_lead            = game->config.frame_lead,
+        .swapchain_image_count = game->config.swapchain_image_count,
+        .present_mode          = state.present_mode,
+        .headless              = game->config.headless_frames > 0,
+    };
+    if (!cel_vulkan_init(state.window, &vk_state)) { return false; };
 
     if (!state.game_inst->game_init(state.game_inst)) { return false; }
 
@@ -74,22 +111,88 @@ bool application_init(CELgame *game) {
 }
 
 bool application_run() {
+    uint32_t headless_frames = state.game_inst->config.headless_frames;
+    if (headless_frames)
+    {
+        if (!application_run_headless(headless_frames)) { return false; }
+        application_fini();
+        return true;
+    }
+
+    // whatever init left in the transient arena stays, everything after is frame scoped
+    CELarena_temp frame_scope = cel_arena_temp_begin(&state.game_inst->state.transient_arena);
     while (!glfwWindowShouldClose(state.window))
     {
-        glfwPollEvents();
+        cel_arena_temp_end(frame_scope);
+        CEL_PROFILE_BEGIN("frame");
 
-        if (!state.game_inst->game_draw(state.game_inst)) { return false; }
+        CEL_PROFILE_BEGIN("poll events");
+        glfwPollEvents();
+        CEL_PROFILE_END();
+
+        // nothing can be presented to a minimized window, sleep until it is restored instead of spinning
+        if (state.minimized)
+        {
+            CEL_PROFILE_END();
+            glfwWaitEvents();
+            continue;
+        }
+
+        bool drawn = state.game_inst->game_draw(state.game_inst);
+        CEL_PROFILE_END();
+        if (!drawn) { return false; }
     }
 
-    cel_vulkan_fini();
+    application_fini();
     return true;
 }
 
-bool application_resize() {
-    printf("app resize");
+bool application_run_headless(uint32_t frame_count) {
+    uint64_t start_ns         = time_now_ns();
+    CELarena_temp frame_scope = cel_arena_temp_begin(&state.game_inst->state.transient_arena);
+    for (uint32_t i = 0; i < frame_count; ++i)
+    {
+        cel_arena_temp_end(frame_scope);
+        CEL_PROFILE_BEGIN("frame");
+        bool drawn = state.game_inst->game_draw(state.game_inst);
+        CEL_PROFILE_END();
+        if (!drawn) { return false; }
+    }
+
+    // the last frames may still be on the gpu, the time has to cover them too
+    celvk_frame_wait(celvk_frame_index() - 1);
+    double elapsed_ms = (double) (time_now_ns() - start_ns) / 1e6;
+    CEL_INFO("headless: %u frames in %.2f ms, %.3f ms/frame, %.1f fps", frame_count, elapsed_ms, elapsed_ms / frame_count, frame_count * 1000.0 / elapsed_ms);
+
+    CELvk_gpu_timings timings;
+    if (celvk_gpu_timings_get(&timings))
+    {
+        for (uint32_t i = 0; i < CELVK_GPU_PASS_COUNT; ++i)
+        {
+            CEL_INFO("headless: gpu %-8s %.3f ms (frame %llu)", celvk_gpu_pass_name((CELvk_gpu_pass) i), timings.pass_ms[i], (unsigned long long) timings.frame_index);
+        }
+    }
     return true;
 }
 
+void application_fini() {
+    cel_vulkan_fini();
+    celpak_close(&state.pak);
+    job_system_fini();
+    log_set_async(false);
+    atomic_pool_thread_fini();
+    arena_scratch_fini();
+}
+
+void application_resize(uint32_t width, uint32_t height) {
+    state.actual_width  = width;
+    state.actual_height = height;
+    state.minimized     = width == 0 || height == 0;
+
+    // the swapchain is rebuilt by the next frame, in flight frames keep presenting from the old one
+    celvk_swapchain_invalidate();
+}
+
 void error_callback(int error, const char *description) {
     printf("glfw error (code %d): %s", error, description);
 }
@@ -98,6 +201,30 @@ void window_close_callback(GLFWwindow *window) {
     glfwSetWindowShouldClose(window, GLFW_TRUE);
 }
 
-void window_size_callback(GLFWwindow *window, int width, int height) {
-    application_resize();
+void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
+    application_resize((uint32_t) width, (uint32_t) height);
+}
+
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    // f12 writes the zones still in the rings as a chrome trace into the working directory
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS) { profile_dump(CEL_PROFILE_TRACE_FILE); }
+
+    // f11 cycles the present mode and f10 the frame lead, so latency can be compared without a restart
+    if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+    {
+        state.present_mode = (CELvk_present_mode) ((state.present_mode + 1) % CELVK_PRESENT_MODE_COUNT);
+        celvk_present_mode_set(state.present_mode);
+        CEL_INFO("present mode: %s requested", celvk_present_mode_name(state.present_mode));
+    }
+    if (key == GLFW_KEY_F10 && action == GLFW_PRESS)
+    {
+        // counts down to 1, then 0 wraps back to every frame in flight
+        celvk_frame_lead_set(celvk_frame_lead_get() - 1);
+        CEL_INFO("frame lead: %u", celvk_frame_lead_get());
+    }
+}
+
+void log_lock(bool lock, void *data) {
+    if (lock) { mutex_lock((CELmutex *) data); }
+    else { mutex_unlock((CELmutex *) data); }
 }
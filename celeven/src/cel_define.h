@@ -51,11 +51,28 @@ typedef unsigned char bool;
     #define FS_PATH_MAX 1024
     #define FS_PATH_SEP '\\'
 #else
+    #include <unistd.h>
+    #define fs_chdir chdir
+    #define fs_getcwd getcwd
+    #define FS_PATH_MAX 1024
+    #define FS_PATH_SEP '/'
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+    #define CEL_THREAD_LOCAL __declspec(thread)
+    #define CEL_ALIGN(n) __declspec(align(n))
+    #define CEL_PRINTF_FORMAT(fmt_index, first_arg)
+#else
+    #define CEL_THREAD_LOCAL __thread
+    #define CEL_ALIGN(n) __attribute__((aligned(n)))
+    #define CEL_PRINTF_FORMAT(fmt_index, first_arg) __attribute__((format(printf, fmt_index, first_arg)))
 #endif
 
 #if !defined(CEL_HANDLE_DEFINE)
     #define CEL_HANDLE_DEFINE(name) \
         typedef struct CEL##name {  \
             uint32_t idx;           \
+            uint32_t generation;    \
         } CEL##name;
 #endif// CEL_HANDLE_DEFINE
\ No newline at end of file
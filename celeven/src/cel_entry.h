@@ -1,15 +1,23 @@
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "cel.h"
 
 extern bool game_create(CELgame *game);
 
-int main(void) {
-    CELgame game;
+int main(int argc, char **argv) {
+    CELgame game = {0};
 
     if (!game_create(&game)) { return -1; }
 
+    // --headless <frames> renders offscreen without a window, for benchmarking where there is no display
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc) { game.config.headless_frames = (uint32_t) strtoul(argv[++i], NULL, 10); }
+    }
+
     if (!game.game_init) { return -2; }
     if (!game.game_update) { return -2; }
     if (!game.game_draw) { return -2; }
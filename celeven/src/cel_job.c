@@ -0,0 +1,319 @@
+#include "cel.h"
+#include "cel_log.h"
+
+#include <assert.h>
+
+#define CEL_JOB_QUEUE_CAPACITY 1024
+#define CEL_JOB_SPIN_COUNT 64
+#define CEL_JOB_CACHE_LINE 64
+
+#define CEL_JOB_INVALID_THREAD UINT32_MAX
+
+typedef struct CELjob CELjob;
+struct CELjob {
+    CELjob_fn fn;
+    void *data;
+    CELjob_counter *counter;
+};
+
+// chase-lev deque: the owner pushes and takes at the bottom, thieves steal from the top.
+// top and bottom live on their own cache lines since they are written by different threads
+typedef struct CELjob_queue CELjob_queue;
+struct CELjob_queue {
+    volatile int64_t top;
+    unsigned char top_padding[CEL_JOB_CACHE_LINE - sizeof(int64_t)];
+    volatile int64_t bottom;
+    unsigned char bottom_padding[CEL_JOB_CACHE_LINE - sizeof(int64_t)];
+    CELjob jobs[CEL_JOB_QUEUE_CAPACITY];
+};
+
+typedef struct CELjob_system CELjob_system;
+struct CELjob_system {
+    CELjob_queue queues[CEL_MAX_JOB_THREAD_COUNT];
+    CELthread threads[CEL_MAX_JOB_THREAD_COUNT];
+    uint32_t thread_count;// including the thread that called job_system_init
+
+    volatile int32_t running;
+    volatile int32_t sleeping;
+    CELmutex sleep_mutex;
+    CELcondition sleep_condition;
+};
+
+typedef struct CELjob_parallel_for CELjob_parallel_for;
+struct CELjob_parallel_for {
+    CELjob_range_fn fn;
+    void *data;
+    uint32_t count;
+    uint32_t grain;
+    volatile int64_t cursor;
+};
+
+GlobalVariable CELjob_system job_system = {0};
+
+GlobalVariable CEL_THREAD_LOCAL uint32_t job_thread_idx = CEL_JOB_INVALID_THREAD;
+GlobalVariable CEL_THREAD_LOCAL uint32_t job_random_state;
+
+Internal bool job_queue_push(CELjob_queue *queue, const CELjob *job);
+Internal bool job_queue_take(CELjob_queue *queue, CELjob *job);
+Internal bool job_queue_steal(CELjob_queue *queue, CELjob *job);
+Internal bool job_queue_empty(CELjob_queue *queue);
+
+Internal bool job_find(CELjob *job);
+Internal void job_execute(const CELjob *job);
+Internal int job_worker_main(void *data);
+Internal void job_parallel_for_main(void *data);
+
+bool job_system_init(uint32_t worker_count) {
+    if (worker_count == 0)
+    {
+        uint32_t core_count = cpu_core_count();
+        worker_count        = core_count > 1 ? core_count - 1 : 0;
+    }
+    if (worker_count > CEL_MAX_JOB_THREAD_COUNT - 1) { worker_count = CEL_MAX_JOB_THREAD_COUNT - 1; }
+
+    job_thread_idx          = 0;
+    job_random_state        = 0x9e3779b9u;
+    job_system.thread_count = worker_count + 1;
+    job_system.running      = 1;
+    job_system.sleeping     = 0;
+    mutex_init(&job_system.sleep_mutex);
+    condition_init(&job_system.sleep_condition);
+
+    for (uint32_t i = 1; i < job_system.thread_count; ++i)
+    {
+        if (!thread_create(&job_system.threads[i], job_worker_main, (void *) (uintptr_t) i))
+        {
+            CEL_ERROR("job system: failed to create worker thread %u", i);
+            job_system.thread_count = i;
+            break;
+        }
+    }
+
+    CEL_INFO("job system running on %u threads", job_system.thread_count);
+    return true;
+}
+
+void job_system_fini() {
+    cel_atomic_store_i32(&job_system.running, 0);
+
+    mutex_lock(&job_system.sleep_mutex);
+    condition_broadcast(&job_system.sleep_condition);
+    mutex_unlock(&job_system.sleep_mutex);
+
+    for (uint32_t i = 1; i < job_system.thread_count; ++i)
+    {
+        thread_join(&job_system.threads[i]);
+    }
+
+    condition_fini(&job_system.sleep_condition);
+    mutex_fini(&job_system.sleep_mutex);
+    job_system.thread_count = 0;
+}
+
+void job_run(CELjob_fn fn, void *data, CELjob_counter *counter) {
+    CELjob job = {.fn = fn, .data = data, .counter = counter};
+    if (counter) { cel_atomic_add_i32(&counter->pending, 1); }
+
+    // without workers, or with a full deque, the spawning thread just does the work itself
+    if (job_system.thread_count <= 1)
+    {
+        job_execute(&job);
+        return;
+    }
+
+    assert(job_thread_idx != CEL_JOB_INVALID_THREAD && "job system: jobs must be spawned from the main thread or a job");
+    if (!job_queue_push(&job_system.queues[job_thread_idx], &job))
+    {
+        job_execute(&job);
+        return;
+    }
+
+    // pairs with the fence a worker issues between announcing it sleeps and rechecking the deques
+    cel_atomic_fence();
+    if (cel_atomic_load_i32(&job_system.sleeping) > 0)
+    {
+        mutex_lock(&job_system.sleep_mutex);
+        condition_signal(&job_system.sleep_condition);
+        mutex_unlock(&job_system.sleep_mutex);
+    }
+}
+
+void job_wait(CELjob_counter *counter) {
+    // the waiting thread helps out instead of blocking, which also keeps nested waits from deadlocking
+    uint32_t spins = 0;
+    while (cel_atomic_load_i32(&counter->pending) > 0)
+    {
+        CELjob job;
+        if (job_system.thread_count > 1 && job_thread_idx != CEL_JOB_INVALID_THREAD && job_find(&job))
+        {
+            job_execute(&job);
+            spins = 0;
+        }
+        else if (++spins < CEL_JOB_SPIN_COUNT) { cel_cpu_pause(); }
+        else { thread_yield(); }
+    }
+}
+
+void job_parallel_for(uint32_t count, uint32_t grain, CELjob_range_fn fn, void *data) {
+    if (count == 0) { return; }
+
+    uint32_t thread_count = job_system.thread_count ? job_system.thread_count : 1;
+    if (grain == 0)
+    {
+        grain = count / (thread_count * 4);
+        if (grain == 0) { grain = 1; }
+    }
+
+    // ranges are claimed from a shared cursor, so one job per thread is enough to balance the work
+    CELjob_parallel_for parallel_for = {.fn = fn, .data = data, .count = count, .grain = grain, .cursor = 0};
+    CELjob_counter counter           = {0};
+
+    uint32_t range_count = (count + grain - 1) / grain;
+    uint32_t job_count   = range_count < thread_count ? range_count : thread_count;
+    for (uint32_t i = 1; i < job_count; ++i)
+    {
+        job_run(job_parallel_for_main, &parallel_for, &counter);
+    }
+
+    job_parallel_for_main(&parallel_for);
+    job_wait(&counter);
+}
+
+uint32_t job_thread_count() {
+    return job_system.thread_count ? job_system.thread_count : 1;
+}
+
+uint32_t job_thread_index() {
+    return job_thread_idx == CEL_JOB_INVALID_THREAD ? 0 : job_thread_idx;
+}
+
+bool job_queue_push(CELjob_queue *queue, const CELjob *job) {
+    int64_t bottom = queue->bottom;
+    int64_t top    = cel_atomic_load_i64(&queue->top);
+    if (bottom - top >= CEL_JOB_QUEUE_CAPACITY) { return false; }
+
+    queue->jobs[bottom & (CEL_JOB_QUEUE_CAPACITY - 1)] = *job;
+    cel_atomic_store_i64(&queue->bottom, bottom + 1);
+    return true;
+}
+
+bool job_queue_take(CELjob_queue *queue, CELjob *job) {
+    int64_t bottom = queue->bottom - 1;
+    cel_atomic_store_i64(&queue->bottom, bottom);
+    cel_atomic_fence();
+    int64_t top = cel_atomic_load_i64(&queue->top);
+
+    if (top > bottom)
+    {
+        cel_atomic_store_i64(&queue->bottom, bottom + 1);
+        return false;
+    }
+
+    *job = queue->jobs[bottom & (CEL_JOB_QUEUE_CAPACITY - 1)];
+    if (top < bottom) { return true; }
+
+    // last job left, race the thieves for it
+    bool won = cel_atomic_cas_i64(&queue->top, top, top + 1);
+    cel_atomic_store_i64(&queue->bottom, bottom + 1);
+    return won;
+}
+
+bool job_queue_steal(CELjob_queue *queue, CELjob *job) {
+    int64_t top = cel_atomic_load_i64(&queue->top);
+    cel_atomic_fence();
+    int64_t bottom = cel_atomic_load_i64(&queue->bottom);
+    if (top >= bottom) { return false; }
+
+    // the slot cannot be reused before top moves past it, so the copy is only trusted once the cas wins
+    *job = queue->jobs[top & (CEL_JOB_QUEUE_CAPACITY - 1)];
+    return cel_atomic_cas_i64(&queue->top, top, top + 1);
+}
+
+bool job_queue_empty(CELjob_queue *queue) {
+    return cel_atomic_load_i64(&queue->top) >= cel_atomic_load_i64(&queue->bottom);
+}
+
+bool job_find(CELjob *job) {
+    if (job_queue_take(&job_system.queues[job_thread_idx], job)) { return true; }
+
+    // xorshift picks where to start so idle threads do not all hammer the same victim
+    job_random_state ^= job_random_state << 13;
+    job_random_state ^= job_random_state >> 17;
+    job_random_state ^= job_random_state << 5;
+
+    uint32_t start = job_random_state % job_system.thread_count;
+    for (uint32_t i = 0; i < job_system.thread_count; ++i)
+    {
+        uint32_t victim = (start + i) % job_system.thread_count;
+        if (victim == job_thread_idx) { continue; }
+        if (job_queue_steal(&job_system.queues[victim], job)) { return true; }
+    }
+    return false;
+}
+
+void job_execute(const CELjob *job) {
+    job->fn(job->data);
+    if (job->counter) { cel_atomic_add_i32(&job->counter->pending, -1); }
+}
+
+int job_worker_main(void *data) {
+    job_thread_idx   = (uint32_t) (uintptr_t) data;
+    job_random_state = 0x9e3779b9u * (job_thread_idx + 1);
+    profile_thread_name("job worker");
+
+    uint32_t spins = 0;
+    while (cel_atomic_load_i32(&job_system.running))
+    {
+        CELjob job;
+        if (job_find(&job))
+        {
+            job_execute(&job);
+            spins = 0;
+            continue;
+        }
+
+        if (++spins < CEL_JOB_SPIN_COUNT)
+        {
+            cel_cpu_pause();
+            continue;
+        }
+
+        // announce the sleep before the final check, so a push either sees us sleeping or we see its job
+        mutex_lock(&job_system.sleep_mutex);
+        cel_atomic_add_i32(&job_system.sleeping, 1);
+        cel_atomic_fence();
+
+        bool work_available = false;
+        for (uint32_t i = 0; i < job_system.thread_count && !work_available; ++i)
+        {
+            work_available = !job_queue_empty(&job_system.queues[i]);
+        }
+
+        if (!work_available && cel_atomic_load_i32(&job_system.running))
+        {
+            condition_wait(&job_system.sleep_condition, &job_system.sleep_mutex);
+        }
+        cel_atomic_add_i32(&job_system.sleeping, -1);
+        mutex_unlock(&job_system.sleep_mutex);
+        spins = 0;
+    }
+
+    atomic_pool_thread_fini();
+    arena_scratch_fini();
+    return 0;
+}
+
+void job_parallel_for_main(void *data) {
+    CELjob_parallel_for *parallel_for = (CELjob_parallel_for *) data;
+    uint32_t thread_index             = job_thread_index();
+
+    for (;;)
+    {
+        int64_t begin = cel_atomic_add_i64(&parallel_for->cursor, parallel_for->grain) - parallel_for->grain;
+        if (begin >= parallel_for->count) { break; }
+
+        int64_t end = begin + parallel_for->grain;
+        if (end > parallel_for->count) { end = parallel_for->count; }
+        parallel_for->fn((uint32_t) begin, (uint32_t) end, thread_index, parallel_for->data);
+    }
+}
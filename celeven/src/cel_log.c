@@ -1,9 +1,30 @@
 #include "cel_log.h"
 
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 #define CEL_LOG_MAX_CALLBACKS 32
+#define CEL_LOG_MESSAGE_SIZE 1024
+
+#define CEL_LOG_RING_CAPACITY 4096// records, power of two
+#define CEL_LOG_RECORD_ARGS_SIZE 216
+#define CEL_LOG_WRITER_IDLE_MS 1
+
+#define CEL_LOG_BINARY_SITE_CAPACITY 4096                        // power of two
+#define CEL_LOG_BINARY_OVERFLOW_SITE (CEL_LOG_BINARY_SITE_CAPACITY / 2)// shared by every site past the interned half
+#define CEL_LOG_BINARY_RECORD_SIZE 1024
+
+enum
+{
+    LOG_ARG_INT,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_POINTER,
+    LOG_ARG_STRING,
+};
 
 typedef struct CELlog_callback CELlog_callback;
 struct CELlog_callback {
@@ -12,6 +33,49 @@ struct CELlog_callback {
     int level;
 };
 
+// one slot of the async ring, the sequence tells producers and the writer whose turn the slot is
+typedef struct CELlog_record CELlog_record;
+struct CELlog_record {
+    volatile int64_t sequence;
+    uint64_t timestamp_ns;
+    const char *file;
+    const char *fmt;
+    int32_t line;
+    int16_t level;
+    uint16_t args_size;
+    unsigned char args[CEL_LOG_RECORD_ARGS_SIZE];
+};
+
+// a parsed printf conversion, enough to rebuild it for a single argument
+typedef struct CELlog_spec CELlog_spec;
+struct CELlog_spec {
+    const char *flags;
+    int flag_count;
+    int width;    // -1 when absent
+    int precision;// -1 when absent
+    bool width_arg;
+    bool precision_arg;
+    char length[3];
+    char conversion;
+};
+
+typedef struct CELlog_binary_site CELlog_binary_site;
+struct CELlog_binary_site {
+    const char *fmt;
+    const char *file;
+    int line;
+    uint32_t id;
+};
+
+// call sites are interned by the identity of their fmt and file literals, so each one is written out once
+typedef struct CELlog_binary_sink CELlog_binary_sink;
+struct CELlog_binary_sink {
+    FILE *fp;
+    uint64_t last_timestamp_ns;
+    uint32_t site_count;// also the id of the next interned site
+    CELlog_binary_site sites[CEL_LOG_BINARY_SITE_CAPACITY];
+};
+
 GlobalVariable struct {
     void *data;
     CELlock_fn lock;
@@ -20,6 +84,23 @@ GlobalVariable struct {
     CELlog_callback callbacks[CEL_LOG_MAX_CALLBACKS];
 } L;
 
+GlobalVariable struct {
+    CELlog_record records[CEL_LOG_RING_CAPACITY];
+    volatile int64_t enqueue_position;
+    volatile int64_t dequeue_position;
+    volatile int64_t dropped;
+    volatile int32_t enabled;
+    volatile int32_t running;
+    volatile int32_t producers;// callers between seeing async on and finishing their enqueue
+    uint64_t dropped_total;
+    time_t wall_base;
+    uint64_t clock_base_ns;
+    CELthread writer;
+} A;
+
+// read inline by the log macros, see CEL_LOG_AT
+int cel_log_threshold = LOG_TRACE;
+
 GlobalVariable const char *level_strings[] = {"CELtrace", "CELdebug", "CELinfo", "CELwarn", "CELerror", "CELfatal"};
 
 #if defined(CEL_LOG_WITH_COLOR)
@@ -39,6 +120,10 @@ Internal inline const char *cel_log_level_string(int level) {
     return level_strings[level];
 }
 
+const char *log_level_string(int level) {
+    return cel_log_level_string(level);
+}
+
 Internal inline const char *cel_log_level_color(int level) {
 #if defined(CEL_LOG_WITH_COLOR)
     if (level < 0 || level >= MAX_LOG_COUNT) return "\x1b[0m";
@@ -72,16 +157,534 @@ Internal void file_callback(CELlog_event *event) {
     fflush(event->data);
 }
 
-Internal void event_init(CELlog_event *event, void *data) {
-    time_t t = time(NULL);
+Internal size_t leb128_put(unsigned char *out, uint64_t value) {
+    size_t size = 0;
+    do
+    {
+        unsigned char byte = value & 0x7f;
+        value >>= 7;
+        out[size++] = byte | (value ? 0x80 : 0);
+    } while (value);
+    return size;
+}
+
+Internal uint32_t binary_site_get(CELlog_binary_sink *sink, const char *fmt, const char *file, int line, unsigned char *out, size_t *size) {
+    uintptr_t key = (uintptr_t) fmt ^ ((uintptr_t) file * 31) ^ ((uintptr_t) line * 0x9e3779b9u);
+    uint32_t mask = CEL_LOG_BINARY_SITE_CAPACITY - 1;
+
+    CELlog_binary_site *site = NULL;
+    for (uint32_t i = (uint32_t) (key ^ (key >> 17)) & mask, probe = 0; probe < CEL_LOG_BINARY_SITE_CAPACITY; i = (i + 1) & mask, ++probe)
+    {
+        CELlog_binary_site *candidate = &sink->sites[i];
+        if (candidate->fmt == fmt && candidate->file == file && candidate->line == line) { return candidate->id; }
+        if (!candidate->fmt)
+        {
+            site = candidate;
+            break;
+        }
+    }
+
+    // a full table still works, overflowing sites share one id and are defined again right before each message,
+    // so the reader's site table stays bounded
+    uint32_t id = CEL_LOG_BINARY_OVERFLOW_SITE;
+    if (site && sink->site_count < CEL_LOG_BINARY_SITE_CAPACITY / 2)
+    {
+        id    = sink->site_count++;
+        *site = (CELlog_binary_site){.fmt = fmt, .file = file, .line = line, .id = id};
+    }
+
+    size_t file_length = strlen(file);
+    size_t fmt_length  = strlen(fmt);
+    if (*size + 1 + 3 * 10 + file_length + fmt_length > CEL_LOG_BINARY_RECORD_SIZE)
+    {
+        fmt_length  = 0;
+        file_length = 0;
+    }
+
+    out[(*size)++] = CEL_LOG_BINARY_SITE;
+    *size += leb128_put(out + *size, id);
+    *size += leb128_put(out + *size, (uint64_t) line);
+    *size += leb128_put(out + *size, file_length);
+    memcpy(out + *size, file, file_length);
+    *size += file_length;
+    *size += leb128_put(out + *size, fmt_length);
+    memcpy(out + *size, fmt, fmt_length);
+    *size += fmt_length;
+    return id;
+}
+
+Internal void binary_callback(CELlog_event *event) {
+    CELlog_binary_sink *sink = event->data;
+    const char *fmt          = event->raw_args ? event->raw_fmt : event->fmt;
+
+    unsigned char record[CEL_LOG_BINARY_RECORD_SIZE];
+    size_t size = 0;
+    uint32_t id = binary_site_get(sink, fmt, event->file, event->line, record, &size);
+
+    // messages from different threads can land slightly out of order, hence the zigzag delta
+    int64_t delta           = (int64_t) (event->timestamp_ns - sink->last_timestamp_ns);
+    sink->last_timestamp_ns = event->timestamp_ns;
+
+    record[size++] = (unsigned char) (CEL_LOG_BINARY_MESSAGE | (event->level << 4));
+    size += leb128_put(record + size, id);
+    size += leb128_put(record + size, ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63));
+
+    unsigned char encoded[CEL_LOG_BINARY_RECORD_SIZE / 2];
+    const unsigned char *args = event->raw_args;
+    size_t args_size          = event->raw_args_size;
+    if (!args)
+    {
+        args_size = log_args_encode(encoded, sizeof(encoded), fmt, event->ap);
+        args      = encoded;
+    }
+    if (args_size > CEL_LOG_BINARY_RECORD_SIZE - size - 10) { args_size = 0; }
+
+    size += leb128_put(record + size, args_size);
+    memcpy(record + size, args, args_size);
+    size += args_size;
+
+    fwrite(record, 1, size, sink->fp);
+    if (event->level >= LOG_ERROR) { fflush(sink->fp); }
+}
+
+Internal void event_init(CELlog_event *event, void *data, const struct tm *time_info) {
+    if (time_info) { event->time = *time_info; }
+    else
+    {
+        time_t t = time(NULL);
 #if defined(_WIN32)
-    localtime_s(&event->time, &t);
+        localtime_s(&event->time, &t);
 #else
-    localtime_r(&t, &event->time);
+        localtime_r(&t, &event->time);
 #endif
+    }
     event->data = data;
 }
 
+Internal void threshold_update() {
+    cel_log_threshold = L.quiet ? LOG_FATAL + 1 : L.level;
+    for (int i = 0; i < CEL_LOG_MAX_CALLBACKS && L.callbacks[i].fn; ++i)
+    {
+        if (L.callbacks[i].level < cel_log_threshold) { cel_log_threshold = L.callbacks[i].level; }
+    }
+}
+
+// hands one message to stderr and every callback that wants it, time_info NULL stamps it with the current time
+Internal void log_write(const CELlog_event *message, const struct tm *time_info, va_list ap) {
+    CELlog_event event = *message;
+    int level          = message->level;
+
+    lock();
+
+    if (!L.quiet && level >= L.level)
+    {
+        event_init(&event, stderr, time_info);
+        va_copy(event.ap, ap);
+        stdout_callback(&event);
+        va_end(event.ap);
+    }
+
+    for (int i = 0; i < CEL_LOG_MAX_CALLBACKS && L.callbacks[i].fn; ++i)
+    {
+        CELlog_callback *cb = &L.callbacks[i];
+        if (level >= cb->level)
+        {
+            event_init(&event, cb->data, time_info);
+            va_copy(event.ap, ap);
+            cb->fn(&event);
+            va_end(event.ap);
+        }
+    }
+
+    unlock();
+}
+
+Internal void log_write_message(const CELlog_event *message, const struct tm *time_info, ...) {
+    va_list ap;
+    va_start(ap, time_info);
+    log_write(message, time_info, ap);
+    va_end(ap);
+}
+
+Internal const char *log_spec_parse(const char *c, CELlog_spec *spec) {
+    *spec = (CELlog_spec){.flags = c, .width = -1, .precision = -1};
+    while (*c && strchr("-+ #0", *c)) { ++c; }
+    spec->flag_count = (int) (c - spec->flags);
+
+    if (*c == '*')
+    {
+        spec->width_arg = true;
+        ++c;
+    }
+    else if (*c >= '0' && *c <= '9')
+    {
+        spec->width = 0;
+        while (*c >= '0' && *c <= '9') { spec->width = spec->width * 10 + (*c++ - '0'); }
+    }
+
+    if (*c == '.')
+    {
+        ++c;
+        spec->precision = 0;
+        if (*c == '*')
+        {
+            spec->precision_arg = true;
+            ++c;
+        }
+        else
+        {
+            while (*c >= '0' && *c <= '9') { spec->precision = spec->precision * 10 + (*c++ - '0'); }
+        }
+    }
+
+    int length_count = 0;
+    while (*c && strchr("hljztL", *c) && length_count < 2) { spec->length[length_count++] = *c++; }
+    spec->conversion = *c;
+    return *c ? c + 1 : c;
+}
+
+Internal bool log_arg_put(unsigned char *out, size_t capacity, size_t *offset, unsigned char tag, const void *value, size_t size) {
+    if (*offset + 1 + size > capacity) { return false; }
+    out[(*offset)++] = tag;
+    memcpy(out + *offset, value, size);
+    *offset += size;
+    return true;
+}
+
+Internal bool log_arg_put_string(unsigned char *out, size_t capacity, size_t *offset, const char *value) {
+    if (!value) { value = "(null)"; }
+    if (*offset + 1 + sizeof(uint16_t) + 1 > capacity) { return false; }
+
+    // long strings are cut to whatever still fits, the message is still worth more than dropping it
+    size_t length    = strlen(value);
+    size_t available = capacity - *offset - 1 - sizeof(uint16_t);
+    if (length > available) { length = available; }
+
+    uint16_t length16 = (uint16_t) length;
+    out[(*offset)++]  = LOG_ARG_STRING;
+    memcpy(out + *offset, &length16, sizeof(length16));
+    memcpy(out + *offset + sizeof(length16), value, length);
+    *offset += sizeof(length16) + length;
+    return true;
+}
+
+size_t log_args_encode(unsigned char *out, size_t capacity, const char *fmt, va_list ap) {
+    size_t offset = 0;
+    for (const char *c = fmt; *c;)
+    {
+        if (*c++ != '%') { continue; }
+        if (*c == '%')
+        {
+            ++c;
+            continue;
+        }
+
+        CELlog_spec spec;
+        c = log_spec_parse(c, &spec);
+
+        bool ok = true;
+        if (spec.width_arg)
+        {
+            int64_t width = va_arg(ap, int);
+            ok            = log_arg_put(out, capacity, &offset, LOG_ARG_INT, &width, sizeof(width));
+        }
+        if (ok && spec.precision_arg)
+        {
+            int64_t precision = va_arg(ap, int);
+            ok                = log_arg_put(out, capacity, &offset, LOG_ARG_INT, &precision, sizeof(precision));
+        }
+        if (!ok) { break; }
+
+        // arguments are read with the type the conversion promises, then widened so the record does not care
+        switch (spec.conversion)
+        {
+            case 'd':
+            case 'i':
+            {
+                int64_t value;
+                if (strcmp(spec.length, "hh") == 0) { value = (signed char) va_arg(ap, int); }
+                else if (strcmp(spec.length, "h") == 0) { value = (short) va_arg(ap, int); }
+                else if (strcmp(spec.length, "l") == 0) { value = va_arg(ap, long); }
+                else if (strcmp(spec.length, "ll") == 0) { value = va_arg(ap, long long); }
+                else if (strcmp(spec.length, "j") == 0) { value = va_arg(ap, intmax_t); }
+                else if (strcmp(spec.length, "z") == 0 || strcmp(spec.length, "t") == 0) { value = va_arg(ap, ptrdiff_t); }
+                else { value = va_arg(ap, int); }
+                ok = log_arg_put(out, capacity, &offset, LOG_ARG_INT, &value, sizeof(value));
+            }
+            break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            {
+                uint64_t value;
+                if (strcmp(spec.length, "hh") == 0) { value = (unsigned char) va_arg(ap, unsigned int); }
+                else if (strcmp(spec.length, "h") == 0) { value = (unsigned short) va_arg(ap, unsigned int); }
+                else if (strcmp(spec.length, "l") == 0) { value = va_arg(ap, unsigned long); }
+                else if (strcmp(spec.length, "ll") == 0) { value = va_arg(ap, unsigned long long); }
+                else if (strcmp(spec.length, "j") == 0) { value = va_arg(ap, uintmax_t); }
+                else if (strcmp(spec.length, "z") == 0 || strcmp(spec.length, "t") == 0) { value = va_arg(ap, size_t); }
+                else { value = va_arg(ap, unsigned int); }
+                ok = log_arg_put(out, capacity, &offset, LOG_ARG_UINT, &value, sizeof(value));
+            }
+            break;
+            case 'c':
+            {
+                int64_t value = va_arg(ap, int);
+                ok            = log_arg_put(out, capacity, &offset, LOG_ARG_INT, &value, sizeof(value));
+            }
+            break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+            {
+                double value = strcmp(spec.length, "L") == 0 ? (double) va_arg(ap, long double) : va_arg(ap, double);
+                ok           = log_arg_put(out, capacity, &offset, LOG_ARG_DOUBLE, &value, sizeof(value));
+            }
+            break;
+            case 'p':
+            {
+                uint64_t value = (uint64_t) (uintptr_t) va_arg(ap, void *);
+                ok             = log_arg_put(out, capacity, &offset, LOG_ARG_POINTER, &value, sizeof(value));
+            }
+            break;
+            case 's': ok = log_arg_put_string(out, capacity, &offset, va_arg(ap, const char *)); break;
+            case 'n': (void) va_arg(ap, void *); break;
+            // an unknown conversion leaves the argument types after it unknown, so stop here
+            default: ok = false; break;
+        }
+        if (!ok) { break; }
+    }
+    return offset;
+}
+
+Internal bool log_arg_get(const unsigned char *args, size_t args_size, size_t *offset, unsigned char tag, void *value, size_t size) {
+    if (*offset + 1 + size > args_size || args[*offset] != tag) { return false; }
+    memcpy(value, args + *offset + 1, size);
+    *offset += 1 + size;
+    return true;
+}
+
+int log_args_format(char *out, size_t size, const char *fmt, const unsigned char *args, size_t args_size) {
+    size_t length = 0;
+    size_t offset = 0;
+
+#define LOG_OUT_ADVANCE(n)                                  \
+    do {                                                    \
+        int written_ = (n);                                 \
+        if (written_ > 0) { length += (size_t) written_; } \
+    } while (0)
+#define LOG_OUT_REMAINING (length < size ? size - length : 0)
+#define LOG_OUT_CURSOR (out + (length < size ? length : size))
+
+    for (const char *c = fmt; *c;)
+    {
+        if (*c != '%' || c[1] == '%')
+        {
+            if (length + 1 < size) { out[length] = *c; }
+            ++length;
+            c += *c == '%' ? 2 : 1;
+            continue;
+        }
+
+        CELlog_spec spec;
+        c = log_spec_parse(c + 1, &spec);
+
+        int64_t width     = spec.width;
+        int64_t precision = spec.precision;
+        bool ok           = true;
+        if (spec.width_arg) { ok = log_arg_get(args, args_size, &offset, LOG_ARG_INT, &width, sizeof(width)); }
+        if (ok && spec.precision_arg) { ok = log_arg_get(args, args_size, &offset, LOG_ARG_INT, &precision, sizeof(precision)); }
+
+        // rebuild the conversion for a single widened argument: flags, width and precision as numbers
+        char single[32];
+        int single_length = snprintf(single, sizeof(single), "%%%.*s", spec.flag_count, spec.flags);
+        if (width >= 0) { single_length += snprintf(single + single_length, sizeof(single) - single_length, "%d", (int) width); }
+        else if (spec.width_arg) { single_length += snprintf(single + single_length, sizeof(single) - single_length, "-%d", (int) -width); }
+        if (precision >= 0) { single_length += snprintf(single + single_length, sizeof(single) - single_length, ".%d", (int) precision); }
+
+        switch (ok ? spec.conversion : 0)
+        {
+            case 'd':
+            case 'i':
+            case 'c':
+            {
+                int64_t value;
+                if (!(ok = log_arg_get(args, args_size, &offset, LOG_ARG_INT, &value, sizeof(value)))) { break; }
+                if (spec.conversion == 'c') { snprintf(single + single_length, sizeof(single) - single_length, "c"); }
+                else { snprintf(single + single_length, sizeof(single) - single_length, "lld"); }
+                LOG_OUT_ADVANCE(spec.conversion == 'c' ? snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, single, (int) value) : snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, single, (long long) value));
+            }
+            break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+            {
+                uint64_t value;
+                if (!(ok = log_arg_get(args, args_size, &offset, LOG_ARG_UINT, &value, sizeof(value)))) { break; }
+                snprintf(single + single_length, sizeof(single) - single_length, "ll%c", spec.conversion);
+                LOG_OUT_ADVANCE(snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, single, (unsigned long long) value));
+            }
+            break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+            {
+                double value;
+                if (!(ok = log_arg_get(args, args_size, &offset, LOG_ARG_DOUBLE, &value, sizeof(value)))) { break; }
+                snprintf(single + single_length, sizeof(single) - single_length, "%c", spec.conversion);
+                LOG_OUT_ADVANCE(snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, single, value));
+            }
+            break;
+            case 'p':
+            {
+                uint64_t value;
+                if (!(ok = log_arg_get(args, args_size, &offset, LOG_ARG_POINTER, &value, sizeof(value)))) { break; }
+                snprintf(single + single_length, sizeof(single) - single_length, "p");
+                LOG_OUT_ADVANCE(snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, single, (void *) (uintptr_t) value));
+            }
+            break;
+            case 's':
+            {
+                uint16_t string_length;
+                if (offset + 1 + sizeof(string_length) > args_size || args[offset] != LOG_ARG_STRING)
+                {
+                    ok = false;
+                    break;
+                }
+                memcpy(&string_length, args + offset + 1, sizeof(string_length));
+                const char *string = (const char *) args + offset + 1 + sizeof(string_length);
+                offset += 1 + sizeof(string_length) + string_length;
+
+                // the copy is not terminated, cap the precision at its length
+                if (precision < 0 || precision > string_length) { precision = string_length; }
+                single_length = snprintf(single, sizeof(single), "%%%.*s", spec.flag_count, spec.flags);
+                if (width >= 0) { single_length += snprintf(single + single_length, sizeof(single) - single_length, "%d", (int) width); }
+                snprintf(single + single_length, sizeof(single) - single_length, ".%ds", (int) precision);
+                LOG_OUT_ADVANCE(snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, single, string));
+            }
+            break;
+            case 'n': break;
+            default: ok = false; break;
+        }
+
+        // whatever did not fit in the record is marked rather than silently cut
+        if (!ok)
+        {
+            LOG_OUT_ADVANCE(snprintf(LOG_OUT_CURSOR, LOG_OUT_REMAINING, "..."));
+            break;
+        }
+    }
+
+    if (size > 0) { out[length < size ? length : size - 1] = '\0'; }
+    return (int) length;
+
+#undef LOG_OUT_ADVANCE
+#undef LOG_OUT_REMAINING
+#undef LOG_OUT_CURSOR
+}
+
+// vyukov's bounded queue, trimmed to the single consumer we have
+Internal bool log_enqueue(int level, const char *file, int line, const char *fmt, va_list ap, int64_t *position) {
+    int64_t pos = cel_atomic_load_i64(&A.enqueue_position);
+    CELlog_record *record;
+    for (;;)
+    {
+        record       = &A.records[pos & (CEL_LOG_RING_CAPACITY - 1)];
+        int64_t diff = cel_atomic_load_i64(&record->sequence) - pos;
+        if (diff == 0)
+        {
+            if (cel_atomic_cas_i64(&A.enqueue_position, pos, pos + 1)) { break; }
+            pos = cel_atomic_load_i64(&A.enqueue_position);
+        }
+        else if (diff < 0) { return false; }
+        else { pos = cel_atomic_load_i64(&A.enqueue_position); }
+    }
+
+    record->timestamp_ns = time_now_ns();
+    record->file         = file;
+    record->fmt          = fmt;
+    record->line         = line;
+    record->level        = (int16_t) level;
+    record->args_size    = (uint16_t) log_args_encode(record->args, sizeof(record->args), fmt, ap);
+    cel_atomic_store_i64(&record->sequence, pos + 1);
+
+    *position = pos;
+    return true;
+}
+
+Internal void log_record_write(const CELlog_record *record) {
+    char message[CEL_LOG_MESSAGE_SIZE];
+    log_args_format(message, sizeof(message), record->fmt, record->args, record->args_size);
+
+    // records only carry the monotonic clock, the wall time is derived from when async logging started
+    time_t t = A.wall_base + (time_t) ((record->timestamp_ns - A.clock_base_ns) / 1000000000ull);
+    struct tm time_info;
+#if defined(_WIN32)
+    localtime_s(&time_info, &t);
+#else
+    localtime_r(&t, &time_info);
+#endif
+    // text sinks get the rebuilt line, binary sinks can take the serialized arguments as they are
+    CELlog_event event = {
+        .fmt           = "%s",
+        .file          = record->file,
+        .line          = record->line,
+        .level         = record->level,
+        .timestamp_ns  = record->timestamp_ns,
+        .raw_fmt       = record->fmt,
+        .raw_args      = record->args,
+        .raw_args_size = record->args_size,
+    };
+    log_write_message(&event, &time_info, message);
+}
+
+Internal uint32_t log_drain() {
+    uint32_t count = 0;
+    for (;;)
+    {
+        int64_t pos           = A.dequeue_position;
+        CELlog_record *record = &A.records[pos & (CEL_LOG_RING_CAPACITY - 1)];
+        if (cel_atomic_load_i64(&record->sequence) != pos + 1) { break; }
+
+        log_record_write(record);
+        cel_atomic_store_i64(&record->sequence, pos + CEL_LOG_RING_CAPACITY);
+        cel_atomic_store_i64(&A.dequeue_position, pos + 1);
+        ++count;
+    }
+
+    int64_t dropped = cel_atomic_load_i64(&A.dropped);
+    if (dropped > 0)
+    {
+        cel_atomic_add_i64(&A.dropped, -dropped);
+        A.dropped_total += (uint64_t) dropped;
+        CELlog_event event = {.fmt = "log ring full, dropped %lld messages", .file = __FILE__, .line = __LINE__, .level = LOG_WARN, .timestamp_ns = time_now_ns()};
+        log_write_message(&event, NULL, (long long) dropped);
+    }
+    return count;
+}
+
+Internal int log_writer_main(void *data) {
+    (void) data;
+    while (cel_atomic_load_i32(&A.running))
+    {
+        if (log_drain() == 0) { thread_sleep_ms(CEL_LOG_WRITER_IDLE_MS); }
+    }
+    log_drain();
+    return 0;
+}
+
 void log_set_lock(CELlock_fn fn, void *data) {
     L.lock = fn;
     L.data = data;
@@ -89,10 +692,46 @@ void log_set_lock(CELlock_fn fn, void *data) {
 
 void log_set_level(int level) {
     L.level = level;
+    threshold_update();
 }
 
 void log_set_quite(bool enable) {
     L.quiet = enable;
+    threshold_update();
+}
+
+bool log_set_async(bool enable) {
+    if (enable == (bool) cel_atomic_load_i32(&A.enabled)) { return true; }
+
+    if (enable)
+    {
+        for (int64_t i = 0; i < CEL_LOG_RING_CAPACITY; ++i) { A.records[i].sequence = i; }
+        A.enqueue_position = 0;
+        A.dequeue_position = 0;
+        A.wall_base        = time(NULL);
+        A.clock_base_ns    = time_now_ns();
+        A.running          = 1;
+        if (!thread_create(&A.writer, log_writer_main, NULL))
+        {
+            A.running = 0;
+            return false;
+        }
+        cel_atomic_store_i32(&A.enabled, 1);
+        return true;
+    }
+
+    // producers still racing the switch land in the ring before the writer is told to stop, it drains once more on its way out.
+    // pairs with cel_log announcing itself before it rechecks the switch
+    cel_atomic_store_i32(&A.enabled, 0);
+    cel_atomic_fence();
+    while (cel_atomic_load_i32(&A.producers) > 0) { thread_yield(); }
+    cel_atomic_store_i32(&A.running, 0);
+    thread_join(&A.writer);
+    return true;
+}
+
+uint64_t log_dropped_count() {
+    return A.dropped_total + (uint64_t) cel_atomic_load_i64(&A.dropped);
 }
 
 int log_add_callback(CELlog_fn fn, void *data, int level) {
@@ -101,6 +740,7 @@ int log_add_callback(CELlog_fn fn, void *data, int level) {
         if (!L.callbacks[i].fn)
         {
             L.callbacks[i] = (CELlog_callback){fn, data, level};
+            threshold_update();
             return 0;
         }
     }
@@ -111,30 +751,64 @@ int log_add_fp(FILE *fp, int level) {
     return log_add_callback(file_callback, fp, level);
 }
 
+int log_add_binary(FILE *fp, int level) {
+    CELlog_binary_sink *sink = calloc(1, sizeof(CELlog_binary_sink));
+    if (!sink) { return -1; }
+
+    CELlog_binary_header header = {
+        .magic         = CEL_LOG_BINARY_MAGIC,
+        .version       = CEL_LOG_BINARY_VERSION,
+        .wall_base     = (int64_t) time(NULL),
+        .clock_base_ns = time_now_ns(),
+    };
+    sink->fp                = fp;
+    sink->last_timestamp_ns = header.clock_base_ns;
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1 || log_add_callback(binary_callback, sink, level) != 0)
+    {
+        free(sink);
+        return -1;
+    }
+    return 0;
+}
+
 void cel_log(int level, const char *file, int line, const char *fmt, ...) {
-    CELlog_event event = (CELlog_event){.fmt = fmt, .file = file, .line = line, .level = level};
+    if (level < cel_log_threshold) { return; }
 
-    lock();
+    va_list ap;
+    va_start(ap, fmt);
 
-    if (!L.quiet && level >= L.level)
+    // announce the enqueue before rechecking the switch, so log_set_async(false) either waits for it or it logs synchronously
+    bool queue = false;
+    if (cel_atomic_load_i32(&A.enabled))
     {
-        event_init(&event, stderr);
-        va_start(event.ap, fmt);
-        stdout_callback(&event);
-        va_end(event.ap);
+        cel_atomic_add_i32(&A.producers, 1);
+        queue = cel_atomic_load_i32(&A.enabled) != 0;
+        if (!queue) { cel_atomic_add_i32(&A.producers, -1); }
     }
 
-    for (int i = 0; i < CEL_LOG_MAX_CALLBACKS && L.callbacks[i].fn; ++i)
+    if (queue)
     {
-        CELlog_callback *cb = &L.callbacks[i];
-        if (level >= cb->level)
+        int64_t position;
+        bool queued = log_enqueue(level, file, line, fmt, ap, &position);
+        cel_atomic_add_i32(&A.producers, -1);
+        va_end(ap);
+
+        if (!queued)
         {
-            event_init(&event, cb->data);
-            va_start(event.ap, fmt);
-            cb->fn(&event);
-            va_end(event.ap);
+            cel_atomic_add_i64(&A.dropped, 1);
+            return;
         }
+
+        // a fatal message is usually followed by an abort, so wait until the writer has it on disk
+        if (level >= LOG_FATAL)
+        {
+            while (cel_atomic_load_i64(&A.dequeue_position) <= position) { thread_yield(); }
+        }
+        return;
     }
 
-    unlock();
+    CELlog_event event = {.fmt = fmt, .file = file, .line = line, .level = level, .timestamp_ns = time_now_ns()};
+    log_write(&event, NULL, ap);
+    va_end(ap);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "cel.h"
+#include <stdarg.h>
 #include <time.h>
 
 /**
@@ -16,6 +17,12 @@ struct CELlog_event {
     void *data;
     int line;
     int level;
+    uint64_t timestamp_ns;// monotonic, taken when the message was logged
+
+    // set when the message arrives already serialized, raw_fmt then describes raw_args
+    const char *raw_fmt;
+    const unsigned char *raw_args;
+    size_t raw_args_size;
 };
 
 typedef void (*CELlog_fn)(CELlog_event *event);
@@ -38,14 +45,137 @@ void log_set_level(int level);
 void log_set_quite(bool enable);
 int log_add_callback(CELlog_fn fn, void *data, int level);
 int log_add_fp(FILE *fp, int level);
+int log_add_binary(FILE *fp, int level);// tools/cellog turns it back into text
+
+#define CEL_LOG_BINARY_MAGIC 0x474f4c43u// "CLOG"
+#define CEL_LOG_BINARY_VERSION 1
+
+// a binary log is this header followed by records, each led by a tag byte and using unsigned leb128 integers.
+// a site record defines a call site the first time it logs: id, line, file length and bytes, fmt length and bytes.
+// a message record carries its level in the tag's high nibble: site id, zigzag timestamp delta in ns from
+// the previous message (the first from clock_base_ns), then the log_args_encode bytes prefixed by their length
+typedef struct CELlog_binary_header CELlog_binary_header;
+struct CELlog_binary_header {
+    uint32_t magic;
+    uint32_t version;
+    int64_t wall_base;// seconds since the epoch at clock_base_ns
+    uint64_t clock_base_ns;
+};
+
+enum
+{
+    CEL_LOG_BINARY_SITE    = 1,
+    CEL_LOG_BINARY_MESSAGE = 2,
+};
+
+// async mode serializes each call into a lock-free ring and formats it on a writer thread.
+// switch it from one thread while nothing else is logging, a full ring drops messages and counts them
+bool log_set_async(bool enable);
+uint64_t log_dropped_count();
+
+// printf arguments flattened into a self-describing byte stream, read with the types fmt promises.
+// %s is copied, so the bytes outlive the call; anything that does not fit is dropped and printed as "..."
+size_t log_args_encode(unsigned char *out, size_t capacity, const char *fmt, va_list ap);
+int log_args_format(char *out, size_t size, const char *fmt, const unsigned char *args, size_t args_size);
+
+CELAPI void cel_log(int level, const char *file, int line, const char *fmt, ...) CEL_PRINTF_FORMAT(4, 5);
 
-CELAPI void cel_log(int level, const char *file, int line, const char *fmt, ...);
+// the lowest level any sink still wants, checked before the call so filtered messages never evaluate their arguments
+CELAPI extern int cel_log_threshold;
+
+// levels below CEL_LOG_MIN_LEVEL compile to nothing, it takes the numeric value of a CELlog_level
+#if !defined(CEL_LOG_MIN_LEVEL)
+    #if defined(NDEBUG)
+        #define CEL_LOG_MIN_LEVEL 2// LOG_INFO
+    #else
+        #define CEL_LOG_MIN_LEVEL 0// LOG_TRACE
+    #endif
+#endif
+
+#define CEL_LOG_AT(level, ...)                                                                   \
+    do {                                                                                         \
+        if ((level) >= cel_log_threshold) { cel_log((level), __FILE__, __LINE__, __VA_ARGS__); } \
+    } while (0)
+
+// every call site owns its counter, so the first of every n hits logs no matter who else logs
+#define CEL_LOG_EVERY_N_AT(level, n, ...)                                                 \
+    do {                                                                                  \
+        LocalPersistent volatile int32_t cel_log_hits_ = 0;                               \
+        if ((level) >= cel_log_threshold &&                                               \
+            (uint32_t) (cel_atomic_add_i32(&cel_log_hits_, 1) - 1) % (uint32_t) (n) == 0) \
+        {                                                                                 \
+            cel_log((level), __FILE__, __LINE__, __VA_ARGS__);                            \
+        }                                                                                 \
+    } while (0)
+
+#define CEL_LOG_ONCE_AT(level, ...)                                                     \
+    do {                                                                                \
+        LocalPersistent volatile int32_t cel_log_done_ = 0;                             \
+        if ((level) >= cel_log_threshold && cel_atomic_load_i32(&cel_log_done_) == 0 && \
+            cel_atomic_cas_i32(&cel_log_done_, 0, 1))                                   \
+        {                                                                               \
+            cel_log((level), __FILE__, __LINE__, __VA_ARGS__);                          \
+        }                                                                               \
+    } while (0)
+
+// never runs, but the compiler still checks the format and sees the arguments used
+#define CEL_LOG_STRIPPED(...)                                           \
+    do {                                                                \
+        if (0) { cel_log(LOG_TRACE, __FILE__, __LINE__, __VA_ARGS__); } \
+    } while (0)
 
 // clang-format off
-#define CEL_TRACE(...)  cel_log(LOG_TRACE,  __FILE__, __LINE__, __VA_ARGS__)
-#define CEL_DEBUG(...)  cel_log(LOG_DEBUG,  __FILE__, __LINE__, __VA_ARGS__)
-#define CEL_INFO(...)   cel_log(LOG_INFO,   __FILE__, __LINE__, __VA_ARGS__)
-#define CEL_WARN(...)   cel_log(LOG_WARN,   __FILE__, __LINE__, __VA_ARGS__)
-#define CEL_ERROR(...)  cel_log(LOG_ERROR,  __FILE__, __LINE__, __VA_ARGS__)
-#define CEL_FATAL(...)  cel_log(LOG_FATAL,  __FILE__, __LINE__, __VA_ARGS__)
+#if CEL_LOG_MIN_LEVEL <= 0
+    #define CEL_TRACE(...)              CEL_LOG_AT(LOG_TRACE, __VA_ARGS__)
+    #define CEL_TRACE_EVERY_N(n, ...)   CEL_LOG_EVERY_N_AT(LOG_TRACE, n, __VA_ARGS__)
+    #define CEL_TRACE_ONCE(...)         CEL_LOG_ONCE_AT(LOG_TRACE, __VA_ARGS__)
+#else
+    #define CEL_TRACE(...)              CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_TRACE_EVERY_N(n, ...)   CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_TRACE_ONCE(...)         CEL_LOG_STRIPPED(__VA_ARGS__)
+#endif
+
+#if CEL_LOG_MIN_LEVEL <= 1
+    #define CEL_DEBUG(...)              CEL_LOG_AT(LOG_DEBUG, __VA_ARGS__)
+    #define CEL_DEBUG_EVERY_N(n, ...)   CEL_LOG_EVERY_N_AT(LOG_DEBUG, n, __VA_ARGS__)
+    #define CEL_DEBUG_ONCE(...)         CEL_LOG_ONCE_AT(LOG_DEBUG, __VA_ARGS__)
+#else
+    #define CEL_DEBUG(...)              CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_DEBUG_EVERY_N(n, ...)   CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_DEBUG_ONCE(...)         CEL_LOG_STRIPPED(__VA_ARGS__)
+#endif
+
+#if CEL_LOG_MIN_LEVEL <= 2
+    #define CEL_INFO(...)               CEL_LOG_AT(LOG_INFO, __VA_ARGS__)
+    #define CEL_INFO_EVERY_N(n, ...)    CEL_LOG_EVERY_N_AT(LOG_INFO, n, __VA_ARGS__)
+    #define CEL_INFO_ONCE(...)          CEL_LOG_ONCE_AT(LOG_INFO, __VA_ARGS__)
+#else
+    #define CEL_INFO(...)               CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_INFO_EVERY_N(n, ...)    CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_INFO_ONCE(...)          CEL_LOG_STRIPPED(__VA_ARGS__)
+#endif
+
+#if CEL_LOG_MIN_LEVEL <= 3
+    #define CEL_WARN(...)               CEL_LOG_AT(LOG_WARN, __VA_ARGS__)
+    #define CEL_WARN_EVERY_N(n, ...)    CEL_LOG_EVERY_N_AT(LOG_WARN, n, __VA_ARGS__)
+    #define CEL_WARN_ONCE(...)          CEL_LOG_ONCE_AT(LOG_WARN, __VA_ARGS__)
+#else
+    #define CEL_WARN(...)               CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_WARN_EVERY_N(n, ...)    CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_WARN_ONCE(...)          CEL_LOG_STRIPPED(__VA_ARGS__)
+#endif
+
+#if CEL_LOG_MIN_LEVEL <= 4
+    #define CEL_ERROR(...)              CEL_LOG_AT(LOG_ERROR, __VA_ARGS__)
+    #define CEL_ERROR_EVERY_N(n, ...)   CEL_LOG_EVERY_N_AT(LOG_ERROR, n, __VA_ARGS__)
+    #define CEL_ERROR_ONCE(...)         CEL_LOG_ONCE_AT(LOG_ERROR, __VA_ARGS__)
+#else
+    #define CEL_ERROR(...)              CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_ERROR_EVERY_N(n, ...)   CEL_LOG_STRIPPED(__VA_ARGS__)
+    #define CEL_ERROR_ONCE(...)         CEL_LOG_STRIPPED(__VA_ARGS__)
+#endif
+
+// fatal is never stripped
+#define CEL_FATAL(...)                  CEL_LOG_AT(LOG_FATAL, __VA_ARGS__)
+#define CEL_FATAL_ONCE(...)             CEL_LOG_ONCE_AT(LOG_FATAL, __VA_ARGS__)
 // clang-format on
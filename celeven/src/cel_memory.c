@@ -1,8 +1,80 @@
 #include <assert.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "cel.h"
 
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+#define CEL_ARENA_COMMIT_SIZE (64 * 1024)// committing less at a time only adds syscalls
+#define CEL_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#define CEL_SCRATCH_ARENA_SIZE (256ull * 1024 * 1024)// reserved per scratch arena, only what a thread touches is committed
+
+GlobalVariable CEL_THREAD_LOCAL CELarena scratch_arenas[CEL_SCRATCH_ARENA_COUNT];
+
+#define CEL_ATOMIC_POOL_EMPTY UINT32_MAX
+#define CEL_ATOMIC_POOL_NO_SLOT UINT32_MAX
+
+enum
+{
+    ATOMIC_POOL_REGISTRY_FREE,
+    ATOMIC_POOL_REGISTRY_CLAIMED,
+    ATOMIC_POOL_REGISTRY_LIVE,
+};
+
+// a thread claims a magazine slot on its first atomic pool call and keeps it until atomic_pool_thread_fini,
+// the same slot in every pool. the magazines of a freed slot are empty, or left for its next owner to use
+GlobalVariable volatile int32_t atomic_pool_slot_bits[CEL_MAX_ATOMIC_POOL_THREAD_COUNT / 32];
+GlobalVariable CEL_THREAD_LOCAL uint32_t atomic_pool_thread_slot;// slot + 1, 0 until claimed
+
+// live pools, so a finishing thread can flush its magazines without tracking which pools it touched
+GlobalVariable CELatomic_pool *atomic_pool_registry[CEL_MAX_ATOMIC_POOL_COUNT];
+GlobalVariable volatile int32_t atomic_pool_registry_states[CEL_MAX_ATOMIC_POOL_COUNT];
+
+#define CEL_TLSF_ALIGNMENT (2 * sizeof(void *))
+#define CEL_TLSF_HEADER_SIZE offsetof(CELtlsf_block, next_free)                   // prev_phys and size, the payload starts right after
+#define CEL_TLSF_MIN_BLOCK_SIZE (sizeof(CELtlsf_block) - CEL_TLSF_HEADER_SIZE)    // room for the free list links
+#define CEL_TLSF_FL_SHIFT (CEL_TLSF_SL_COUNT_LOG2 + (sizeof(void *) == 8 ? 4 : 3))// sizes below 1 << shift split linearly
+#define CEL_TLSF_SMALL_SIZE ((size_t) 1 << CEL_TLSF_FL_SHIFT)
+#define CEL_TLSF_MAX_BLOCK_SIZE (((size_t) 1 << (CEL_TLSF_FL_SHIFT + CEL_TLSF_FL_COUNT - 1)) - CEL_TLSF_ALIGNMENT)
+#define CEL_TLSF_BLOCK_FREE ((size_t) 1)
+
+Internal void *vm_reserve(size_t len, bool huge_pages, bool *commit_populate);
+Internal bool vm_commit(void *ptr, size_t len, bool populate);
+Internal void vm_decommit(void *ptr, size_t len);
+Internal void vm_release(void *ptr, size_t len);
+Internal size_t vm_page_size();
+
+Internal bool arena_fit(CELarena *a, size_t end);
+
+Internal uint32_t atomic_pool_slot_get();
+Internal uint32_t *atomic_pool_next(CELatomic_pool *p, uint32_t chunk);
+Internal uint32_t atomic_pool_pop_batch(CELatomic_pool *p, uint32_t *chunks, uint32_t count);
+Internal void atomic_pool_push_batch(CELatomic_pool *p, const uint32_t *chunks, uint32_t count);
+
+Internal uint32_t slab_class_index(size_t len);
+Internal size_t slab_class_size(uint32_t index);
+Internal CELslab_page *slab_page_of(void *ptr);
+Internal CELslab_page *slab_page_acquire(CELslab *s, uint32_t class_index);
+Internal void slab_page_link(CELslab_class *size_class, CELslab_page *page);
+Internal void slab_page_unlink(CELslab_class *size_class, CELslab_page *page);
+
+Internal uint32_t tlsf_fls(size_t x);
+Internal uint32_t tlsf_ffs(uint32_t x);
+Internal size_t tlsf_adjust_size(size_t len);
+Internal void tlsf_mapping(size_t size, uint32_t *fl, uint32_t *sl);
+Internal CELtlsf_block *tlsf_block_next(CELtlsf_block *block);
+Internal void tlsf_block_insert(CELtlsf *t, CELtlsf_block *block);
+Internal void tlsf_block_remove(CELtlsf *t, CELtlsf_block *block);
+Internal CELtlsf_block *tlsf_block_find(CELtlsf *t, size_t size);
+Internal void tlsf_block_trim(CELtlsf *t, CELtlsf_block *block, size_t size);
+
 Internal uintptr_t align_forward(uintptr_t ptr, size_t align) {
     uintptr_t p, a, mod;
     assert(is_power_of_two(align));
@@ -24,10 +96,39 @@ Internal size_t calc_padding_with_header(uintptr_t ptr, uintptr_t alignment, siz
 }
 
 void arena_init(CELarena *a, void *backing_buffer, size_t backing_buffer_len) {
-    a->buf         = (unsigned char *) backing_buffer;
-    a->buf_len     = backing_buffer_len;
-    a->prev_offset = 0;
-    a->curr_offset = 0;
+    a->buf                = (unsigned char *) backing_buffer;
+    a->buf_len            = backing_buffer_len;
+    a->prev_offset        = 0;
+    a->curr_offset        = 0;
+    a->reserve_len        = 0;
+    a->commit_granularity = 0;
+}
+
+bool arena_init_virtual(CELarena *a, size_t reserve_len, uint32_t flags) {
+    bool huge_pages    = (flags & CEL_ARENA_HUGE_PAGES) != 0;
+    size_t granularity = huge_pages ? CEL_ARENA_HUGE_PAGE_SIZE : CEL_ARENA_COMMIT_SIZE;
+    size_t page_size   = vm_page_size();
+    if (granularity < page_size) { granularity = page_size; }
+    reserve_len = align_forward(reserve_len, granularity);
+
+    // only address space is taken here, nothing is resident until an allocation commits it
+    bool commit_populate = false;
+    void *base           = vm_reserve(reserve_len, huge_pages, &commit_populate);
+    if (!base) { return false; }
+
+    a->buf                = (unsigned char *) base;
+    a->buf_len            = 0;
+    a->prev_offset        = 0;
+    a->curr_offset        = 0;
+    a->reserve_len        = reserve_len;
+    a->commit_granularity = granularity;
+    a->commit_populate    = commit_populate;
+    return true;
+}
+
+void arena_fini(CELarena *a) {
+    if (a->reserve_len) { vm_release(a->buf, a->reserve_len); }
+    *a = (CELarena){0};
 }
 
 void *arena_alloc(CELarena *a, size_t len) {
@@ -40,8 +141,8 @@ void *arena_alloc_align(CELarena *a, size_t len, size_t align) {
     uintptr_t offset   = align_forward(curr_ptr, align);
     offset -= (uintptr_t) a->buf;
 
-    // check to see if the backing memory has space left
-    if (offset + len <= a->buf_len)
+    // check to see if the backing memory has space left, a virtual arena commits more of its range
+    if (offset + len <= a->buf_len || arena_fit(a, offset + len))
     {
         void *ptr      = &a->buf[offset];
         a->prev_offset = offset;
@@ -70,15 +171,17 @@ void *arena_resize_align(CELarena *a, void *oldmem, size_t osize, size_t nsize,
     }
     else if (a->buf <= old_mem && old_mem < a->buf + a->buf_len)
     {
-        if (a->buf + a->prev_offset == old_mem)
+        if (a->buf + a->prev_offset == old_mem && arena_fit(a, a->prev_offset + nsize))
         {
             a->curr_offset = a->prev_offset + nsize;
-            if (nsize > osize) { memset(&a->buf[a->curr_offset], 0, nsize - osize); }
+            if (nsize > osize) { memset(&a->buf[a->prev_offset + osize], 0, nsize - osize); }
             return old_mem;
         }
     }
 
-    void *new_mem    = arena_alloc(a, nsize);
+    void *new_mem = arena_alloc_align(a, nsize, align);
+    if (!new_mem) { return NULL; }
+
     size_t copy_size = osize < nsize ? osize : nsize;
     memmove(new_mem, oldmem, copy_size);
     return new_mem;
@@ -92,18 +195,186 @@ void arena_free(CELarena *a, void *ptr) {
 void arena_free_all(CELarena *a) {
     a->prev_offset = 0;
     a->curr_offset = 0;
+
+    // hand the pages back, the range stays reserved and commits again on demand
+    if (a->reserve_len && a->buf_len)
+    {
+        vm_decommit(a->buf, a->buf_len);
+        a->buf_len = 0;
+    }
+}
+
+CELarena_temp arena_temp_begin(CELarena *a) {
+    CELarena_temp temp = {.arena = a, .prev_offset = a->prev_offset, .curr_offset = a->curr_offset};
+    return temp;
+}
+
+void arena_temp_end(CELarena_temp temp) {
+    // pages stay committed, a scope that is reopened every frame would otherwise fault them back in each time
+    assert(temp.curr_offset <= temp.arena->curr_offset && "arena temp scopes must end in reverse order");
+    temp.arena->prev_offset = temp.prev_offset;
+    temp.arena->curr_offset = temp.curr_offset;
+}
+
+CELarena_temp arena_scratch_get(CELarena *const *conflicts, uint32_t conflict_count) {
+    for (uint32_t i = 0; i < CEL_SCRATCH_ARENA_COUNT; ++i)
+    {
+        CELarena *arena = &scratch_arenas[i];
+
+        bool conflicting = false;
+        for (uint32_t j = 0; j < conflict_count && !conflicting; ++j)
+        {
+            conflicting = conflicts[j] == arena;
+        }
+        if (conflicting) { continue; }
+
+        if (!arena->reserve_len && !arena_init_virtual(arena, CEL_SCRATCH_ARENA_SIZE, 0))
+        {
+            assert(false && "failed to reserve a scratch arena");
+            return (CELarena_temp){0};
+        }
+        return arena_temp_begin(arena);
+    }
+
+    assert(false && "every scratch arena conflicts, raise CEL_SCRATCH_ARENA_COUNT");
+    return (CELarena_temp){0};
+}
+
+void arena_scratch_release(CELarena_temp scratch) {
+    if (scratch.arena) { arena_temp_end(scratch); }
+}
+
+void arena_scratch_fini() {
+    for (uint32_t i = 0; i < CEL_SCRATCH_ARENA_COUNT; ++i)
+    {
+        arena_fini(&scratch_arenas[i]);
+    }
 }
 
 void arena_debug_print(CELarena *a, const char *label) {
     printf("[Arena: %s]\n", label);
     printf("- Buffer Address:      %p\n", a->buf);
     printf("- Buffer Size:         %zu bytes\n", a->buf_len);
+    printf("- Reserved Size:       %zu bytes\n", a->reserve_len);
     printf("- Previous Offset:     %zu\n", a->prev_offset);
     printf("- Current Offset:      %zu\n", a->curr_offset);
     printf("- Used Memory:         %zu bytes\n", a->curr_offset);
     printf("- Remaining Memory:    %zu bytes\n\n", a->buf_len - a->curr_offset);
 }
 
+bool arena_fit(CELarena *a, size_t end) {
+    if (end <= a->buf_len) { return true; }
+    if (end > a->reserve_len) { return false; }
+
+    size_t commit_len = align_forward(end, a->commit_granularity);
+    if (commit_len > a->reserve_len) { commit_len = a->reserve_len; }
+    if (!vm_commit(a->buf + a->buf_len, commit_len - a->buf_len, a->commit_populate)) { return false; }
+
+    a->buf_len = commit_len;
+    return true;
+}
+
+#if defined(_WIN32)
+
+// large pages on windows must be committed up front and need SeLockMemoryPrivilege, so the flag is ignored there
+void *vm_reserve(size_t len, bool huge_pages, bool *commit_populate) {
+    (void) huge_pages;
+    *commit_populate = false;
+    return VirtualAlloc(NULL, len, MEM_RESERVE, PAGE_NOACCESS);
+}
+
+bool vm_commit(void *ptr, size_t len, bool populate) {
+    (void) populate;
+    return VirtualAlloc(ptr, len, MEM_COMMIT, PAGE_READWRITE) != NULL;
+}
+
+void vm_decommit(void *ptr, size_t len) {
+    VirtualFree(ptr, len, MEM_DECOMMIT);
+}
+
+void vm_release(void *ptr, size_t len) {
+    (void) len;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+size_t vm_page_size() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t) info.dwPageSize;
+}
+
+#else
+
+void *vm_reserve(size_t len, bool huge_pages, bool *commit_populate) {
+    *commit_populate = false;
+
+    #if defined(MAP_HUGETLB) && defined(MADV_POPULATE_WRITE)
+    // explicit huge pages only exist if the admin set a pool aside, otherwise fall back to transparent ones.
+    // the range is not charged to the pool up front, commits fault their pages in and fail if the pool runs short.
+    // the first page is committed as a probe, which also catches kernels without MADV_POPULATE_WRITE
+    if (huge_pages)
+    {
+        void *ptr = mmap(NULL, len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_NORESERVE, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+            if (vm_commit(ptr, CEL_ARENA_HUGE_PAGE_SIZE, true))
+            {
+                vm_decommit(ptr, CEL_ARENA_HUGE_PAGE_SIZE);
+                *commit_populate = true;
+                return ptr;
+            }
+            munmap(ptr, len);
+        }
+    }
+    #endif
+
+    // over reserve so the range can be trimmed to a huge page boundary, thp only backs aligned 2 MiB spans
+    size_t slack = huge_pages ? CEL_ARENA_HUGE_PAGE_SIZE : 0;
+    void *ptr    = mmap(NULL, len + slack, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (ptr == MAP_FAILED) { return NULL; }
+    if (!huge_pages) { return ptr; }
+
+    uintptr_t start   = (uintptr_t) ptr;
+    uintptr_t aligned = align_forward(start, CEL_ARENA_HUGE_PAGE_SIZE);
+    if (aligned > start) { munmap(ptr, aligned - start); }
+    if (aligned + len < start + len + slack) { munmap((void *) (aligned + len), start + slack - aligned); }
+    #if defined(MADV_HUGEPAGE)
+    madvise((void *) aligned, len, MADV_HUGEPAGE);
+    #endif
+    return (void *) aligned;
+}
+
+bool vm_commit(void *ptr, size_t len, bool populate) {
+    if (mprotect(ptr, len, PROT_READ | PROT_WRITE) != 0) { return false; }
+
+    #if defined(MADV_POPULATE_WRITE)
+    if (populate && madvise(ptr, len, MADV_POPULATE_WRITE) != 0)
+    {
+        vm_decommit(ptr, len);
+        return false;
+    }
+    #else
+    (void) populate;
+    #endif
+    return true;
+}
+
+void vm_decommit(void *ptr, size_t len) {
+    madvise(ptr, len, MADV_DONTNEED);
+    mprotect(ptr, len, PROT_NONE);
+}
+
+void vm_release(void *ptr, size_t len) {
+    munmap(ptr, len);
+}
+
+size_t vm_page_size() {
+    long page_size = sysconf(_SC_PAGESIZE);
+    return page_size > 0 ? (size_t) page_size : 4096;
+}
+
+#endif// _WIN32
+
 void stack_init(CELstack *s, void *backing_buffer, size_t backing_buffer_len) {
     s->buf         = (unsigned char *) backing_buffer;
     s->buf_len     = backing_buffer_len;
@@ -225,41 +496,62 @@ void pool_init(CELpool *p, void *backing_buffer, size_t backing_buffer_len, size
     assert(chunk_size >= sizeof(CELpool_free_node) && "chunk size is to small");
     assert(backing_buffer_len >= chunk_size && "backing buffer len is smaller than the chunk size");
 
-    p->buf        = (unsigned char *) backing_buffer;
-    p->buf_len    = backing_buffer_len;
-    p->chunk_size = chunk_size;
-    p->head       = NULL;
+    p->buf             = (unsigned char *) start;
+    p->buf_len         = backing_buffer_len;
+    p->chunk_size      = chunk_size;
+    p->chunk_alignment = chunk_alignment;
+    p->chunk_count     = backing_buffer_len / chunk_size;
+    p->used_count      = 0;
+    p->head            = NULL;
+
+    pool_free_all(p);
 }
 
 void *pool_alloc(CELpool *p, size_t len) {
+    assert(len <= p->chunk_size && "pool allocation is larger than the chunk size");
     CELpool_free_node *node = p->head;
-    if (node == NULL)
+    if (node != NULL) { p->head = node->next; }// pop free node
+    else if (p->fresh_index < p->chunk_count) { node = (CELpool_free_node *) &p->buf[p->fresh_index++ * p->chunk_size]; }
+    else
     {
         assert(false && "pool allocator has no free memory");
         return NULL;
     }
 
-    p->head = p->head->next;// pop free node
+    p->used_count++;
     return memset(node, 0, p->chunk_size);
 }
 
 void *pool_alloc_align(CELpool *p, size_t len, size_t align) {
-    return NULL;
+    // every chunk is aligned to the pool's chunk alignment, a stricter one cannot be served
+    assert(is_power_of_two(align));
+    if (align > p->chunk_alignment || len > p->chunk_size) { return NULL; }
+    return pool_alloc(p, len);
 }
 
 void *pool_resize(CELpool *p, void *oldmem, size_t osize, size_t nsize) {
-    return NULL;
+    return pool_resize_align(p, oldmem, osize, nsize, p->chunk_alignment);
 }
 
 void *pool_resize_align(CELpool *p, void *oldmem, size_t osize, size_t nsize, size_t align) {
-    return NULL;
+    if (oldmem == NULL) { return pool_alloc_align(p, nsize, align); }
+    if (nsize == 0)
+    {
+        pool_free(p, oldmem);
+        return NULL;
+    }
+
+    // a chunk never moves, any size up to the chunk size resizes in place
+    if (nsize > p->chunk_size || align > p->chunk_alignment) { return NULL; }
+    if (nsize > osize) { memset((unsigned char *) oldmem + osize, 0, nsize - osize); }
+    return oldmem;
 }
 
 void pool_free(CELpool *p, void *ptr) {
     CELpool_free_node *node;
 
     void *start = p->buf;
-    void *end   = &p->buf[p->buf_len];
+    void *end   = &p->buf[p->chunk_count * p->chunk_size];
 
     if (ptr == NULL) { return; }
     if (!(start <= ptr && ptr < end))
@@ -267,21 +559,742 @@ void pool_free(CELpool *p, void *ptr) {
         assert(false && "memory is out of bounds of the buffer in this pool (free)");
         return;
     }
+    assert(((unsigned char *) ptr - p->buf) % p->chunk_size == 0 && "pointer is not the start of a chunk in this pool (free)");
 
     node       = (CELpool_free_node *) ptr;
     node->next = p->head;
     p->head    = node;
+    p->used_count--;
 }
 
 void pool_free_all(CELpool *p) {
-    size_t chunk_count = p->buf_len / p->chunk_size;
-    size_t i;
+    // nothing is linked up front, alloc bumps through untouched chunks in address order once the list runs dry
+    p->head        = NULL;
+    p->fresh_index = 0;
+    p->used_count  = 0;
+}
+
+void pool_debug_print(CELpool *p, const char *label) {
+    printf("[Pool: %s]\n", label);
+    printf("- Buffer Address:      %p\n", p->buf);
+    printf("- Chunk Size:          %zu bytes\n", p->chunk_size);
+    printf("- Chunks Used:         %zu / %zu\n\n", p->used_count, p->chunk_count);
+}
+
+void atomic_pool_init(CELatomic_pool *p, void *backing_buffer, size_t backing_buffer_len, size_t chunk_size, size_t chunk_alignment) {
+    uintptr_t initial_start = (uintptr_t) backing_buffer;
+    uintptr_t start         = align_forward(initial_start, (uintptr_t) chunk_alignment);
+    backing_buffer_len -= (size_t) (start - initial_start);
+
+    chunk_size = align_forward(chunk_size, chunk_alignment);
+    assert(chunk_size >= sizeof(uint32_t) && "chunk size is to small");
+    assert(backing_buffer_len / chunk_size < CEL_ATOMIC_POOL_EMPTY && "too many chunks for 32 bit indices");
 
-    for (i = 0; i < chunk_count; ++i)
+    memset(p, 0, sizeof(*p));
+    p->buf         = (unsigned char *) start;
+    p->chunk_size  = chunk_size;
+    p->chunk_count = (uint32_t) (backing_buffer_len / chunk_size);
+
+    // chained in address order, nobody can see the pool before init returns so plain stores do
+    for (uint32_t i = 0; i < p->chunk_count; ++i)
     {
-        pool_free(p, &p->buf[i * p->chunk_size]);
+        *atomic_pool_next(p, i) = i + 1 < p->chunk_count ? i + 1 : CEL_ATOMIC_POOL_EMPTY;
     }
+    cel_atomic_store_i64(&p->head, p->chunk_count ? 0 : CEL_ATOMIC_POOL_EMPTY);
+
+    // the pointer is published before the state, a thread that sees the pool live sees the pool
+    p->registry_index = -1;
+    for (int32_t i = 0; i < CEL_MAX_ATOMIC_POOL_COUNT && p->registry_index < 0; ++i)
+    {
+        if (!cel_atomic_cas_i32(&atomic_pool_registry_states[i], ATOMIC_POOL_REGISTRY_FREE, ATOMIC_POOL_REGISTRY_CLAIMED)) { continue; }
+        atomic_pool_registry[i] = p;
+        cel_atomic_store_i32(&atomic_pool_registry_states[i], ATOMIC_POOL_REGISTRY_LIVE);
+        p->registry_index = i;
+    }
+    assert(p->registry_index >= 0 && "too many live atomic pools, atomic_pool_thread_fini will not flush this one");
 }
 
-void pool_debug_print(CELpool *p, const char *label) {
+void atomic_pool_fini(CELatomic_pool *p) {
+    if (p->registry_index < 0) { return; }
+    cel_atomic_store_i32(&atomic_pool_registry_states[p->registry_index], ATOMIC_POOL_REGISTRY_FREE);
+    p->registry_index = -1;
+}
+
+void *atomic_pool_alloc(CELatomic_pool *p) {
+    uint32_t chunk = CEL_ATOMIC_POOL_EMPTY;
+    uint32_t slot  = atomic_pool_slot_get();
+    if (slot == CEL_ATOMIC_POOL_NO_SLOT) { atomic_pool_pop_batch(p, &chunk, 1); }
+    else
+    {
+        // an empty magazine refills half way, so a following free does not spill straight back
+        CELatomic_pool_magazine *magazine = &p->magazines[slot];
+        if (magazine->count == 0) { magazine->count = atomic_pool_pop_batch(p, magazine->chunks, CEL_ATOMIC_POOL_MAGAZINE_SIZE / 2 + 1); }
+        if (magazine->count > 0) { chunk = magazine->chunks[--magazine->count]; }
+    }
+
+    if (chunk == CEL_ATOMIC_POOL_EMPTY)
+    {
+        assert(false && "atomic pool has no free memory");
+        return NULL;
+    }
+    return memset(&p->buf[(size_t) chunk * p->chunk_size], 0, p->chunk_size);
+}
+
+void atomic_pool_free(CELatomic_pool *p, void *ptr) {
+    if (ptr == NULL) { return; }
+
+    unsigned char *start = p->buf;
+    unsigned char *end   = &p->buf[(size_t) p->chunk_count * p->chunk_size];
+    if (!(start <= (unsigned char *) ptr && (unsigned char *) ptr < end))
+    {
+        assert(false && "memory is out of bounds of the buffer in this pool (free)");
+        return;
+    }
+    assert(((unsigned char *) ptr - p->buf) % p->chunk_size == 0 && "pointer is not the start of a chunk in this pool (free)");
+
+    uint32_t chunk = (uint32_t) (((unsigned char *) ptr - p->buf) / p->chunk_size);
+    uint32_t slot  = atomic_pool_slot_get();
+    if (slot == CEL_ATOMIC_POOL_NO_SLOT)
+    {
+        atomic_pool_push_batch(p, &chunk, 1);
+        return;
+    }
+
+    // a full magazine spills its older half, keeping the recently freed and still cached chunks local
+    CELatomic_pool_magazine *magazine = &p->magazines[slot];
+    if (magazine->count == CEL_ATOMIC_POOL_MAGAZINE_SIZE)
+    {
+        uint32_t spill = CEL_ATOMIC_POOL_MAGAZINE_SIZE / 2;
+        atomic_pool_push_batch(p, magazine->chunks, spill);
+        memmove(magazine->chunks, &magazine->chunks[spill], sizeof(uint32_t) * (magazine->count - spill));
+        magazine->count -= spill;
+    }
+    magazine->chunks[magazine->count++] = chunk;
+}
+
+void atomic_pool_flush(CELatomic_pool *p) {
+    uint32_t slot = atomic_pool_slot_get();
+    if (slot == CEL_ATOMIC_POOL_NO_SLOT) { return; }
+
+    CELatomic_pool_magazine *magazine = &p->magazines[slot];
+    atomic_pool_push_batch(p, magazine->chunks, magazine->count);
+    magazine->count = 0;
+}
+
+void atomic_pool_thread_fini() {
+    if (atomic_pool_thread_slot == 0) { return; }
+    if (atomic_pool_thread_slot == CEL_ATOMIC_POOL_NO_SLOT)
+    {
+        atomic_pool_thread_slot = 0;
+        return;
+    }
+
+    for (uint32_t i = 0; i < CEL_MAX_ATOMIC_POOL_COUNT; ++i)
+    {
+        if (cel_atomic_load_i32(&atomic_pool_registry_states[i]) == ATOMIC_POOL_REGISTRY_LIVE) { atomic_pool_flush(atomic_pool_registry[i]); }
+    }
+
+    // the cas orders the flushed magazines before the slot can be claimed again
+    uint32_t slot          = atomic_pool_thread_slot - 1;
+    volatile int32_t *word = &atomic_pool_slot_bits[slot / 32];
+    int32_t bits           = cel_atomic_load_i32(word);
+    while (!cel_atomic_cas_i32(word, bits, (int32_t) ((uint32_t) bits & ~(1u << (slot % 32))))) { bits = cel_atomic_load_i32(word); }
+    atomic_pool_thread_slot = 0;
+}
+
+uint32_t atomic_pool_slot_get() {
+    if (atomic_pool_thread_slot == 0)
+    {
+        atomic_pool_thread_slot = CEL_ATOMIC_POOL_NO_SLOT;
+        for (uint32_t w = 0; w < CEL_MAX_ATOMIC_POOL_THREAD_COUNT / 32 && atomic_pool_thread_slot == CEL_ATOMIC_POOL_NO_SLOT; ++w)
+        {
+            volatile int32_t *word = &atomic_pool_slot_bits[w];
+            int32_t bits           = cel_atomic_load_i32(word);
+            for (uint32_t bit = 0; bit < 32; ++bit)
+            {
+                if ((uint32_t) bits & (1u << bit)) { continue; }
+                if (cel_atomic_cas_i32(word, bits, (int32_t) ((uint32_t) bits | (1u << bit))))
+                {
+                    atomic_pool_thread_slot = w * 32 + bit + 1;
+                    break;
+                }
+
+                // lost the word to another thread, rescan it from the start
+                bits = cel_atomic_load_i32(word);
+                bit  = UINT32_MAX;
+            }
+        }
+    }
+    return atomic_pool_thread_slot == CEL_ATOMIC_POOL_NO_SLOT ? CEL_ATOMIC_POOL_NO_SLOT : atomic_pool_thread_slot - 1;
+}
+
+uint32_t *atomic_pool_next(CELatomic_pool *p, uint32_t chunk) {
+    return (uint32_t *) &p->buf[(size_t) chunk * p->chunk_size];
+}
+
+uint32_t atomic_pool_pop_batch(CELatomic_pool *p, uint32_t *chunks, uint32_t count) {
+    for (;;)
+    {
+        int64_t head   = cel_atomic_load_i64(&p->head);
+        uint32_t tag   = (uint32_t) ((uint64_t) head >> 32);
+        uint32_t chunk = (uint32_t) head;
+
+        // the walk may read chunks another thread has already popped and is writing to, but then the
+        // head has moved on and the cas fails, since chunks are never unmapped a stale read is harmless
+        // a stale walk can also read user data as an index, it must not be followed
+        uint32_t popped = 0;
+        bool stale      = false;
+        while (popped < count && chunk != CEL_ATOMIC_POOL_EMPTY && !stale)
+        {
+            chunks[popped++] = chunk;
+            chunk            = (uint32_t) cel_atomic_load_i32((volatile int32_t *) atomic_pool_next(p, chunk));
+            stale            = chunk != CEL_ATOMIC_POOL_EMPTY && chunk >= p->chunk_count;
+        }
+        if (popped == 0) { return 0; }
+
+        int64_t next = (int64_t) (((uint64_t) (tag + 1) << 32) | chunk);
+        if (!stale && cel_atomic_cas_i64(&p->head, head, next)) { return popped; }
+        cel_cpu_pause();
+    }
+}
+
+void atomic_pool_push_batch(CELatomic_pool *p, const uint32_t *chunks, uint32_t count) {
+    if (count == 0) { return; }
+
+    // the chunks are still private, so they are linked once and only the tail is repointed per attempt
+    for (uint32_t i = 0; i + 1 < count; ++i)
+    {
+        *atomic_pool_next(p, chunks[i]) = chunks[i + 1];
+    }
+
+    uint32_t *tail_next = atomic_pool_next(p, chunks[count - 1]);
+    for (;;)
+    {
+        int64_t head = cel_atomic_load_i64(&p->head);
+        uint32_t tag = (uint32_t) ((uint64_t) head >> 32);
+        cel_atomic_store_i32((volatile int32_t *) tail_next, (int32_t) (uint32_t) head);
+
+        int64_t next = (int64_t) (((uint64_t) (tag + 1) << 32) | chunks[0]);
+        if (cel_atomic_cas_i64(&p->head, head, next)) { return; }
+        cel_cpu_pause();
+    }
+}
+
+void slab_init(CELslab *s, CELarena *backing) {
+    memset(s, 0, sizeof(*s));
+    s->backing = backing;
+    for (uint32_t i = 0; i < CEL_SLAB_CLASS_COUNT; ++i)
+    {
+        s->classes[i].chunk_size = slab_class_size(i);
+    }
+}
+
+void *slab_alloc(CELslab *s, size_t len) {
+    if (len == 0 || len > CEL_SLAB_MAX_SIZE) { return NULL; }
+
+    CELslab_class *size_class = &s->classes[slab_class_index(len)];
+    CELslab_page *page        = size_class->partial;
+    if (page == NULL)
+    {
+        page = slab_page_acquire(s, (uint32_t) (size_class - s->classes));
+        if (page == NULL) { return NULL; }
+        slab_page_link(size_class, page);
+    }
+
+    void *ptr = pool_alloc(&page->pool, len);
+    size_class->used_count++;
+    if (page->pool.used_count == page->pool.chunk_count) { slab_page_unlink(size_class, page); }// full, nothing left to hand out
+    return ptr;
+}
+
+void *slab_alloc_align(CELslab *s, size_t len, size_t align) {
+    assert(is_power_of_two(align));
+    if (align <= DEFAULT_ALIGNMENT) { return slab_alloc(s, len); }
+
+    // power of two classes start their chunks at a multiple of their size, so rounding up to one aligns the chunk
+    size_t size = len > align ? len : align;
+    size_t pow2 = 64;
+    while (pow2 < size) { pow2 <<= 1; }
+    return slab_alloc(s, pow2);
+}
+
+void *slab_resize(CELslab *s, void *oldmem, size_t osize, size_t nsize) {
+    if (oldmem == NULL) { return slab_alloc(s, nsize); }
+    if (nsize == 0)
+    {
+        slab_free(s, oldmem);
+        return NULL;
+    }
+
+    CELslab_page *page = slab_page_of(oldmem);
+    if (nsize <= page->pool.chunk_size) { return pool_resize(&page->pool, oldmem, osize, nsize); }
+
+    void *new_mem = slab_alloc(s, nsize);
+    if (new_mem == NULL) { return NULL; }
+
+    memcpy(new_mem, oldmem, osize < nsize ? osize : nsize);
+    slab_free(s, oldmem);
+    return new_mem;
+}
+
+void slab_free(CELslab *s, void *ptr) {
+    if (ptr == NULL) { return; }
+
+    CELslab_page *page        = slab_page_of(ptr);
+    CELslab_class *size_class = &s->classes[page->class_index];
+    bool was_full             = page->pool.used_count == page->pool.chunk_count;
+
+    pool_free(&page->pool, ptr);
+    size_class->used_count--;
+
+    if (page->pool.used_count == 0)
+    {
+        // an empty page can serve any class, keeping it here would pin it to this one
+        if (!was_full) { slab_page_unlink(size_class, page); }
+        size_class->page_count--;
+        size_class->chunk_count -= page->pool.chunk_count;
+        page->next    = s->free_pages;
+        s->free_pages = page;
+    }
+    else if (was_full) { slab_page_link(size_class, page); }
+}
+
+void slab_debug_print(CELslab *s, const char *label) {
+    printf("[Slab: %s]\n", label);
+    printf("- Pages:               %zu (%zu bytes)\n", s->page_count, s->page_count * CEL_SLAB_PAGE_SIZE);
+    for (uint32_t i = 0; i < CEL_SLAB_CLASS_COUNT; ++i)
+    {
+        CELslab_class *size_class = &s->classes[i];
+        if (size_class->page_count == 0) { continue; }
+        printf("- %4zu bytes:          %zu / %zu chunks in %zu pages\n", size_class->chunk_size, size_class->used_count, size_class->chunk_count, size_class->page_count);
+    }
+    printf("\n");
+}
+
+uint32_t slab_class_index(size_t len) {
+    if (len <= 64) { return len <= 16 ? 0 : (uint32_t) ((len - 1) / 16); }
+
+    // the top two bits below the leading one pick the quarter of the power of two range
+    size_t t   = len - 1;
+    uint32_t e = 0;
+    while ((t >> (e + 1)) != 0) { e++; }
+    uint32_t k = (uint32_t) (t >> (e - 2)) - 3;
+    return 3 + (e - 6) * 4 + k;
+}
+
+size_t slab_class_size(uint32_t index) {
+    if (index < 4) { return (index + 1) * 16; }
+
+    uint32_t j = index - 4;
+    uint32_t e = 6 + j / 4;
+    uint32_t k = j % 4 + 1;
+    return (size_t) (4 + k) << (e - 2);
+}
+
+CELslab_page *slab_page_of(void *ptr) {
+    return (CELslab_page *) ((uintptr_t) ptr & ~(uintptr_t) (CEL_SLAB_PAGE_SIZE - 1));
+}
+
+CELslab_page *slab_page_acquire(CELslab *s, uint32_t class_index) {
+    CELslab_page *page = s->free_pages;
+    if (page) { s->free_pages = page->next; }
+    else
+    {
+        page = arena_alloc_align(s->backing, CEL_SLAB_PAGE_SIZE, CEL_SLAB_PAGE_SIZE);
+        if (page == NULL) { return NULL; }
+        s->page_count++;
+    }
+
+    // chunks start at a multiple of the largest power of two dividing the class size, up to a page
+    size_t chunk_size  = s->classes[class_index].chunk_size;
+    size_t chunk_align = chunk_size & (~chunk_size + 1);
+    size_t offset      = align_forward(sizeof(CELslab_page), chunk_align);
+
+    page->class_index = class_index;
+    page->prev        = NULL;
+    page->next        = NULL;
+    pool_init(&page->pool, (unsigned char *) page + offset, CEL_SLAB_PAGE_SIZE - offset, chunk_size, DEFAULT_ALIGNMENT);
+
+    s->classes[class_index].page_count++;
+    s->classes[class_index].chunk_count += page->pool.chunk_count;
+    return page;
+}
+
+void slab_page_link(CELslab_class *size_class, CELslab_page *page) {
+    page->prev = NULL;
+    page->next = size_class->partial;
+    if (size_class->partial) { size_class->partial->prev = page; }
+    size_class->partial = page;
+}
+
+void slab_page_unlink(CELslab_class *size_class, CELslab_page *page) {
+    if (page->prev) { page->prev->next = page->next; }
+    else { size_class->partial = page->next; }
+    if (page->next) { page->next->prev = page->prev; }
+    page->prev = NULL;
+    page->next = NULL;
+}
+
+void tlsf_init(CELtlsf *t, void *backing_buffer, size_t backing_buffer_len) {
+    memset(t, 0, sizeof(*t));
+
+    uintptr_t start = align_forward((uintptr_t) backing_buffer, CEL_TLSF_ALIGNMENT);
+    uintptr_t end   = ((uintptr_t) backing_buffer + backing_buffer_len) & ~(uintptr_t) (CEL_TLSF_ALIGNMENT - 1);
+    if (end < start + 2 * CEL_TLSF_HEADER_SIZE + CEL_TLSF_MIN_BLOCK_SIZE)
+    {
+        assert(false && "tlsf backing buffer is too small");
+        return;
+    }
+
+    // one free block spans the region, a zero sized block in use at the end keeps it from merging past it
+    size_t size = (size_t) (end - start) - 2 * CEL_TLSF_HEADER_SIZE;
+    if (size > CEL_TLSF_MAX_BLOCK_SIZE) { size = CEL_TLSF_MAX_BLOCK_SIZE; }
+
+    CELtlsf_block *block = (CELtlsf_block *) start;
+    block->prev_phys     = NULL;
+    block->size          = size;
+
+    CELtlsf_block *sentinel = tlsf_block_next(block);
+    sentinel->prev_phys     = block;
+    sentinel->size          = 0;
+
+    t->buf     = (unsigned char *) start;
+    t->buf_len = size + 2 * CEL_TLSF_HEADER_SIZE;
+
+    block->size |= CEL_TLSF_BLOCK_FREE;
+    tlsf_block_insert(t, block);
+}
+
+void *tlsf_alloc(CELtlsf *t, size_t len) {
+    return tlsf_alloc_align(t, len, DEFAULT_ALIGNMENT);
+}
+
+void *tlsf_alloc_align(CELtlsf *t, size_t len, size_t align) {
+    assert(is_power_of_two(align));
+    if (len == 0 || len > CEL_TLSF_MAX_BLOCK_SIZE) { return NULL; }
+
+    // a stricter alignment asks for enough extra to cut a free block off the front
+    size_t size     = tlsf_adjust_size(len);
+    size_t gap_min  = CEL_TLSF_HEADER_SIZE + CEL_TLSF_MIN_BLOCK_SIZE;
+    bool over_align = align > CEL_TLSF_ALIGNMENT;
+
+    CELtlsf_block *block = tlsf_block_find(t, over_align ? size + align + gap_min : size);
+    if (block == NULL) { return NULL; }
+    block->size &= ~CEL_TLSF_BLOCK_FREE;
+
+    if (over_align)
+    {
+        uintptr_t payload = (uintptr_t) block + CEL_TLSF_HEADER_SIZE;
+        uintptr_t aligned = align_forward(payload, align);
+        if (aligned != payload && aligned - payload < gap_min) { aligned = align_forward(payload + gap_min, align); }
+
+        size_t gap = (size_t) (aligned - payload);
+        if (gap != 0)
+        {
+            // the block before this one is in use, so the gap has nothing to merge with
+            CELtlsf_block *aligned_block = (CELtlsf_block *) (aligned - CEL_TLSF_HEADER_SIZE);
+            aligned_block->prev_phys     = block;
+            aligned_block->size          = block->size - gap;
+
+            tlsf_block_next(aligned_block)->prev_phys = aligned_block;
+
+            block->size = (gap - CEL_TLSF_HEADER_SIZE) | CEL_TLSF_BLOCK_FREE;
+            tlsf_block_insert(t, block);
+            block = aligned_block;
+        }
+    }
+
+    tlsf_block_trim(t, block, size);
+    t->used_len += block->size;
+    t->used_count++;
+
+    // zero new memory by default
+    return memset((unsigned char *) block + CEL_TLSF_HEADER_SIZE, 0, len);
+}
+
+void *tlsf_resize(CELtlsf *t, void *oldmem, size_t osize, size_t nsize) {
+    if (oldmem == NULL) { return tlsf_alloc(t, nsize); }
+    if (nsize == 0)
+    {
+        tlsf_free(t, oldmem);
+        return NULL;
+    }
+    if (nsize > CEL_TLSF_MAX_BLOCK_SIZE) { return NULL; }
+
+    CELtlsf_block *block = (CELtlsf_block *) ((unsigned char *) oldmem - CEL_TLSF_HEADER_SIZE);
+    size_t size          = tlsf_adjust_size(nsize);
+    size_t block_size    = block->size;
+    assert(!(block_size & CEL_TLSF_BLOCK_FREE) && "memory was already freed in this tlsf (resize)");
+
+    // grow into a free neighbour when it is big enough, otherwise move
+    if (size > block_size)
+    {
+        CELtlsf_block *next = tlsf_block_next(block);
+        size_t next_size    = next->size & ~CEL_TLSF_BLOCK_FREE;
+        if (!(next->size & CEL_TLSF_BLOCK_FREE) || block_size + CEL_TLSF_HEADER_SIZE + next_size < size)
+        {
+            void *new_mem = tlsf_alloc(t, nsize);
+            if (new_mem == NULL) { return NULL; }
+
+            memcpy(new_mem, oldmem, osize < nsize ? osize : nsize);
+            tlsf_free(t, oldmem);
+            return new_mem;
+        }
+
+        tlsf_block_remove(t, next);
+        block->size = block_size + CEL_TLSF_HEADER_SIZE + next_size;
+
+        tlsf_block_next(block)->prev_phys = block;
+    }
+
+    tlsf_block_trim(t, block, size);
+    t->used_len = t->used_len - block_size + block->size;
+
+    if (nsize > osize) { memset((unsigned char *) oldmem + osize, 0, nsize - osize); }
+    return oldmem;
+}
+
+void tlsf_free(CELtlsf *t, void *ptr) {
+    if (ptr == NULL) { return; }
+    if (!((unsigned char *) ptr > t->buf && (unsigned char *) ptr < t->buf + t->buf_len))
+    {
+        assert(false && "memory is out of bounds of the buffer in this tlsf (free)");
+        return;
+    }
+
+    CELtlsf_block *block = (CELtlsf_block *) ((unsigned char *) ptr - CEL_TLSF_HEADER_SIZE);
+    if (block->size & CEL_TLSF_BLOCK_FREE)
+    {
+        assert(false && "memory was already freed in this tlsf (free)");
+        return;
+    }
+    t->used_len -= block->size;
+    t->used_count--;
+
+    // free neighbours are merged right away, so two free blocks are never adjacent
+    CELtlsf_block *prev = block->prev_phys;
+    if (prev && (prev->size & CEL_TLSF_BLOCK_FREE))
+    {
+        tlsf_block_remove(t, prev);
+        prev->size = (prev->size & ~CEL_TLSF_BLOCK_FREE) + CEL_TLSF_HEADER_SIZE + block->size;
+        block      = prev;
+    }
+
+    CELtlsf_block *next = tlsf_block_next(block);
+    if (next->size & CEL_TLSF_BLOCK_FREE)
+    {
+        tlsf_block_remove(t, next);
+        block->size += CEL_TLSF_HEADER_SIZE + (next->size & ~CEL_TLSF_BLOCK_FREE);
+    }
+    tlsf_block_next(block)->prev_phys = block;
+
+    block->size |= CEL_TLSF_BLOCK_FREE;
+    tlsf_block_insert(t, block);
+}
+
+void tlsf_debug_print(CELtlsf *t, const char *label) {
+    size_t free_len     = 0;
+    size_t free_count   = 0;
+    size_t largest_free = 0;
+    for (CELtlsf_block *block = (CELtlsf_block *) t->buf; block && block->size != 0; block = tlsf_block_next(block))
+    {
+        if (!(block->size & CEL_TLSF_BLOCK_FREE)) { continue; }
+        size_t size = block->size & ~CEL_TLSF_BLOCK_FREE;
+        free_len += size;
+        free_count++;
+        if (size > largest_free) { largest_free = size; }
+    }
+
+    printf("[TLSF: %s]\n", label);
+    printf("- Buffer Address:      %p\n", t->buf);
+    printf("- Buffer Size:         %zu bytes\n", t->buf_len);
+    printf("- Used Memory:         %zu bytes in %zu blocks\n", t->used_len, t->used_count);
+    printf("- Free Memory:         %zu bytes in %zu blocks\n", free_len, free_count);
+    printf("- Largest Free Block:  %zu bytes\n\n", largest_free);
+}
+
+uint32_t tlsf_fls(size_t x) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    #if defined(_WIN64)
+    _BitScanReverse64(&idx, x);
+    #else
+    _BitScanReverse(&idx, x);
+    #endif
+    return (uint32_t) idx;
+#else
+    return (uint32_t) (sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(x));
+#endif
+}
+
+uint32_t tlsf_ffs(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanForward(&idx, x);
+    return (uint32_t) idx;
+#else
+    return (uint32_t) __builtin_ctz(x);
+#endif
+}
+
+size_t tlsf_adjust_size(size_t len) {
+    size_t size = align_forward(len, CEL_TLSF_ALIGNMENT);
+    return size < CEL_TLSF_MIN_BLOCK_SIZE ? CEL_TLSF_MIN_BLOCK_SIZE : size;
+}
+
+void tlsf_mapping(size_t size, uint32_t *fl, uint32_t *sl) {
+    if (size < CEL_TLSF_SMALL_SIZE)
+    {
+        *fl = 0;
+        *sl = (uint32_t) (size / CEL_TLSF_ALIGNMENT);
+        return;
+    }
+
+    // the bits right below the leading one pick the second level
+    uint32_t f = tlsf_fls(size);
+    *sl        = (uint32_t) (size >> (f - CEL_TLSF_SL_COUNT_LOG2)) ^ CEL_TLSF_SL_COUNT;
+    *fl        = f - (CEL_TLSF_FL_SHIFT - 1);
+}
+
+CELtlsf_block *tlsf_block_next(CELtlsf_block *block) {
+    return (CELtlsf_block *) ((unsigned char *) block + CEL_TLSF_HEADER_SIZE + (block->size & ~CEL_TLSF_BLOCK_FREE));
+}
+
+void tlsf_block_insert(CELtlsf *t, CELtlsf_block *block) {
+    uint32_t fl, sl;
+    tlsf_mapping(block->size & ~CEL_TLSF_BLOCK_FREE, &fl, &sl);
+
+    block->prev_free = NULL;
+    block->next_free = t->blocks[fl][sl];
+    if (block->next_free) { block->next_free->prev_free = block; }
+    t->blocks[fl][sl] = block;
+
+    t->fl_bitmap |= 1u << fl;
+    t->sl_bitmap[fl] |= 1u << sl;
+}
+
+void tlsf_block_remove(CELtlsf *t, CELtlsf_block *block) {
+    uint32_t fl, sl;
+    tlsf_mapping(block->size & ~CEL_TLSF_BLOCK_FREE, &fl, &sl);
+
+    if (block->prev_free) { block->prev_free->next_free = block->next_free; }
+    else { t->blocks[fl][sl] = block->next_free; }
+    if (block->next_free) { block->next_free->prev_free = block->prev_free; }
+
+    if (t->blocks[fl][sl] == NULL)
+    {
+        t->sl_bitmap[fl] &= ~(1u << sl);
+        if (t->sl_bitmap[fl] == 0) { t->fl_bitmap &= ~(1u << fl); }
+    }
+}
+
+CELtlsf_block *tlsf_block_find(CELtlsf *t, size_t size) {
+    // rounding up to the next second level bin means any block found there fits without walking the list
+    size_t rounded = size;
+    if (size >= CEL_TLSF_SMALL_SIZE) { rounded += ((size_t) 1 << (tlsf_fls(size) - CEL_TLSF_SL_COUNT_LOG2)) - 1; }
+
+    uint32_t fl, sl;
+    tlsf_mapping(rounded, &fl, &sl);
+
+    CELtlsf_block *block = NULL;
+    if (fl < CEL_TLSF_FL_COUNT)
+    {
+        uint32_t sl_map = t->sl_bitmap[fl] & (~0u << sl);
+        if (sl_map == 0)
+        {
+            uint32_t fl_map = t->fl_bitmap & (~0u << (fl + 1));
+            if (fl_map != 0)
+            {
+                fl     = tlsf_ffs(fl_map);
+                sl_map = t->sl_bitmap[fl];
+            }
+        }
+        if (sl_map != 0) { block = t->blocks[fl][tlsf_ffs(sl_map)]; }
+    }
+
+    // the bin the size itself maps to was skipped, its first block may still fit
+    if (block == NULL)
+    {
+        tlsf_mapping(size, &fl, &sl);
+        CELtlsf_block *candidate = fl < CEL_TLSF_FL_COUNT ? t->blocks[fl][sl] : NULL;
+        if (candidate && (candidate->size & ~CEL_TLSF_BLOCK_FREE) >= size) { block = candidate; }
+    }
+
+    if (block) { tlsf_block_remove(t, block); }
+    return block;
+}
+
+void tlsf_block_trim(CELtlsf *t, CELtlsf_block *block, size_t size) {
+    // hands the tail back when it is big enough to be a block, merging it with a free block after it
+    size_t block_size = block->size;
+    if (block_size < size + CEL_TLSF_HEADER_SIZE + CEL_TLSF_MIN_BLOCK_SIZE) { return; }
+
+    CELtlsf_block *rest = (CELtlsf_block *) ((unsigned char *) block + CEL_TLSF_HEADER_SIZE + size);
+    rest->prev_phys     = block;
+    rest->size          = block_size - size - CEL_TLSF_HEADER_SIZE;
+    block->size         = size;
+
+    CELtlsf_block *next = tlsf_block_next(rest);
+    if (next->size & CEL_TLSF_BLOCK_FREE)
+    {
+        tlsf_block_remove(t, next);
+        rest->size += CEL_TLSF_HEADER_SIZE + (next->size & ~CEL_TLSF_BLOCK_FREE);
+    }
+    tlsf_block_next(rest)->prev_phys = rest;
+
+    rest->size |= CEL_TLSF_BLOCK_FREE;
+    tlsf_block_insert(t, rest);
+}
+
+void handle_pool_init(CELhandle_pool *hp, CELhandle_slot *slots, uint32_t capacity) {
+    hp->slots     = slots;
+    hp->capacity  = capacity;
+    hp->count     = 0;
+    hp->free_head = CEL_HANDLE_INVALID_INDEX;
+    memset(slots, 0, sizeof(CELhandle_slot) * capacity);
+}
+
+bool handle_pool_alloc(CELhandle_pool *hp, uint32_t *idx, uint32_t *generation) {
+    uint32_t i;
+
+    if (hp->free_head != CEL_HANDLE_INVALID_INDEX)
+    {
+        i             = hp->free_head;
+        hp->free_head = hp->slots[i].next_free;// pop free slot
+    }
+    else if (hp->count < hp->capacity)
+    {
+        i = hp->count++;
+    }
+    else
+    {
+        return false;
+    }
+
+    CELhandle_slot *slot = &hp->slots[i];
+    slot->generation++;// even (free) -> odd (live)
+    slot->next_free = CEL_HANDLE_INVALID_INDEX;
+
+    *idx        = i;
+    *generation = slot->generation;
+    return true;
+}
+
+bool handle_pool_free(CELhandle_pool *hp, uint32_t idx, uint32_t generation) {
+    if (!handle_pool_valid(hp, idx, generation)) { return false; }
+
+    CELhandle_slot *slot = &hp->slots[idx];
+    slot->generation++;// odd (live) -> even (free), every outstanding handle to this slot is now stale
+    slot->next_free = hp->free_head;
+    hp->free_head   = idx;
+    return true;
+}
+
+bool handle_pool_valid(const CELhandle_pool *hp, uint32_t idx, uint32_t generation) {
+    if (idx >= hp->count) { return false; }
+    return hp->slots[idx].generation == generation && (generation & 1) != 0;
+}
+
+bool handle_pool_live(const CELhandle_pool *hp, uint32_t idx) {
+    return idx < hp->count && (hp->slots[idx].generation & 1) != 0;
 }
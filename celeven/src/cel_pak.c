@@ -0,0 +1,88 @@
+#include "cel.h"
+
+#include <string.h>
+
+bool celpak_open(CELpak *pak, const char *path) {
+    *pak = (CELpak){0};
+    if (!celfs_view_open(&pak->view, path)) { return false; }
+
+    const unsigned char *base = celfs_view_map(&pak->view);
+    size_t size               = celfs_view_size(&pak->view);
+    if (!base || size < sizeof(CELpak_header))
+    {
+        celpak_close(pak);
+        return false;
+    }
+
+    // everything the lookups touch is bounds checked once here, so celpak_find can trust the tables.
+    // the counts in the header are not trusted, the occupied buckets are counted while they are checked
+    const CELpak_header *header = (const CELpak_header *) base;
+    uint64_t buckets_end        = sizeof(CELpak_header) + (uint64_t) header->bucket_count * sizeof(CELpak_entry);
+
+    bool valid = header->magic == CEL_PAK_MAGIC && header->version == CEL_PAK_VERSION &&
+                 header->bucket_count > 0 && is_power_of_two(header->bucket_count) && buckets_end <= header->names_offset &&
+                 header->names_offset <= size && header->names_size <= size - header->names_offset;
+
+    const CELpak_entry *buckets = (const CELpak_entry *) (base + sizeof(CELpak_header));
+    uint32_t used_count         = 0;
+    for (uint32_t i = 0; valid && i < header->bucket_count; ++i)
+    {
+        const CELpak_entry *entry = &buckets[i];
+        if (entry->hash == 0) { continue; }
+
+        used_count++;
+        valid = (uint64_t) entry->name_offset + entry->name_length <= header->names_size &&
+                entry->offset <= size && entry->size <= size - entry->offset;
+    }
+
+    // a probe only ends on an empty bucket, a full table would spin forever in celpak_find
+    valid = valid && used_count < header->bucket_count;
+
+    if (!valid)
+    {
+        celpak_close(pak);
+        return false;
+    }
+
+    pak->header  = header;
+    pak->buckets = buckets;
+    pak->names   = (const char *) base + header->names_offset;
+    return true;
+}
+
+void celpak_close(CELpak *pak) {
+    celfs_view_unmap(&pak->view);
+    *pak = (CELpak){0};
+}
+
+uint64_t celpak_hash(const char *name) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const unsigned char *c = (const unsigned char *) name; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 0x100000001b3ull;
+    }
+    // zero marks an empty bucket
+    return hash ? hash : 1;
+}
+
+bool celpak_find(const CELpak *pak, const char *name, CELfile_view *view) {
+    if (!pak->header) { return false; }
+
+    uint64_t hash      = celpak_hash(name);
+    size_t name_length = strlen(name);
+    uint32_t mask      = pak->header->bucket_count - 1;
+    const char *base   = (const char *) pak->view.data;
+
+    // the table is never full, so the probe always ends on an empty bucket
+    for (uint32_t i = (uint32_t) hash & mask;; i = (i + 1) & mask)
+    {
+        const CELpak_entry *entry = &pak->buckets[i];
+        if (entry->hash == 0) { return false; }
+        if (entry->hash != hash || entry->name_length != name_length) { continue; }
+        if (memcmp(pak->names + entry->name_offset, name, name_length) != 0) { continue; }
+
+        *view = (CELfile_view){.data = base + entry->offset, .size = (size_t) entry->size};
+        return true;
+    }
+}
@@ -0,0 +1,181 @@
+#include "cel.h"
+#include "cel_log.h"
+
+#include <stdlib.h>
+
+#define CEL_PROFILE_RING_CAPACITY 16384// events per thread, power of two
+
+enum
+{
+    PROFILE_EVENT_BEGIN,
+    PROFILE_EVENT_END,
+};
+
+typedef struct CELprofile_event CELprofile_event;
+struct CELprofile_event {
+    const char *name;// null for ends, the trace pairs them by nesting
+    uint64_t timestamp_ns;
+    uint32_t phase;
+};
+
+// only the owning thread writes a ring, head is published after the event so a dump sees it whole
+typedef struct CELprofile_ring CELprofile_ring;
+struct CELprofile_ring {
+    volatile int64_t head;
+    volatile int32_t ready;
+    const char *name;
+    CELprofile_event *events;
+};
+
+// rings are claimed on a thread's first zone and kept after it exits, so its zones still show up in a dump
+GlobalVariable struct {
+    CELprofile_ring rings[CEL_MAX_PROFILE_THREAD_COUNT];
+    volatile int32_t ring_count;
+} P;
+
+GlobalVariable CEL_THREAD_LOCAL CELprofile_ring *profile_ring;
+GlobalVariable CEL_THREAD_LOCAL bool profile_ring_denied;
+
+Internal CELprofile_ring *profile_ring_get();
+Internal void profile_record(const char *name, uint32_t phase, uint64_t timestamp_ns);
+Internal void profile_json_string_write(FILE *fp, const char *s);
+
+void profile_begin(const char *name) {
+    profile_record(name, PROFILE_EVENT_BEGIN, time_now_ns());
+}
+
+void profile_end() {
+    profile_record(NULL, PROFILE_EVENT_END, time_now_ns());
+}
+
+void profile_thread_name(const char *name) {
+    CELprofile_ring *ring = profile_ring_get();
+    if (ring) { ring->name = name; }
+}
+
+bool profile_dump(const char *path) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp)
+    {
+        CEL_ERROR("profile: failed to open %s", path);
+        return false;
+    }
+
+    CELprofile_event *snapshot = malloc(sizeof(CELprofile_event) * CEL_PROFILE_RING_CAPACITY);
+    if (!snapshot)
+    {
+        CEL_ERROR("profile: out of memory for the dump snapshot");
+        fclose(fp);
+        return false;
+    }
+
+    int32_t ring_count = cel_atomic_load_i32(&P.ring_count);
+    if (ring_count > CEL_MAX_PROFILE_THREAD_COUNT) { ring_count = CEL_MAX_PROFILE_THREAD_COUNT; }
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    bool first         = true;
+    size_t event_count = 0;
+    for (int32_t i = 0; i < ring_count; ++i)
+    {
+        CELprofile_ring *ring = &P.rings[i];
+        if (!cel_atomic_load_i32(&ring->ready)) { continue; }
+
+        int64_t head  = cel_atomic_load_i64(&ring->head);
+        int64_t begin = head > CEL_PROFILE_RING_CAPACITY ? head - CEL_PROFILE_RING_CAPACITY : 0;
+        for (int64_t j = begin; j < head; ++j)
+        {
+            snapshot[j - begin] = ring->events[j & (CEL_PROFILE_RING_CAPACITY - 1)];
+        }
+
+        // the owner kept recording while we copied, drop whatever it may have lapped
+        int64_t first_valid = cel_atomic_load_i64(&ring->head) - CEL_PROFILE_RING_CAPACITY;
+        if (first_valid < begin) { first_valid = begin; }
+
+        if (ring->name)
+        {
+            fprintf(fp, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",", i);
+            profile_json_string_write(fp, ring->name);
+            fprintf(fp, "}}");
+            first = false;
+        }
+
+        // a wrapped ring can start inside a zone, skip the ends whose begins were overwritten
+        uint32_t depth = 0;
+        for (int64_t j = first_valid; j < head; ++j)
+        {
+            const CELprofile_event *event = &snapshot[j - begin];
+            double timestamp_us           = (double) event->timestamp_ns / 1000.0;
+            if (event->phase == PROFILE_EVENT_END)
+            {
+                if (depth == 0) { continue; }
+                depth--;
+                fprintf(fp, "%s\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", first ? "" : ",", timestamp_us, i);
+            }
+            else
+            {
+                depth++;
+                fprintf(fp, "%s\n{\"name\":", first ? "" : ",");
+                profile_json_string_write(fp, event->name);
+                fprintf(fp, ",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", timestamp_us, i);
+            }
+            first = false;
+            event_count++;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+
+    free(snapshot);
+    bool ok = fclose(fp) == 0;
+    if (ok) { CEL_INFO("profile: wrote %zu events from %d threads to %s", event_count, ring_count, path); }
+    else { CEL_ERROR("profile: failed to write %s", path); }
+    return ok;
+}
+
+CELprofile_ring *profile_ring_get() {
+    if (profile_ring) { return profile_ring; }
+    if (profile_ring_denied) { return NULL; }
+
+    int32_t idx = cel_atomic_add_i32(&P.ring_count, 1) - 1;
+    if (idx >= CEL_MAX_PROFILE_THREAD_COUNT)
+    {
+        CEL_WARN_ONCE("profile: more than %d threads recorded zones, the rest are ignored", CEL_MAX_PROFILE_THREAD_COUNT);
+        profile_ring_denied = true;
+        return NULL;
+    }
+
+    CELprofile_ring *ring = &P.rings[idx];
+    ring->events          = malloc(sizeof(CELprofile_event) * CEL_PROFILE_RING_CAPACITY);
+    if (!ring->events)
+    {
+        CEL_ERROR("profile: out of memory for thread %d's ring", idx);
+        profile_ring_denied = true;
+        return NULL;
+    }
+    cel_atomic_store_i32(&ring->ready, 1);
+
+    profile_ring = ring;
+    return ring;
+}
+
+void profile_record(const char *name, uint32_t phase, uint64_t timestamp_ns) {
+    CELprofile_ring *ring = profile_ring_get();
+    if (!ring) { return; }
+
+    int64_t head            = ring->head;
+    CELprofile_event *event = &ring->events[head & (CEL_PROFILE_RING_CAPACITY - 1)];
+    event->name             = name;
+    event->timestamp_ns     = timestamp_ns;
+    event->phase            = phase;
+    cel_atomic_store_i64(&ring->head, head + 1);
+}
+
+void profile_json_string_write(FILE *fp, const char *s) {
+    fputc('"', fp);
+    for (; *s; ++s)
+    {
+        if (*s == '"' || *s == '\\') { fputc('\\', fp); }
+        if ((unsigned char) *s < 0x20) { continue; }
+        fputc(*s, fp);
+    }
+    fputc('"', fp);
+}
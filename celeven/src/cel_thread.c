@@ -0,0 +1,185 @@
+#include "cel.h"
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <process.h>
+    #include <windows.h>
+
+typedef char mutex_storage_check[sizeof(SRWLOCK) <= sizeof(((CELmutex *) 0)->opaque) ? 1 : -1];
+typedef char condition_storage_check[sizeof(CONDITION_VARIABLE) <= sizeof(((CELcondition *) 0)->opaque) ? 1 : -1];
+#else
+    #include <pthread.h>
+    #include <sched.h>
+    #include <time.h>
+    #include <unistd.h>
+
+typedef char mutex_storage_check[sizeof(pthread_mutex_t) <= sizeof(((CELmutex *) 0)->opaque) ? 1 : -1];
+typedef char condition_storage_check[sizeof(pthread_cond_t) <= sizeof(((CELcondition *) 0)->opaque) ? 1 : -1];
+#endif
+
+#if defined(_WIN32)
+
+Internal unsigned __stdcall thread_start(void *data) {
+    CELthread *t = (CELthread *) data;
+    return (unsigned) t->fn(t->data);
+}
+
+bool thread_create(CELthread *t, CELthread_fn fn, void *data) {
+    t->fn     = fn;
+    t->data   = data;
+    t->handle = _beginthreadex(NULL, 0, thread_start, t, 0, NULL);
+    return t->handle != 0;
+}
+
+int thread_join(CELthread *t) {
+    DWORD exit_code = 0;
+    WaitForSingleObject((HANDLE) t->handle, INFINITE);
+    GetExitCodeThread((HANDLE) t->handle, &exit_code);
+    CloseHandle((HANDLE) t->handle);
+    t->handle = 0;
+    return (int) exit_code;
+}
+
+void thread_yield() {
+    SwitchToThread();
+}
+
+void thread_sleep_ms(uint32_t ms) {
+    Sleep(ms);
+}
+
+uint32_t cpu_core_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (uint32_t) info.dwNumberOfProcessors;
+}
+
+uint64_t time_now_ns() {
+    LocalPersistent LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) { QueryPerformanceFrequency(&frequency); }
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+
+    // split to keep counter * 1e9 from overflowing
+    uint64_t seconds   = (uint64_t) (counter.QuadPart / frequency.QuadPart);
+    uint64_t remainder = (uint64_t) (counter.QuadPart % frequency.QuadPart);
+    return seconds * 1000000000ull + remainder * 1000000000ull / (uint64_t) frequency.QuadPart;
+}
+
+void mutex_init(CELmutex *m) {
+    InitializeSRWLock((SRWLOCK *) m->opaque.storage);
+}
+
+void mutex_fini(CELmutex *m) {
+    (void) m;
+}
+
+void mutex_lock(CELmutex *m) {
+    AcquireSRWLockExclusive((SRWLOCK *) m->opaque.storage);
+}
+
+void mutex_unlock(CELmutex *m) {
+    ReleaseSRWLockExclusive((SRWLOCK *) m->opaque.storage);
+}
+
+void condition_init(CELcondition *c) {
+    InitializeConditionVariable((CONDITION_VARIABLE *) c->opaque.storage);
+}
+
+void condition_fini(CELcondition *c) {
+    (void) c;
+}
+
+void condition_wait(CELcondition *c, CELmutex *m) {
+    SleepConditionVariableSRW((CONDITION_VARIABLE *) c->opaque.storage, (SRWLOCK *) m->opaque.storage, INFINITE, 0);
+}
+
+void condition_signal(CELcondition *c) {
+    WakeConditionVariable((CONDITION_VARIABLE *) c->opaque.storage);
+}
+
+void condition_broadcast(CELcondition *c) {
+    WakeAllConditionVariable((CONDITION_VARIABLE *) c->opaque.storage);
+}
+
+#else
+
+Internal void *thread_start(void *data) {
+    CELthread *t = (CELthread *) data;
+    return (void *) (intptr_t) t->fn(t->data);
+}
+
+bool thread_create(CELthread *t, CELthread_fn fn, void *data) {
+    pthread_t handle;
+    t->fn   = fn;
+    t->data = data;
+    if (pthread_create(&handle, NULL, thread_start, t) != 0) { return false; }
+    t->handle = (uintptr_t) handle;
+    return true;
+}
+
+int thread_join(CELthread *t) {
+    void *exit_code = NULL;
+    pthread_join((pthread_t) t->handle, &exit_code);
+    t->handle = 0;
+    return (int) (intptr_t) exit_code;
+}
+
+void thread_yield() {
+    sched_yield();
+}
+
+void thread_sleep_ms(uint32_t ms) {
+    struct timespec duration = {.tv_sec = ms / 1000, .tv_nsec = (long) (ms % 1000) * 1000000L};
+    nanosleep(&duration, NULL);
+}
+
+uint32_t cpu_core_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (uint32_t) count : 1;
+}
+
+uint64_t time_now_ns() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+void mutex_init(CELmutex *m) {
+    pthread_mutex_init((pthread_mutex_t *) m->opaque.storage, NULL);
+}
+
+void mutex_fini(CELmutex *m) {
+    pthread_mutex_destroy((pthread_mutex_t *) m->opaque.storage);
+}
+
+void mutex_lock(CELmutex *m) {
+    pthread_mutex_lock((pthread_mutex_t *) m->opaque.storage);
+}
+
+void mutex_unlock(CELmutex *m) {
+    pthread_mutex_unlock((pthread_mutex_t *) m->opaque.storage);
+}
+
+void condition_init(CELcondition *c) {
+    pthread_cond_init((pthread_cond_t *) c->opaque.storage, NULL);
+}
+
+void condition_fini(CELcondition *c) {
+    pthread_cond_destroy((pthread_cond_t *) c->opaque.storage);
+}
+
+void condition_wait(CELcondition *c, CELmutex *m) {
+    pthread_cond_wait((pthread_cond_t *) c->opaque.storage, (pthread_mutex_t *) m->opaque.storage);
+}
+
+void condition_signal(CELcondition *c) {
+    pthread_cond_signal((pthread_cond_t *) c->opaque.storage);
+}
+
+void condition_broadcast(CELcondition *c) {
+    pthread_cond_broadcast((pthread_cond_t *) c->opaque.storage);
+}
+
+#endif// _WIN32
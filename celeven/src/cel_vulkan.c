@@ -11,26 +11,59 @@
     #define CELVK_USE_VALIDATION_LAYERS
 #endif
 
+#if defined(CEL_DEBUG) || defined(CELVK_SHADER_HOT_RELOAD)
+    #define CELVK_USE_SHADER_HOT_RELOAD
+#endif
+
+#if defined(CELVK_USE_SHADER_HOT_RELOAD)
+    #include <sys/stat.h>
+    #if defined(__linux__)
+        #include <poll.h>
+        #include <sys/inotify.h>
+        #include <unistd.h>
+    #endif
+#endif
+
 #if defined(CELVK_USE_VALIDATION_LAYERS) && (defined(CELVK_VALIDATION_LAYERS_GPU_ASSISTED) || defined(CELVK_VALIDATION_LAYERS_BEST_PRACTICES) || defined(CELVK_VALIDATION_LAYERS_SYNCHRONIZATION))
     #define CELVK_USE_VALIDATION_LAYERS_FEATURES
 #endif
 
-#define CELVK_MAX_FRAME_OVERLAP 3
+#define CELVK_MAX_FRAME_OVERLAP 4
+#define CELVK_MAX_SWAPCHAIN_IMAGE_COUNT 8
+#define CELVK_DEFAULT_FRAME_OVERLAP 3
 
 #define CELVK_TEXTURE_BINDING 0
 #define CELVK_SAMPLER_BINDING 1
 
-#define CELVK_STORAGE_SIZE (64 * 1024 * 1024)
+#define CELVK_STORAGE_SIZE (64 * 1024 * 1024)// reserved, vk_arena commits it as it grows
 
 #define CELVK_MAX_BINDLESS_RESOURCE_COUNT 16536
 #define CELVK_MAX_BUFFER_COUNT 1024
 #define CELVK_MAX_SAMPLER_COUNT 32
 #define CELVK_MAX_IMAGE_COUNT 1024
 #define CELVK_MAX_PROGRAM_COUNT 256
+#define CELVK_MAX_PROGRAM_STAGE_COUNT 4
+#define CELVK_MAX_PROGRAM_COLOR_FORMAT_COUNT 8
+
+#define CELVK_PIPELINE_CACHE_FILE "pipeline_cache.bin"
+
+#define CELVK_SHADER_WATCH_INTERVAL_MS 100
+#define CELVK_SHADER_SETTLE_MS 50
+
+#define CELVK_SPIRV_MAGIC 0x07230203u
 
 #define CELVK_MAX_EXTENSION_COUNT 32
 #define CELVK_MAX_LAYER_COUNT 32
 
+#define CELVK_FRAME_RING_SIZE (16 * 1024 * 1024)
+#define CELVK_MAX_DELETION_COUNT 4096// shared by every frame in flight
+#define CELVK_MAX_SPRITE_BATCH_COUNT 4096
+
+#define CELVK_UPLOAD_RING_SIZE (64 * 1024 * 1024)
+#define CELVK_UPLOAD_ALIGNMENT 16
+#define CELVK_MAX_UPLOAD_BATCH_COUNT 4
+#define CELVK_MAX_UPLOAD_ACQUIRE_COUNT 512
+
 typedef struct CELvk_physical_device CELvk_physical_device;
 struct CELvk_physical_device {
     VkPhysicalDevice handle;
@@ -47,8 +80,10 @@ struct CELvk_device {
     VkDevice handle;
     uint32_t graphics_queue_family_index;
     uint32_t graphics_queue_mode;
+    uint32_t transfer_queue_family_index;
     VkQueue graphics_queue;
     VkQueue present_queue;
+    VkQueue transfer_queue;
 };
 
 typedef struct CELvk_surface CELvk_surface;
@@ -65,8 +100,13 @@ struct CELvk_swapchain {
     VkPresentModeKHR present_mode;
     VkExtent2D swapchain_extent;
     uint32_t image_array_layers;
-    CELimage_handle *swapchain_images;
-    bool dirty;
+    CELimage_handle swapchain_images[CELVK_MAX_SWAPCHAIN_IMAGE_COUNT];
+    uint32_t image_count;
+    uint32_t present_mode_mask;       // bit per supported VkPresentModeKHR, only the core modes are tracked
+    CELvk_present_mode requested_mode;// what the game asked for, present_mode is what it got
+    uint32_t requested_image_count;   // 0 asks for one above the surface minimum
+    uint32_t min_image_count;         // what the swapchain was created with
+    bool dirty;                       // out of date or suboptimal, rebuilt before the next acquire
 };
 
 typedef struct CELvk_bindless_descriptor CELvk_bindless_descriptor;
@@ -86,6 +126,93 @@ struct CELvk_immediate_command {
     VkFence fence;
 };
 
+typedef struct CELvk_sprite_batch CELvk_sprite_batch;
+struct CELvk_sprite_batch {
+    CELprogram_handle program;
+    uint32_t texture_idx;
+    uint32_t first_sprite;// sprites queued this frame before this batch
+    uint32_t sprite_count;
+    VkDeviceAddress sprite_address;
+};
+
+typedef struct CELvk_frame_ring CELvk_frame_ring;
+struct CELvk_frame_ring {
+    CELbuffer_handle buffer;
+    unsigned char *mapped;
+    VkDeviceAddress device_address;
+    VkDeviceSize region_size;
+};
+
+typedef struct CELvk_upload_batch CELvk_upload_batch;
+struct CELvk_upload_batch {
+    VkCommandBuffer command_buffer;
+    uint64_t timeline_value;// signaled on the upload timeline once the batch's copies land
+    uint64_t ring_end;      // staging position reclaimed once the batch completes
+};
+
+// a resource released by the transfer queue that graphics still has to acquire
+typedef struct CELvk_upload_acquire CELvk_upload_acquire;
+struct CELvk_upload_acquire {
+    VkObjectType type;
+    union {
+        VkBuffer buffer;
+        VkImage image;
+    } handle;
+};
+
+typedef struct CELvk_upload_ctx CELvk_upload_ctx;
+struct CELvk_upload_ctx {
+    VkCommandPool command_pool;
+    VkSemaphore timeline;
+    CELvk_upload_batch batches[CELVK_MAX_UPLOAD_BATCH_COUNT];
+    uint32_t batch_index;
+    uint64_t submitted_value;
+    bool recording;
+
+    CELbuffer_handle staging;
+    unsigned char *mapped;
+    VkDeviceSize ring_size;
+    uint64_t ring_head;// monotonic byte positions, wrapped into the ring on use
+    uint64_t ring_tail;
+
+    CELvk_upload_acquire acquires[CELVK_MAX_UPLOAD_ACQUIRE_COUNT];
+    uint32_t acquire_count;
+};
+
+#if defined(CELVK_USE_SHADER_HOT_RELOAD)
+// everything the watcher needs to rebuild a program's pipeline on its own thread
+typedef struct CELvk_program_source CELvk_program_source;
+struct CELvk_program_source {
+    CELprogram_handle program;
+    VkPipelineLayout layout;
+
+    char shader_paths[CELVK_MAX_PROGRAM_STAGE_COUNT][FS_PATH_MAX];
+    int64_t shader_mtimes[CELVK_MAX_PROGRAM_STAGE_COUNT];
+    int watch_ids[CELVK_MAX_PROGRAM_STAGE_COUNT];
+    uint32_t stage_count;
+
+    VkFormat color_formats[CELVK_MAX_PROGRAM_COLOR_FORMAT_COUNT];
+    uint32_t color_format_count;
+    VkFormat depth_format;
+    VkFormat stencil_format;
+    uint32_t view_mask;
+
+    bool live;
+    bool dirty;
+    VkPipeline rebuilt;// waits here for the next frame boundary
+};
+
+typedef struct CELvk_shader_watcher CELvk_shader_watcher;
+struct CELvk_shader_watcher {
+    CELthread thread;
+    CELmutex mutex;// guards the program sources, never held while a pipeline compiles
+    volatile int32_t running;
+    volatile int32_t pending; // set once a rebuilt pipeline is ready to swap
+    volatile int32_t building;// program index + 1 while its pipeline compiles, 0 otherwise
+    int notify_fd;
+};
+#endif
+
 typedef struct CELvk_ctx CELvk_ctx;
 struct CELvk_ctx {
     VkInstance instance;
@@ -98,36 +225,65 @@ struct CELvk_ctx {
     VkDebugUtilsMessengerEXT debug_utils_messenger;
 #endif
     CELvk_frame_data *frames;
+    VkSemaphore frame_timeline;// frame n signals n + 1 once the gpu retires it
+    CELvk_deletion *deletions; // in push order, so their retire values never decrease
+    uint32_t deletion_count;
+    uint32_t frames_in_flight;
+    CELvk_frame_ring frame_ring;
     CELvk_immediate_command immediate_command;
+    CELvk_upload_ctx upload;
     CELvk_bindless_descriptor descriptor;
+    VkPipelineCache pipeline_cache;
+
+    uint64_t timestamp_mask;// valid bits of a graphics queue timestamp, 0 when it has none
+    float timestamp_period; // nanoseconds per timestamp tick
+    CELvk_gpu_timings gpu_timings;
+    bool gpu_timings_valid;
 
     size_t frame_count;
+    uint32_t frame_lead;// never above frames_in_flight
 
     const char *engine_path;
+    const char *user_path;
+    const CELpak *pak;
 
     bool raytracing_supported;
     bool mesh_shading_supported;
+    bool headless;
+    GLFWwindow *window;
 };
 
 GlobalVariable CELvk_ctx vk_ctx = {};
 
-GlobalVariable unsigned char vkbuf[CELVK_STORAGE_SIZE];
 GlobalVariable CELarena vk_arena;
 
 GlobalVariable const char *enabled_extensions[32];
 GlobalVariable uint32_t enabled_extension_count = 0;
 
 GlobalVariable CELvk_buffer vk_buffers[CELVK_MAX_BUFFER_COUNT];
-GlobalVariable uint32_t vk_buffer_count = 0;
+GlobalVariable CELhandle_slot vk_buffer_slots[CELVK_MAX_BUFFER_COUNT];
+GlobalVariable CELhandle_pool vk_buffer_pool;
 
 GlobalVariable CELvk_image vk_images[CELVK_MAX_IMAGE_COUNT];
-GlobalVariable uint32_t vk_image_count = 0;
+GlobalVariable CELhandle_slot vk_image_slots[CELVK_MAX_IMAGE_COUNT];
+GlobalVariable CELhandle_pool vk_image_pool;
 
 GlobalVariable CELvk_sampler vk_samplers[CELVK_MAX_SAMPLER_COUNT];
-GlobalVariable uint32_t vk_sampler_count = 0;
+GlobalVariable CELhandle_slot vk_sampler_slots[CELVK_MAX_SAMPLER_COUNT];
+GlobalVariable CELhandle_pool vk_sampler_pool;
 
 GlobalVariable CELvk_program vk_programs[CELVK_MAX_PROGRAM_COUNT];
-GlobalVariable uint32_t vk_program_count = 0;
+GlobalVariable CELhandle_slot vk_program_slots[CELVK_MAX_PROGRAM_COUNT];
+GlobalVariable CELhandle_pool vk_program_pool;
+
+#if defined(CELVK_USE_SHADER_HOT_RELOAD)
+GlobalVariable CELvk_program_source vk_program_sources[CELVK_MAX_PROGRAM_COUNT];
+GlobalVariable CELvk_shader_watcher vk_shader_watcher;
+#endif
+
+GlobalVariable CELvk_sprite_batch vk_sprite_batches[CELVK_MAX_SPRITE_BATCH_COUNT];
+GlobalVariable uint32_t vk_sprite_batch_count = 0;
+GlobalVariable uint32_t vk_sprite_count       = 0;
 
 Internal bool celvk_enable_extension(const char *req_ext, VkExtensionProperties *available_exts, uint32_t available_exts_count, const char **enabled_exts, uint32_t *enabled_exts_count);
 Internal bool celvk_enable_layer(const char *req_layer, VkLayerProperties *supported_layers, uint32_t supported_layer_count, const char **enabled_layers, uint32_t *enabled_layer_count);
@@ -143,8 +299,9 @@ Internal VkPhysicalDevice physical_device_get(VkInstance *instance);
 Internal void physical_device_destroy(VkInstance *instance, VkPhysicalDevice *physical_device);
 
 Internal uint32_t queue_family_count_get(VkPhysicalDevice *physical_device);
-Internal VkQueueFamilyProperties *queue_family_properties_get(VkPhysicalDevice *physical_device, uint32_t queue_family_count);
+Internal VkQueueFamilyProperties *queue_family_properties_get(CELarena *arena, VkPhysicalDevice *physical_device, uint32_t queue_family_count);
 Internal uint32_t graphics_queue_family_index_get(VkQueueFamilyProperties *queue_family_properties, uint32_t queue_family_count);
+Internal uint32_t transfer_queue_family_index_get(VkQueueFamilyProperties *queue_family_properties, uint32_t queue_family_count, uint32_t graphics_queue_family_index);
 Internal uint32_t graphics_queue_mode_get(VkQueueFamilyProperties *queue_family_properties, uint32_t graphics_queue_family_index);
 Internal VkQueue graphics_queue_get(VkDevice *device, uint32_t graphics_queue_family_index);
 Internal VkQueue present_queue_get(VkDevice *device, uint32_t graphics_queue_family_index, uint32_t graphics_queue_mode);
@@ -158,44 +315,126 @@ Internal VkBool32 window_surface_support_get(VkSurfaceKHR *surface, VkPhysicalDe
 
 Internal VkSurfaceCapabilitiesKHR window_surface_capabilities_get(VkSurfaceKHR *surface, VkPhysicalDevice *physical_device);
 Internal VkSurfaceFormatKHR prefer_surface_format_get(VkSurfaceKHR *surface, VkPhysicalDevice *physical_device);
-Internal VkPresentModeKHR prefer_present_mode_get(VkSurfaceKHR *surface, VkPhysicalDevice *physical_device);
+Internal uint32_t present_mode_mask_get(VkSurfaceKHR *surface, VkPhysicalDevice *physical_device);
+Internal VkPresentModeKHR prefer_present_mode_get(uint32_t present_mode_mask, CELvk_present_mode mode);
+Internal VkPresentModeKHR present_mode_resolve(CELvk_present_mode mode);
+Internal uint32_t prefer_swapchain_image_count_get(VkSurfaceCapabilitiesKHR *surface_capabilities, uint32_t requested_count);
 Internal VkExtent2D prefer_swapchain_extent_get(VkSurfaceCapabilitiesKHR *surface_capabilities, GLFWwindow *window);
 
-Internal VkSwapchainKHR swapchain_create(VkDevice *device, VkSurfaceKHR *surface, VkSurfaceCapabilitiesKHR *surface_capabilities, VkSurfaceFormatKHR *surface_format, VkExtent2D *swapchain_extent, const VkPresentModeKHR *present_mode, uint32_t image_array_layers, uint32_t graphics_queue_index);
+Internal bool swapchain_setup(GLFWwindow *window);
+Internal bool swapchain_recreate();
+Internal VkSwapchainKHR swapchain_create(VkDevice *device, VkSurfaceKHR *surface, VkSurfaceCapabilitiesKHR *surface_capabilities, VkSurfaceFormatKHR *surface_format, VkExtent2D *swapchain_extent, const VkPresentModeKHR *present_mode, uint32_t min_image_count, uint32_t image_array_layers, uint32_t graphics_queue_index, VkSwapchainKHR old_swapchain);
 Internal void swapchain_destroy(VkDevice *device, CELvk_swapchain *swapchain);
-Internal uint32_t swapchain_image_count_get(VkDevice *device, VkSwapchainKHR *swapchain);
-Internal VkImage *swapchain_images_get(VkDevice *device, VkSwapchainKHR *swapchain, uint32_t swapchain_image_count);
-Internal CELimage_handle swapchain_acquire_next_image(VkDevice *device, uint32_t current_frame_index, uint32_t *image_index);
+Internal void swapchain_images_bind(VkDevice *device, CELvk_swapchain *swapchain);
+Internal bool swapchain_acquire_next_image(VkDevice *device, uint32_t current_frame_index, uint32_t *image_index);
 Internal void submit_and_present(VkCommandBuffer cmd, uint32_t current_frame_index, uint32_t image_index);
 
 Internal CELvk_frame_data *perframes_create(VkDevice *device, uint32_t queue_family_index);
 Internal void perframes_destroy(VkDevice *device, CELvk_frame_data *frame_data);
 
+Internal CELvk_frame_ring frame_ring_create(VmaAllocator *allocator, VkDeviceSize region_size);
+
+Internal void deletion_push(CELvk_deletion deletion);
+Internal void deletion_destroy(VkDevice *device, VmaAllocator *allocator, const CELvk_deletion *deletion);
+Internal void deletion_queue_flush(VkDevice *device, VmaAllocator *allocator, uint64_t completed_value);
+
 Internal CELvk_immediate_command immediate_command_create(VkDevice *device, uint32_t queue_family_index);
 Internal void immediate_command_destroy(VkDevice *device, CELvk_immediate_command *im_cmd);
 
+Internal VkSemaphore timeline_semaphore_create(VkDevice *device, uint64_t initial_value);
+
+Internal void upload_create(VkDevice *device, VmaAllocator *allocator, uint32_t queue_family_index, CELvk_upload_ctx *upload);
+Internal void upload_destroy(VkDevice *device, CELvk_upload_ctx *upload);
+Internal bool upload_stage(const void *data, VkDeviceSize size, VkDeviceSize *staging_offset, VkCommandBuffer *cmd);
+Internal void upload_release(VkCommandBuffer cmd, const CELvk_upload_acquire *acquire);
+Internal void upload_acquire(VkCommandBuffer cmd, const CELvk_upload_acquire *acquire);
+
+Internal VkPipelineCache pipeline_cache_create(VkDevice *device, const char *path);
+Internal void pipeline_cache_save(VkDevice *device, VkPipelineCache pipeline_cache, const char *path);
+
+Internal bool resource_view_open(const char *path, bool use_pak, CELfile_view *view);
+Internal bool shader_view_open(const char *path, bool use_pak, CELfile_view *view);
+Internal bool shader_module_create(VkDevice *device, const char *path, bool use_pak, VkShaderModule *shader_module);
+Internal VkResult graphics_pipeline_build(VkDevice *device, const VkPipelineRenderingCreateInfo *rendering_create_info, VkPipelineLayout layout, const VkShaderModule *shader_modules, const VkShaderStageFlags *shader_stages, uint32_t stage_count, VkPipeline *pipeline);
+
+Internal void shader_watcher_create();
+Internal void shader_watcher_destroy();
+Internal void shader_watcher_register(const CELprogram_handle *handle, VkPipelineLayout layout, const VkPipelineRenderingCreateInfo *rendering_create_info, const char **shader_paths, uint32_t shader_count);
+Internal void shader_watcher_unregister(const CELprogram_handle *handle);
+Internal void shader_watcher_swap();
+
 Internal CELvk_bindless_descriptor bindless_descriptor_create(VkDevice *device);
 Internal void bindless_descriptor_destroy(VkDevice *device, CELvk_bindless_descriptor *descriptor);
 
+Internal void bindless_texture_write(VkDevice *device, uint32_t index, VkImageView image_view);
+Internal void bindless_sampler_write(VkDevice *device, uint32_t index, VkSampler sampler);
+
+Internal void rendering_begin(VkCommandBuffer cmd, const CELimage_handle *render_target, CELrgba clear_color, VkRenderingFlags flags);
+Internal void render_texture_blit(VkCommandBuffer cmd, const CELimage_handle *source, const CELimage_handle *destination);
+Internal void sprite_batches_record(VkCommandBuffer cmd, VkExtent2D extent, uint32_t first_sprite, uint32_t sprite_count);
+
+Internal VkShaderStageFlagBits shader_stage_from_path(const char *path);
+Internal CELvk_frame_data *current_frame_get();
+Internal uint64_t frame_timeline_value_get();
+Internal uint64_t frame_wait_value_get();
+
+Internal uint32_t gpu_pass_begin(VkCommandBuffer cmd, CELvk_gpu_pass pass);
+Internal void gpu_pass_end(VkCommandBuffer cmd, uint32_t query);
+Internal void gpu_timestamps_collect(CELvk_frame_data *frame);
+
+Internal CELvk_buffer *vk_buffer_get(const CELbuffer_handle *handle);
+Internal CELvk_image *vk_image_get(const CELimage_handle *handle);
+Internal void image_wrap(VkDevice *device, const CELimage_handle *handle, const CELvk_image_create_info *create_info, VkImage vk_image);
+Internal void image_rebind(VkDevice *device, const CELimage_handle *handle, const CELvk_image_create_info *create_info, VkImage vk_image);
+Internal CELvk_sampler *vk_sampler_get(const CELsampler_handle *handle);
+Internal CELvk_program *vk_program_get(const CELprogram_handle *handle);
+
 Internal void vk_images_destroy(VkDevice *device, VmaAllocator *allocator);
 Internal void vk_buffers_destroy(VmaAllocator *allocator);
 Internal void vk_samplers_destroy(VkDevice *device);
+Internal void vk_programs_destroy(VkDevice *device);
 
 #if defined(CELVK_USE_VALIDATION_LAYERS)
 VKAPI_ATTR VkBool32 VKAPI_CALL debug_utils_messenger_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT *callback_data, void *user_data);
 #endif
 
 bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
-    vk_ctx.engine_path = state->engine_path;
+    uint64_t init_start_ns = time_now_ns();
+    vk_ctx.engine_path      = state->engine_path;
+    vk_ctx.user_path        = state->user_path;
+    vk_ctx.pak              = state->pak;
+    vk_ctx.headless         = state->headless;
+    vk_ctx.window           = window;
+    vk_ctx.frames_in_flight = state->frames_in_flight ? state->frames_in_flight : CELVK_DEFAULT_FRAME_OVERLAP;
+    if (vk_ctx.frames_in_flight > CELVK_MAX_FRAME_OVERLAP)
+    {
+        CEL_WARN("vulkan warning: %u frames in flight requested, clamping to %u", vk_ctx.frames_in_flight, CELVK_MAX_FRAME_OVERLAP);
+        vk_ctx.frames_in_flight = CELVK_MAX_FRAME_OVERLAP;
+    }
+    vk_ctx.swapchain.requested_mode        = state->present_mode;
+    vk_ctx.swapchain.requested_image_count = state->swapchain_image_count;
+    celvk_frame_lead_set(state->frame_lead);
+
+    if (!cel_arena_init_virtual(&vk_arena, CELVK_STORAGE_SIZE, 0))
+    {
+        CEL_ERROR("vulkan error: failed to reserve %d bytes for the renderer arena", CELVK_STORAGE_SIZE);
+        return false;
+    }
 
-    cel_arena_init(&vk_arena, vkbuf, CELVK_STORAGE_SIZE);
+    handle_pool_init(&vk_buffer_pool, vk_buffer_slots, CELVK_MAX_BUFFER_COUNT);
+    handle_pool_init(&vk_image_pool, vk_image_slots, CELVK_MAX_IMAGE_COUNT);
+    handle_pool_init(&vk_sampler_pool, vk_sampler_slots, CELVK_MAX_SAMPLER_COUNT);
+    handle_pool_init(&vk_program_pool, vk_program_slots, CELVK_MAX_PROGRAM_COUNT);
 
     VK_CHECK(volkInitialize());
 
+    // enumerations only needed while picking what to enable, they are gone once init returns
+    CELarena_temp scratch = cel_arena_scratch_get(NULL, 0);
+
     uint32_t available_ext_count;
     VK_CHECK(vkEnumerateInstanceExtensionProperties(NULL, &available_ext_count, NULL));
 
-    VkExtensionProperties *available_exts = cel_arena_alloc(&vk_arena, sizeof(VkExtensionProperties) * available_ext_count);
+    VkExtensionProperties *available_exts = cel_arena_alloc(scratch.arena, sizeof(VkExtensionProperties) * available_ext_count);
     VK_CHECK(vkEnumerateInstanceExtensionProperties(NULL, &available_ext_count, available_exts));
 
 #if defined(CELVK_USE_VALIDATION_LAYERS)
@@ -207,12 +446,17 @@ bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
 
     celvk_enable_extension(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME, available_exts, available_ext_count, enabled_extensions, &enabled_extension_count);
 
+    // headless runs never initialize glfw, and need none of the surface extensions it asks for
     uint32_t glfw_ext_count = 0;
-    const char **glfw_exts  = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
-    if (!glfw_exts)
+    const char **glfw_exts  = NULL;
+    if (!vk_ctx.headless)
     {
-        CEL_ERROR("glfw required vulkan extensions not available");
-        return false;
+        glfw_exts = glfwGetRequiredInstanceExtensions(&glfw_ext_count);
+        if (!glfw_exts)
+        {
+            CEL_ERROR("glfw required vulkan extensions not available");
+            return false;
+        }
     }
 
     for (uint32_t i = 0; i < glfw_ext_count; ++i)
@@ -228,7 +472,7 @@ bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
     uint32_t supported_layer_count = 0;
     VK_CHECK(vkEnumerateInstanceLayerProperties(&supported_layer_count, NULL));
 
-    VkLayerProperties *supported_layer = cel_arena_alloc(&vk_arena, sizeof(VkLayerProperties) * supported_layer_count);
+    VkLayerProperties *supported_layer = cel_arena_alloc(scratch.arena, sizeof(VkLayerProperties) * supported_layer_count);
     VK_CHECK(vkEnumerateInstanceLayerProperties(&supported_layer_count, supported_layer));
 
     const char *enabled_layers[CELVK_MAX_LAYER_COUNT];
@@ -293,7 +537,7 @@ bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
         return false;
     }
 
-    VkPhysicalDevice *physical_devices = arena_alloc(&vk_arena, sizeof(VkPhysicalDevice) * physical_device_count);
+    VkPhysicalDevice *physical_devices = cel_arena_alloc(scratch.arena, sizeof(VkPhysicalDevice) * physical_device_count);
     VK_CHECK(vkEnumeratePhysicalDevices(vk_ctx.instance, &physical_device_count, physical_devices));
 
     assert(physical_devices != NULL && "vulkan error: no physical devices were found on the system");
@@ -314,7 +558,7 @@ bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
     CELvk_physical_device *selected_physical_device = &vk_ctx.physical_device;
 
     uint32_t queue_family_count                      = queue_family_count_get(&selected_physical_device->handle);
-    VkQueueFamilyProperties *queue_family_properties = queue_family_properties_get(&selected_physical_device->handle, queue_family_count);
+    VkQueueFamilyProperties *queue_family_properties = queue_family_properties_get(scratch.arena, &selected_physical_device->handle, queue_family_count);
 
     vk_ctx.device.handle = device_create(&selected_physical_device->handle, queue_family_count, queue_family_properties);
     ASSERT_VK_HANDLE(vk_ctx.device.handle);
@@ -324,40 +568,37 @@ bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
 
     vk_ctx.device.graphics_queue_family_index = graphics_queue_family_index_get(queue_family_properties, queue_family_count);
     vk_ctx.device.graphics_queue_mode         = graphics_queue_mode_get(queue_family_properties, vk_ctx.device.graphics_queue_family_index);
+    vk_ctx.device.transfer_queue_family_index = transfer_queue_family_index_get(queue_family_properties, queue_family_count, vk_ctx.device.graphics_queue_family_index);
 
     vk_ctx.device.graphics_queue = graphics_queue_get(&vk_ctx.device.handle, vk_ctx.device.graphics_queue_family_index);
     vk_ctx.device.present_queue  = present_queue_get(&vk_ctx.device.handle, vk_ctx.device.graphics_queue_family_index, vk_ctx.device.graphics_queue_mode);
-
-    vk_ctx.surface.handle            = window_surface_create(window, &vk_ctx.instance);
-    vk_ctx.surface.surface_supported = window_surface_support_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle, vk_ctx.device.graphics_queue_family_index);
-    if (!vk_ctx.surface.surface_supported) { return false; }
-
-    vk_ctx.swapchain.surface_capabilities = window_surface_capabilities_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
-    vk_ctx.swapchain.surface_format       = prefer_surface_format_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
-    vk_ctx.swapchain.present_mode         = prefer_present_mode_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
-    vk_ctx.swapchain.swapchain_extent     = prefer_swapchain_extent_get(&vk_ctx.swapchain.surface_capabilities, window);
-    vk_ctx.swapchain.image_array_layers   = 1;
-
-    vk_ctx.swapchain.handle = swapchain_create(&vk_ctx.device.handle, &vk_ctx.surface.handle, &vk_ctx.swapchain.surface_capabilities, &vk_ctx.swapchain.surface_format, &vk_ctx.swapchain.swapchain_extent, &vk_ctx.swapchain.present_mode, vk_ctx.swapchain.image_array_layers, vk_ctx.device.graphics_queue_family_index);
-
-    uint32_t swapchain_image_count = swapchain_image_count_get(&vk_ctx.device.handle, &vk_ctx.swapchain.handle);
-    VkImage *swapchain_images      = swapchain_images_get(&vk_ctx.device.handle, &vk_ctx.swapchain.handle, swapchain_image_count);
-
-    vk_ctx.swapchain.swapchain_images = cel_arena_alloc(&vk_arena, sizeof(CELvk_image) * swapchain_image_count);
-    for (uint32_t i = 0; i < swapchain_image_count; ++i)
+    vk_ctx.device.transfer_queue = vk_ctx.device.graphics_queue;
+    if (vk_ctx.device.transfer_queue_family_index != vk_ctx.device.graphics_queue_family_index)
     {
-        CELvk_image_create_info create_info = {
-            .format            = vk_ctx.swapchain.surface_format.format,
-            .usages            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-            .base_array_layers = vk_ctx.swapchain.image_array_layers,
-            .extent            = (VkExtent3D){vk_ctx.swapchain.swapchain_extent.width, vk_ctx.swapchain.swapchain_extent.height, 1},
-        };
-        CELimage_handle *image_handle = &vk_ctx.swapchain.swapchain_images[i];
-        *image_handle                 = celvk_image_create_w_handle(&vk_ctx.device.handle, &vk_ctx.allocator, &create_info, swapchain_images[i]);
+        vkGetDeviceQueue(vk_ctx.device.handle, vk_ctx.device.transfer_queue_family_index, 0, &vk_ctx.device.transfer_queue);
     }
 
+    if (vk_ctx.headless) { CEL_INFO("vulkan running headless, frames are rendered offscreen and never presented"); }
+    else if (!swapchain_setup(window)) { return false; }
+
+    // timestamps only wrap at the valid bits, so pass durations are taken modulo this mask
+    uint32_t timestamp_valid_bits = vk_ctx.physical_device.queue_family_properties[vk_ctx.device.graphics_queue_family_index].timestampValidBits;
+    vk_ctx.timestamp_mask         = timestamp_valid_bits >= 64 ? UINT64_MAX : (1ull << timestamp_valid_bits) - 1;
+    vk_ctx.timestamp_period       = vk_ctx.physical_device.properties.limits.timestampPeriod;
+    if (vk_ctx.timestamp_mask == 0) { CEL_WARN("vulkan warning: the graphics queue has no timestamps, gpu pass timings are disabled"); }
+
+    vk_ctx.frame_ring        = frame_ring_create(&vk_ctx.allocator, CELVK_FRAME_RING_SIZE);
+    vk_ctx.deletions         = cel_arena_alloc(&vk_arena, sizeof(CELvk_deletion) * CELVK_MAX_DELETION_COUNT);
+    vk_ctx.deletion_count    = 0;
     vk_ctx.frames            = perframes_create(&vk_ctx.device.handle, vk_ctx.device.graphics_queue_family_index);
+    vk_ctx.frame_timeline    = timeline_semaphore_create(&vk_ctx.device.handle, 0);
     vk_ctx.immediate_command = immediate_command_create(&vk_ctx.device.handle, vk_ctx.device.graphics_queue_family_index);
+    upload_create(&vk_ctx.device.handle, &vk_ctx.allocator, vk_ctx.device.transfer_queue_family_index, &vk_ctx.upload);
+
+    char pipeline_cache_path[FS_PATH_MAX];
+    snprintf(pipeline_cache_path, sizeof(pipeline_cache_path), "%s/%s", vk_ctx.user_path, CELVK_PIPELINE_CACHE_FILE);
+    vk_ctx.pipeline_cache = pipeline_cache_create(&vk_ctx.device.handle, pipeline_cache_path);
+    shader_watcher_create();
 
     vk_ctx.descriptor                               = bindless_descriptor_create(&vk_ctx.device.handle);
     VkSamplerCreateInfo nearest_sampler_create_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
@@ -365,37 +606,56 @@ bool cel_vulkan_init(GLFWwindow *window, CELvk_state *state) {
     nearest_sampler_create_info.minFilter           = VK_FILTER_NEAREST;
 
     VkSamplerCreateInfo linear_sampler_create_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
-    nearest_sampler_create_info.magFilter          = VK_FILTER_LINEAR;
-    nearest_sampler_create_info.minFilter          = VK_FILTER_LINEAR;
+    linear_sampler_create_info.magFilter           = VK_FILTER_LINEAR;
+    linear_sampler_create_info.minFilter           = VK_FILTER_LINEAR;
 
     VkSamplerCreateInfo shadow_sampler_create_info = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
-    nearest_sampler_create_info.magFilter          = VK_FILTER_LINEAR;
-    nearest_sampler_create_info.minFilter          = VK_FILTER_LINEAR;
-    nearest_sampler_create_info.mipmapMode         = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    nearest_sampler_create_info.anisotropyEnable   = VK_TRUE;
-    nearest_sampler_create_info.maxAnisotropy      = 16;
+    shadow_sampler_create_info.magFilter           = VK_FILTER_LINEAR;
+    shadow_sampler_create_info.minFilter           = VK_FILTER_LINEAR;
+    shadow_sampler_create_info.mipmapMode          = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    shadow_sampler_create_info.anisotropyEnable    = VK_TRUE;
+    shadow_sampler_create_info.maxAnisotropy       = 16;
 
     vk_ctx.descriptor.nearest_sampler    = celvk_sampler_create(&vk_ctx.device.handle, &nearest_sampler_create_info);
     vk_ctx.descriptor.linear_sampler     = celvk_sampler_create(&vk_ctx.device.handle, &linear_sampler_create_info);
     vk_ctx.descriptor.shadow_map_sampler = celvk_sampler_create(&vk_ctx.device.handle, &shadow_sampler_create_info);
 
+    cel_arena_scratch_release(scratch);
+    CEL_INFO("vulkan initialized in %.2f ms", (double) (time_now_ns() - init_start_ns) / 1e6);
     return true;
 }
 
 void cel_vulkan_fini() {
     vkDeviceWaitIdle(vk_ctx.device.handle);
 
-    bindless_descriptor_destroy(&vk_ctx.device.handle, &vk_ctx.descriptor);
-    perframes_destroy(&vk_ctx.device.handle, vk_ctx.frames);
-    immediate_command_destroy(&vk_ctx.device.handle, &vk_ctx.immediate_command);
+    // the watcher may still be building against the pipeline cache, stop it before the cache goes away
+    vk_programs_destroy(&vk_ctx.device.handle);
+    shader_watcher_destroy();
+
+    char pipeline_cache_path[FS_PATH_MAX];
+    snprintf(pipeline_cache_path, sizeof(pipeline_cache_path), "%s/%s", vk_ctx.user_path, CELVK_PIPELINE_CACHE_FILE);
+    pipeline_cache_save(&vk_ctx.device.handle, vk_ctx.pipeline_cache, pipeline_cache_path);
+    vkDestroyPipelineCache(vk_ctx.device.handle, vk_ctx.pipeline_cache, NULL);
 
     vk_samplers_destroy(&vk_ctx.device.handle);
     vk_images_destroy(&vk_ctx.device.handle, &vk_ctx.allocator);
+    vk_buffers_destroy(&vk_ctx.allocator);
+
+    deletion_queue_flush(&vk_ctx.device.handle, &vk_ctx.allocator, UINT64_MAX);
+
+    bindless_descriptor_destroy(&vk_ctx.device.handle, &vk_ctx.descriptor);
+    perframes_destroy(&vk_ctx.device.handle, vk_ctx.frames);
+    vkDestroySemaphore(vk_ctx.device.handle, vk_ctx.frame_timeline, NULL);
+    immediate_command_destroy(&vk_ctx.device.handle, &vk_ctx.immediate_command);
+    upload_destroy(&vk_ctx.device.handle, &vk_ctx.upload);
 
     allocator_destroy(&vk_ctx.allocator);
 
-    swapchain_destroy(&vk_ctx.device.handle, &vk_ctx.swapchain);
-    window_surface_destroy(&vk_ctx.surface.handle, &vk_ctx.instance);
+    if (!vk_ctx.headless)
+    {
+        swapchain_destroy(&vk_ctx.device.handle, &vk_ctx.swapchain);
+        window_surface_destroy(&vk_ctx.surface.handle, &vk_ctx.instance);
+    }
     device_destroy(&vk_ctx.device.handle);
 
 #if defined(CELVK_USE_VALIDATION_LAYERS)
@@ -405,36 +665,379 @@ void cel_vulkan_fini() {
 
     vkDestroyInstance(vk_ctx.instance, NULL);
     volkFinalize();
-    cel_arena_free_all(&vk_arena);
+    cel_arena_fini(&vk_arena);
 }
 
 VkCommandBuffer celvk_begin_draw() {
-    CELvk_frame_data *frame = &vk_ctx.frames[vk_ctx.frame_count % CELVK_MAX_FRAME_OVERLAP];
+    CELvk_frame_data *frame = current_frame_get();
+
+    // blocks only while the frame that last used this slot is still on the gpu, see celvk_frame_ready
+    CEL_PROFILE_BEGIN("fence wait");
+    uint64_t wait_value = frame_wait_value_get();
+    if (wait_value > frame_timeline_value_get())
+    {
+        VkSemaphoreWaitInfo wait_info = {VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        wait_info.semaphoreCount      = 1;
+        wait_info.pSemaphores         = &vk_ctx.frame_timeline;
+        wait_info.pValues             = &wait_value;
+        VK_CHECK(vkWaitSemaphores(vk_ctx.device.handle, &wait_info, UINT64_MAX));
+    }
+    CEL_PROFILE_END();
 
-    VK_CHECK(vkWaitForFences(vk_ctx.device.handle, 1, &frame->render_fence, true, UINT64_MAX));
-    VK_CHECK(vkResetFences(vk_ctx.device.handle, 1, &frame->render_fence));
+    // the gpu is done with everything this frame slot recorded, so its ring region can be rewound and its timestamps read.
+    // released objects wait on the timeline instead, a slot retiring says nothing about the frames submitted after it
+    gpu_timestamps_collect(frame);
+    deletion_queue_flush(&vk_ctx.device.handle, &vk_ctx.allocator, frame_timeline_value_get());
+    shader_watcher_swap();
+    frame->ring_head      = 0;
+    vk_sprite_batch_count = 0;
+    vk_sprite_count       = 0;
 
     VK_CHECK(vkResetCommandBuffer(frame->primary_command_buffer, 0));
+    for (uint32_t i = 0; i < CELVK_MAX_RECORD_WORKER_COUNT; ++i)
+    {
+        CELvk_worker_commands *worker = &frame->workers[i];
+        if (worker->secondary_count == 0) { continue; }
+
+        VK_CHECK(vkResetCommandPool(vk_ctx.device.handle, worker->command_pool, 0));
+        worker->secondary_count = 0;
+    }
 
     VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
     begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     VK_CHECK(vkBeginCommandBuffer(frame->primary_command_buffer, &begin_info));
 
+    frame->timestamp_frame_index = vk_ctx.frame_count;
+    if (frame->timestamp_pool) { vkCmdResetQueryPool(frame->primary_command_buffer, frame->timestamp_pool, 0, CELVK_MAX_GPU_TIMESTAMP_COUNT); }
+
+    // hand everything uploaded since the last frame to the gpu, then take ownership of it on graphics.
+    // the submit waits on the upload timeline, so the acquires only execute once the copies have landed
+    celvk_upload_flush();
+    for (uint32_t i = 0; i < vk_ctx.upload.acquire_count; ++i)
+    {
+        upload_acquire(frame->primary_command_buffer, &vk_ctx.upload.acquires[i]);
+    }
+    vk_ctx.upload.acquire_count = 0;
+    frame->upload_wait_value    = vk_ctx.upload.submitted_value;
+
     return frame->primary_command_buffer;
 }
 
-void celvk_draw() {
+bool celvk_transient_alloc(VkDeviceSize size, VkDeviceSize alignment, CELvk_transient_allocation *allocation) {
+    assert(is_power_of_two(alignment));
+
+    CELvk_frame_data *frame = current_frame_get();
+    CELvk_frame_ring *ring  = &vk_ctx.frame_ring;
+
+    VkDeviceSize head = (frame->ring_head + alignment - 1) & ~(alignment - 1);
+    if (head + size > ring->region_size) { return false; }
+    frame->ring_head = head + size;
+
+    VkDeviceSize offset        = frame->ring_offset + head;
+    allocation->data           = ring->mapped + offset;
+    allocation->buffer         = vk_buffer_get(&ring->buffer)->handle;
+    allocation->offset         = offset;
+    allocation->device_address = ring->device_address + offset;
+    return true;
+}
+
+void celvk_draw_sprites(const CELprogram_handle *program, const CELimage_handle *texture, const CELsprite *sprites, uint32_t sprite_count) {
+    uint32_t texture_idx = texture ? texture->idx : CELVK_INVALID_INDEX;
+    if (sprite_count == 0) { return; }
+
+    // batches keep raw slot indices, so stale handles are rejected here rather than while recording
+    assert(handle_pool_valid(&vk_program_pool, program->idx, program->generation) && "vulkan error: stale or invalid program handle");
+    assert((!texture || handle_pool_valid(&vk_image_pool, texture->idx, texture->generation)) && "vulkan error: stale or invalid texture handle");
+
+    CELvk_transient_allocation allocation;
+    if (!celvk_transient_alloc(sizeof(CELsprite) * sprite_count, 16, &allocation))
+    {
+        CEL_WARN("vulkan warning: frame ring full, dropping %u sprites", sprite_count);
+        return;
+    }
+    memcpy(allocation.data, sprites, sizeof(CELsprite) * sprite_count);
+
+    // sprites sharing a program and texture with the previous call, and landing right behind it in the ring,
+    // extend its batch so a whole layer submitted in pieces still costs a single instanced draw
+    if (vk_sprite_batch_count > 0)
+    {
+        CELvk_sprite_batch *last = &vk_sprite_batches[vk_sprite_batch_count - 1];
+        bool contiguous          = last->sprite_address + sizeof(CELsprite) * last->sprite_count == allocation.device_address;
+        if (contiguous && last->program.idx == program->idx && last->texture_idx == texture_idx)
+        {
+            last->sprite_count += sprite_count;
+            vk_sprite_count += sprite_count;
+            return;
+        }
+    }
+
+    if (vk_sprite_batch_count >= CELVK_MAX_SPRITE_BATCH_COUNT)
+    {
+        CEL_WARN("vulkan warning: exceeded max sprite batch count, dropping %u sprites", sprite_count);
+        return;
+    }
+
+    vk_sprite_batches[vk_sprite_batch_count++] = (CELvk_sprite_batch){
+        .program        = *program,
+        .texture_idx    = texture_idx,
+        .first_sprite   = vk_sprite_count,
+        .sprite_count   = sprite_count,
+        .sprite_address = allocation.device_address,
+    };
+    vk_sprite_count += sprite_count;
+}
+
+void celvk_draw(VkCommandBuffer cmd, const CELimage_handle *render_target, CELrgba clear_color) {
+    CELvk_image *target = vk_image_get(render_target);
+    VkExtent2D extent   = {target->extent.width, target->extent.height};
+
+    CEL_PROFILE_BEGIN("record");
+    uint32_t query = gpu_pass_begin(cmd, CELVK_GPU_PASS_SPRITES);
+    rendering_begin(cmd, render_target, clear_color, 0);
+    sprite_batches_record(cmd, extent, 0, vk_sprite_count);
+    vkCmdEndRendering(cmd);
+    gpu_pass_end(cmd, query);
+    CEL_PROFILE_END();
+}
+
+uint32_t celvk_sprite_count() {
+    return vk_sprite_count;
+}
+
+VkCommandBuffer celvk_record_sprites(uint32_t worker_index, const CELimage_handle *render_target, uint32_t first_sprite, uint32_t sprite_count) {
+    assert(worker_index < CELVK_MAX_RECORD_WORKER_COUNT && "vulkan error: record worker index out of range");
+
+    // the worker's pool is only ever touched by that worker between begin_draw and the primary executing it
+    CELvk_worker_commands *worker = &current_frame_get()->workers[worker_index];
+    if (worker->secondary_count == worker->allocated_count && worker->allocated_count == worker->secondary_capacity)
+    {
+        // one thread can claim every slice when the others sleep, so the array grows rather than dropping any.
+        // only this worker touches it, and the pool keeps the command buffers already allocated
+        uint32_t capacity            = worker->secondary_capacity ? worker->secondary_capacity * 2 : CELVK_WORKER_SECONDARY_COUNT;
+        VkCommandBuffer *secondaries = realloc(worker->secondaries, sizeof(VkCommandBuffer) * capacity);
+        if (!secondaries)
+        {
+            CEL_ERROR("vulkan error: out of memory growing record worker %u to %u secondaries, dropping %u sprites", worker_index, capacity, sprite_count);
+            return VK_NULL_HANDLE;
+        }
+        worker->secondaries        = secondaries;
+        worker->secondary_capacity = capacity;
+    }
+
+    if (worker->secondary_count == worker->allocated_count)
+    {
+        VkCommandBufferAllocateInfo buffer_allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        buffer_allocate_info.commandPool                 = worker->command_pool;
+        buffer_allocate_info.commandBufferCount          = 1;
+        buffer_allocate_info.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        VK_CHECK(vkAllocateCommandBuffers(vk_ctx.device.handle, &buffer_allocate_info, &worker->secondaries[worker->allocated_count++]));
+    }
+    VkCommandBuffer cmd = worker->secondaries[worker->secondary_count++];
+
+    CELvk_image *target = vk_image_get(render_target);
+    VkExtent2D extent   = {target->extent.width, target->extent.height};
+
+    VkCommandBufferInheritanceRenderingInfo inheritance_rendering_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    inheritance_rendering_info.colorAttachmentCount                    = 1;
+    inheritance_rendering_info.pColorAttachmentFormats                 = &target->format;
+    inheritance_rendering_info.rasterizationSamples                    = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance_info.pNext                          = &inheritance_rendering_info;
+
+    VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    begin_info.pInheritanceInfo         = &inheritance_info;
+
+    CEL_PROFILE_BEGIN("record");
+    VK_CHECK(vkBeginCommandBuffer(cmd, &begin_info));
+    sprite_batches_record(cmd, extent, first_sprite, sprite_count);
+    VK_CHECK(vkEndCommandBuffer(cmd));
+    CEL_PROFILE_END();
+
+    return cmd;
+}
+
+void celvk_draw_secondaries(VkCommandBuffer cmd, const CELimage_handle *render_target, CELrgba clear_color, const VkCommandBuffer *secondaries, uint32_t secondary_count) {
+    // the timestamps sit outside the rendering, whose contents may only come from the secondaries
+    CEL_PROFILE_BEGIN("record");
+    uint32_t query = gpu_pass_begin(cmd, CELVK_GPU_PASS_SPRITES);
+    rendering_begin(cmd, render_target, clear_color, VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT);
+    for (uint32_t i = 0; i < secondary_count; ++i)
+    {
+        if (secondaries[i] == VK_NULL_HANDLE) { continue; }
+        vkCmdExecuteCommands(cmd, 1, &secondaries[i]);
+    }
+    vkCmdEndRendering(cmd);
+    gpu_pass_end(cmd, query);
+    CEL_PROFILE_END();
+}
+
+void rendering_begin(VkCommandBuffer cmd, const CELimage_handle *render_target, CELrgba clear_color, VkRenderingFlags flags) {
+    CELvk_image *target = vk_image_get(render_target);
+    VkExtent2D extent   = {target->extent.width, target->extent.height};
+
+    celvk_transition_image(cmd, render_target, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+    VkRenderingAttachmentInfo color_attachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+    color_attachment.imageView                 = target->image_view;
+    color_attachment.imageLayout               = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    color_attachment.loadOp                    = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    color_attachment.storeOp                   = VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.clearValue.color          = (VkClearColorValue){{clear_color.r, clear_color.g, clear_color.b, clear_color.a}};
+
+    VkRenderingInfo rendering_info      = {VK_STRUCTURE_TYPE_RENDERING_INFO};
+    rendering_info.flags                = flags;
+    rendering_info.renderArea           = (VkRect2D){{0, 0}, extent};
+    rendering_info.layerCount           = 1;
+    rendering_info.colorAttachmentCount = 1;
+    rendering_info.pColorAttachments    = &color_attachment;
+
+    vkCmdBeginRendering(cmd, &rendering_info);
+}
+
+void render_texture_blit(VkCommandBuffer cmd, const CELimage_handle *source, const CELimage_handle *destination) {
+    CELvk_image *src = vk_image_get(source);
+    CELvk_image *dst = vk_image_get(destination);
+
+    celvk_transition_image(cmd, source, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    celvk_transition_image(cmd, destination, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+
+    // fit the whole texture inside the destination at its own aspect, centered
+    uint32_t width  = dst->extent.width;
+    uint32_t height = (uint32_t) ((uint64_t) src->extent.height * dst->extent.width / src->extent.width);
+    if (height > dst->extent.height)
+    {
+        height = dst->extent.height;
+        width  = (uint32_t) ((uint64_t) src->extent.width * dst->extent.height / src->extent.height);
+    }
+    int32_t x = (int32_t) (dst->extent.width - width) / 2;
+    int32_t y = (int32_t) (dst->extent.height - height) / 2;
+
+    if (width != dst->extent.width || height != dst->extent.height)
+    {
+        VkClearColorValue clear_color       = {{0.0f, 0.0f, 0.0f, 1.0f}};
+        VkImageSubresourceRange clear_range = {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel   = 0,
+            .levelCount     = 1,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        };
+        vkCmdClearColorImage(cmd, dst->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clear_color, 1, &clear_range);
+        celvk_transition_image(cmd, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    }
+
+    VkImageBlit2 region              = {VK_STRUCTURE_TYPE_IMAGE_BLIT_2};
+    region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.srcSubresource.layerCount = 1;
+    region.srcOffsets[1]             = (VkOffset3D){(int32_t) src->extent.width, (int32_t) src->extent.height, 1};
+    region.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.dstSubresource.layerCount = 1;
+    region.dstOffsets[0]             = (VkOffset3D){x, y, 0};
+    region.dstOffsets[1]             = (VkOffset3D){x + (int32_t) width, y + (int32_t) height, 1};
+
+    // whole multiples keep pixel art crisp, anything else is smoothed
+    bool integer_scale = width % src->extent.width == 0 && height % src->extent.height == 0;
+
+    VkBlitImageInfo2 blit_info = {VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2};
+    blit_info.srcImage         = src->handle;
+    blit_info.srcImageLayout   = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    blit_info.dstImage         = dst->handle;
+    blit_info.dstImageLayout   = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    blit_info.regionCount      = 1;
+    blit_info.pRegions         = &region;
+    blit_info.filter           = integer_scale ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+    vkCmdBlitImage2(cmd, &blit_info);
+
+    celvk_transition_image(cmd, destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+}
+
+void sprite_batches_record(VkCommandBuffer cmd, VkExtent2D extent, uint32_t first_sprite, uint32_t sprite_count) {
+    // dynamic state is not inherited by secondaries, so every slice sets its own
+    VkViewport viewport = {0.0f, 0.0f, (float) extent.width, (float) extent.height, 0.0f, 1.0f};
+    VkRect2D scissor    = {{0, 0}, extent};
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    if (vk_sprite_batch_count == 0 || sprite_count == 0) { return; }
+
+    CELsprite_renderer_pc pc = {
+        .sampler_idx = vk_ctx.descriptor.nearest_sampler.idx,
+        .screen_size = {(float) extent.width, (float) extent.height},
+    };
+
+    // batches are ordered by first_sprite, find the one holding the start of the slice
+    uint32_t lo = 0;
+    uint32_t hi = vk_sprite_batch_count;
+    while (lo + 1 < hi)
+    {
+        uint32_t mid = (lo + hi) / 2;
+        if (vk_sprite_batches[mid].first_sprite <= first_sprite) { lo = mid; }
+        else { hi = mid; }
+    }
+
+    uint32_t end_sprite    = first_sprite + sprite_count;
+    uint32_t bound_program = CELVK_INVALID_INDEX;
+    for (uint32_t i = lo; i < vk_sprite_batch_count && vk_sprite_batches[i].first_sprite < end_sprite; ++i)
+    {
+        const CELvk_sprite_batch *batch = &vk_sprite_batches[i];
+        const CELvk_program *program    = &vk_programs[batch->program.idx];
+
+        uint32_t begin = batch->first_sprite > first_sprite ? batch->first_sprite : first_sprite;
+        uint32_t end   = batch->first_sprite + batch->sprite_count < end_sprite ? batch->first_sprite + batch->sprite_count : end_sprite;
+        if (begin >= end) { continue; }
+
+        if (bound_program != batch->program.idx)
+        {
+            vkCmdBindPipeline(cmd, program->bind_point, program->pipeline);
+            vkCmdBindDescriptorSets(cmd, program->bind_point, program->layout, 0, 1, &vk_ctx.descriptor.set, 0, NULL);
+            bound_program = batch->program.idx;
+        }
+
+        pc.buffer_device_address = batch->sprite_address;
+        pc.texture_idx           = batch->texture_idx;
+        vkCmdPushConstants(cmd, program->layout, VK_SHADER_STAGE_ALL, 0, sizeof(CELsprite_renderer_pc), &pc);
+
+        // one quad (6 vertices) per instance, the vertex shader indexes the sprite buffer with gl_InstanceIndex,
+        // which starts at first instance so a slice can begin partway through a batch
+        vkCmdDraw(cmd, 6, end - begin, 0, begin - batch->first_sprite);
+    }
 }
 
 void celvk_end_draw(VkCommandBuffer cmd, CELimage_handle render_texture_handle) {
-    uint32_t image_index;
-    uint32_t current_frame_index = vk_ctx.frame_count % CELVK_MAX_FRAME_OVERLAP;
+    uint32_t image_index         = CELVK_INVALID_INDEX;
+    uint32_t current_frame_index = vk_ctx.frame_count % vk_ctx.frames_in_flight;
+
+    if (!vk_ctx.headless)
+    {
+        // an out of date swapchain is rebuilt and acquired from once more, a minimized window keeps it
+        // dirty and the frame is submitted without presenting
+        CEL_PROFILE_BEGIN("acquire image");
+        bool acquired = false;
+        for (uint32_t attempt = 0; attempt < 2 && !acquired; ++attempt)
+        {
+            if (vk_ctx.swapchain.dirty && !swapchain_recreate()) { break; }
+            acquired = swapchain_acquire_next_image(&vk_ctx.device.handle, current_frame_index, &image_index);
+        }
+        CEL_PROFILE_END();
 
-    CELimage_handle swapchain_image = swapchain_acquire_next_image(&vk_ctx.device.handle, current_frame_index, &image_index);
+        if (acquired)
+        {
+            CELimage_handle swapchain_image = vk_ctx.swapchain.swapchain_images[image_index];
 
-    celvk_clear_background(cmd, &swapchain_image, (CELrgba){1.0f, 0.0f, 1.0f, 1.0f});
-    celvk_transition_image(cmd, &swapchain_image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+            uint32_t query = gpu_pass_begin(cmd, CELVK_GPU_PASS_BLIT);
+            if (celvk_image_valid(&render_texture_handle)) { render_texture_blit(cmd, &render_texture_handle, &swapchain_image); }
+            else
+            {
+                // magenta makes a missing render texture obvious
+                celvk_clear_background(cmd, &swapchain_image, (CELrgba){1.0f, 0.0f, 1.0f, 1.0f});
+                celvk_transition_image(cmd, &swapchain_image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+            }
+            gpu_pass_end(cmd, query);
+        }
+    }
 
     VK_CHECK(vkEndCommandBuffer(cmd));
 
@@ -442,6 +1045,97 @@ void celvk_end_draw(VkCommandBuffer cmd, CELimage_handle render_texture_handle)
     vk_ctx.frame_count++;
 }
 
+void celvk_swapchain_invalidate() {
+    vk_ctx.swapchain.dirty = true;
+}
+
+void celvk_present_mode_set(CELvk_present_mode mode) {
+    if (mode >= CELVK_PRESENT_MODE_COUNT) { mode = CELVK_PRESENT_MODE_FIFO; }
+    vk_ctx.swapchain.requested_mode = mode;
+    if (vk_ctx.headless) { return; }
+
+    // only a mode the surface would actually switch to is worth a rebuild
+    VkPresentModeKHR present_mode = present_mode_resolve(mode);
+    if (present_mode != vk_ctx.swapchain.present_mode) { vk_ctx.swapchain.dirty = true; }
+}
+
+CELvk_present_mode celvk_present_mode_get() {
+    switch (vk_ctx.swapchain.present_mode)
+    {
+        case VK_PRESENT_MODE_MAILBOX_KHR: return CELVK_PRESENT_MODE_MAILBOX;
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return CELVK_PRESENT_MODE_IMMEDIATE;
+        default: return CELVK_PRESENT_MODE_FIFO;
+    }
+}
+
+const char *celvk_present_mode_name(CELvk_present_mode mode) {
+    switch (mode)
+    {
+        case CELVK_PRESENT_MODE_FIFO: return "fifo";
+        case CELVK_PRESENT_MODE_MAILBOX: return "mailbox";
+        case CELVK_PRESENT_MODE_IMMEDIATE: return "immediate";
+        default: return "unknown";
+    }
+}
+
+void celvk_swapchain_image_count_set(uint32_t count) {
+    vk_ctx.swapchain.requested_image_count = count;
+    if (vk_ctx.headless) { return; }
+
+    uint32_t min_image_count = prefer_swapchain_image_count_get(&vk_ctx.swapchain.surface_capabilities, count);
+    if (min_image_count != vk_ctx.swapchain.min_image_count) { vk_ctx.swapchain.dirty = true; }
+}
+
+uint32_t celvk_swapchain_image_count_get() {
+    return vk_ctx.swapchain.image_count;
+}
+
+void celvk_frame_lead_set(uint32_t lead) {
+    if (lead == 0 || lead > vk_ctx.frames_in_flight) { lead = vk_ctx.frames_in_flight; }
+    vk_ctx.frame_lead = lead;
+}
+
+uint32_t celvk_frame_lead_get() {
+    return vk_ctx.frame_lead;
+}
+
+uint64_t celvk_frame_index() {
+    return vk_ctx.frame_count;
+}
+
+bool celvk_frame_retired(uint64_t frame_index) {
+    return frame_timeline_value_get() > frame_index;
+}
+
+bool celvk_frame_ready() {
+    return frame_wait_value_get() <= frame_timeline_value_get();
+}
+
+void celvk_frame_wait(uint64_t frame_index) {
+    uint64_t value                = frame_index + 1;
+    VkSemaphoreWaitInfo wait_info = {VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    wait_info.semaphoreCount      = 1;
+    wait_info.pSemaphores         = &vk_ctx.frame_timeline;
+    wait_info.pValues             = &value;
+    VK_CHECK(vkWaitSemaphores(vk_ctx.device.handle, &wait_info, UINT64_MAX));
+}
+
+bool celvk_gpu_timings_get(CELvk_gpu_timings *timings) {
+    if (!vk_ctx.gpu_timings_valid) { return false; }
+    *timings = vk_ctx.gpu_timings;
+    return true;
+}
+
+const char *celvk_gpu_pass_name(CELvk_gpu_pass pass) {
+    switch (pass)
+    {
+        case CELVK_GPU_PASS_CLEAR: return "clear";
+        case CELVK_GPU_PASS_SPRITES: return "sprites";
+        case CELVK_GPU_PASS_BLIT: return "blit";
+        default: return "unknown";
+    }
+}
+
 void celvk_clear_background(VkCommandBuffer cmd, const CELimage_handle *handle, CELrgba color) {
     VkClearColorValue clearColorValue  = {{color.r, color.g, color.b, color.a}};
     VkImageSubresourceRange clearRange = {
@@ -452,14 +1146,16 @@ void celvk_clear_background(VkCommandBuffer cmd, const CELimage_handle *handle,
         .levelCount     = 1,
     };
 
-    CELvk_image *image = &vk_images[handle->idx];
+    CELvk_image *image = vk_image_get(handle);
+    uint32_t query     = gpu_pass_begin(cmd, CELVK_GPU_PASS_CLEAR);
     celvk_transition_image(cmd, handle, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL);
     vkCmdClearColorImage(cmd, image->handle, VK_IMAGE_LAYOUT_GENERAL, &clearColorValue, 1, &clearRange);
     celvk_transition_image(cmd, handle, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    gpu_pass_end(cmd, query);
 }
 
 void celvk_transition_image(VkCommandBuffer cmd, const CELimage_handle *handle, VkImageLayout old_layout, VkImageLayout new_layout) {
-    CELvk_image *image = &vk_images[handle->idx];
+    CELvk_image *image = vk_image_get(handle);
 
     VkImageAspectFlags aspect_flags           = (old_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || new_layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL || new_layout == VK_IMAGE_LAYOUT_DEPTH_READ_ONLY_STENCIL_ATTACHMENT_OPTIMAL) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
     VkImageSubresourceRange subresource_range = {
@@ -474,7 +1170,7 @@ void celvk_transition_image(VkCommandBuffer cmd, const CELimage_handle *handle,
     barrier2.srcStageMask          = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
     barrier2.srcAccessMask         = VK_ACCESS_2_MEMORY_WRITE_BIT;
     barrier2.dstStageMask          = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
-    barrier2.dstAccessMask         = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier2.dstAccessMask         = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
     barrier2.oldLayout             = old_layout;
     barrier2.newLayout             = new_layout;
     barrier2.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
@@ -624,15 +1320,16 @@ uint32_t queue_family_count_get(VkPhysicalDevice *physical_device) {
     return queue_family_index;
 }
 
-VkQueueFamilyProperties *queue_family_properties_get(VkPhysicalDevice *physical_device, uint32_t queue_family_count) {
-    VkQueueFamilyProperties *queue_family_properties = cel_arena_alloc(&vk_arena, sizeof(VkQueueFamilyProperties) * queue_family_count);
+VkQueueFamilyProperties *queue_family_properties_get(CELarena *arena, VkPhysicalDevice *physical_device, uint32_t queue_family_count) {
+    VkQueueFamilyProperties *queue_family_properties = cel_arena_alloc(arena, sizeof(VkQueueFamilyProperties) * queue_family_count);
     vkGetPhysicalDeviceQueueFamilyProperties(*physical_device, &queue_family_count, queue_family_properties);
     return queue_family_properties;
 }
 
 uint32_t graphics_queue_family_index_get(VkQueueFamilyProperties *queue_family_properties, uint32_t queue_family_count) {
+    CELarena_temp scratch                   = cel_arena_scratch_get(NULL, 0);
     uint32_t graphics_queue_family_count    = 0;
-    uint32_t *graphics_queue_family_indices = cel_arena_alloc(&vk_arena, sizeof(uint32_t) * queue_family_count);
+    uint32_t *graphics_queue_family_indices = cel_arena_alloc(scratch.arena, sizeof(uint32_t) * queue_family_count);
 
     for (uint32_t i = 0; i < queue_family_count; ++i)
     {
@@ -651,13 +1348,29 @@ uint32_t graphics_queue_family_index_get(VkQueueFamilyProperties *queue_family_p
         if (queue_family_properties[graphics_queue_family_indices[i]].queueCount > best_graphics_queue_family_queue_count)
         {
             best_graphics_queue_family_queue_count = queue_family_properties[graphics_queue_family_indices[i]].queueCount;
-            best_graphics_queue_family_queue_index = i;
+            best_graphics_queue_family_queue_index = graphics_queue_family_indices[i];
         }
     }
 
+    cel_arena_scratch_release(scratch);
     return best_graphics_queue_family_queue_index;
 }
 
+uint32_t transfer_queue_family_index_get(VkQueueFamilyProperties *queue_family_properties, uint32_t queue_family_count, uint32_t graphics_queue_family_index) {
+    // prefer a transfer only family (the copy engine), then any non graphics family, else share the graphics family
+    uint32_t async_compute_queue_family_index = graphics_queue_family_index;
+    for (uint32_t i = 0; i < queue_family_count; ++i)
+    {
+        VkQueueFlags flags = queue_family_properties[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) == 0 || (flags & VK_QUEUE_GRAPHICS_BIT) != 0) { continue; }
+
+        if ((flags & VK_QUEUE_COMPUTE_BIT) == 0) { return i; }
+        if (async_compute_queue_family_index == graphics_queue_family_index) { async_compute_queue_family_index = i; }
+    }
+
+    return async_compute_queue_family_index;
+}
+
 uint32_t graphics_queue_mode_get(VkQueueFamilyProperties *queue_family_properties, uint32_t graphics_queue_family_index) {
     if (queue_family_properties[graphics_queue_family_index].queueCount == 1) { return 0; }
     else if (queue_family_properties[graphics_queue_family_index].queueCount > 1) { return 1; }
@@ -678,12 +1391,13 @@ VkQueue present_queue_get(VkDevice *device, uint32_t graphics_queue_family_index
 }
 
 VkDevice device_create(VkPhysicalDevice *physical_device, uint32_t queue_family_count, VkQueueFamilyProperties *queue_family_properties) {
-    VkDeviceQueueCreateInfo *device_queue_create_infos = cel_arena_alloc(&vk_arena, sizeof(VkDeviceQueueCreateInfo) * queue_family_count);
-    float **queue_priorities                           = cel_arena_alloc(&vk_arena, sizeof(float *) * queue_family_count);
+    CELarena_temp scratch                              = cel_arena_scratch_get(NULL, 0);
+    VkDeviceQueueCreateInfo *device_queue_create_infos = cel_arena_alloc(scratch.arena, sizeof(VkDeviceQueueCreateInfo) * queue_family_count);
+    float **queue_priorities                           = cel_arena_alloc(scratch.arena, sizeof(float *) * queue_family_count);
 
     for (uint32_t i = 0; i < queue_family_count; ++i)
     {
-        queue_priorities[i] = cel_arena_alloc(&vk_arena, sizeof(float) * queue_family_properties[i].queueCount);
+        queue_priorities[i] = cel_arena_alloc(scratch.arena, sizeof(float) * queue_family_properties[i].queueCount);
         for (uint32_t j = 0; j < queue_family_properties[i].queueCount; ++j)
         {
             queue_priorities[i][j] = 1.0f;
@@ -697,9 +1411,10 @@ VkDevice device_create(VkPhysicalDevice *physical_device, uint32_t queue_family_
         device_queue_create_infos[i].pQueuePriorities = queue_priorities[i];
     }
 
-    const char extension_list[][VK_MAX_EXTENSION_NAME_SIZE] = {"VK_KHR_swapchain"};
-    const char *extensions[CELVK_MAX_EXTENSION_COUNT]       = {extension_list[0]};
-    uint32_t extensions_count                               = 0;
+    // the swapchain extension depends on the surface ones a headless instance never enables
+    const char *extensions[CELVK_MAX_EXTENSION_COUNT];
+    uint32_t extensions_count = 0;
+    if (!vk_ctx.headless) { extensions[extensions_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME; }
 
     if (vk_ctx.raytracing_supported)
     {
@@ -728,6 +1443,7 @@ VkDevice device_create(VkPhysicalDevice *physical_device, uint32_t queue_family_
     features_1_2.descriptorBindingPartiallyBound              = true;
     features_1_2.descriptorBindingUpdateUnusedWhilePending    = true;
     features_1_2.runtimeDescriptorArray                       = true;
+    features_1_2.timelineSemaphore                            = true;
     if (vk_ctx.raytracing_supported) { features_1_2.bufferDeviceAddress = true; }
 
     VkPhysicalDeviceVulkan11Features features_1_1 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
@@ -742,13 +1458,14 @@ VkDevice device_create(VkPhysicalDevice *physical_device, uint32_t queue_family_
     device_create_info.flags                   = 0;
     device_create_info.queueCreateInfoCount    = queue_family_count;
     device_create_info.pQueueCreateInfos       = device_queue_create_infos;
-    device_create_info.enabledExtensionCount   = 1;
+    device_create_info.enabledExtensionCount   = extensions_count;
     device_create_info.ppEnabledExtensionNames = extensions;
     device_create_info.pEnabledFeatures        = NULL;
 
     VkDevice device = NULL;
     vkCreateDevice(*physical_device, &device_create_info, NULL, &device);
 
+    cel_arena_scratch_release(scratch);
     return device;
 }
 
@@ -790,62 +1507,141 @@ VkSurfaceFormatKHR prefer_surface_format_get(VkSurfaceKHR *surface, VkPhysicalDe
     uint32_t surface_format_count = 0;
     vkGetPhysicalDeviceSurfaceFormatsKHR(*physical_device, *surface, &surface_format_count, NULL);
 
-    VkSurfaceFormatKHR *surface_formats = cel_arena_alloc(&vk_arena, sizeof(VkSurfaceKHR) * surface_format_count);
+    CELarena_temp scratch               = cel_arena_scratch_get(NULL, 0);
+    VkSurfaceFormatKHR *surface_formats = cel_arena_alloc(scratch.arena, sizeof(VkSurfaceFormatKHR) * surface_format_count);
     vkGetPhysicalDeviceSurfaceFormatsKHR(*physical_device, *surface, &surface_format_count, surface_formats);
 
     VkSurfaceFormatKHR prefer_surface_format = surface_formats[0];
+    cel_arena_scratch_release(scratch);
     return prefer_surface_format;
 }
 
-VkPresentModeKHR prefer_present_mode_get(VkSurfaceKHR *surface, VkPhysicalDevice *physical_device) {
-    uint32_t present_mode_count = 0;
-    vkGetPhysicalDeviceSurfacePresentModesKHR(*physical_device, *surface, &present_mode_count, NULL);
-
-    VkPresentModeKHR *present_modes = cel_arena_alloc(&vk_arena, sizeof(VkPresentModeKHR) * present_mode_count);
+uint32_t present_mode_mask_get(VkSurfaceKHR *surface, VkPhysicalDevice *physical_device) {
+    VkPresentModeKHR present_modes[16];
+    uint32_t present_mode_count = 16;
     vkGetPhysicalDeviceSurfacePresentModesKHR(*physical_device, *surface, &present_mode_count, present_modes);
 
-    VkPresentModeKHR prefer_present_mode = VK_PRESENT_MODE_FIFO_KHR;// VSYNC
+    uint32_t present_mode_mask = 1u << VK_PRESENT_MODE_FIFO_KHR;// required of every surface
     for (uint32_t i = 0; i < present_mode_count; ++i)
     {
-        if (present_modes[i] == VK_PRESENT_MODE_MAILBOX_KHR) { prefer_present_mode = VK_PRESENT_MODE_MAILBOX_KHR; }
+        if (present_modes[i] <= VK_PRESENT_MODE_FIFO_RELAXED_KHR) { present_mode_mask |= 1u << present_modes[i]; }
+    }
+    return present_mode_mask;
+}
+
+VkPresentModeKHR prefer_present_mode_get(uint32_t present_mode_mask, CELvk_present_mode mode) {
+    // each mode falls through to the next closest one, ending at fifo
+    switch (mode)
+    {
+        case CELVK_PRESENT_MODE_IMMEDIATE:
+            if (present_mode_mask & (1u << VK_PRESENT_MODE_IMMEDIATE_KHR)) { return VK_PRESENT_MODE_IMMEDIATE_KHR; }
+            // fallthrough
+        case CELVK_PRESENT_MODE_MAILBOX:
+            if (present_mode_mask & (1u << VK_PRESENT_MODE_MAILBOX_KHR)) { return VK_PRESENT_MODE_MAILBOX_KHR; }
+            // fallthrough
+        default: return VK_PRESENT_MODE_FIFO_KHR;
+    }
+}
+
+VkPresentModeKHR present_mode_resolve(CELvk_present_mode mode) {
+    VkPresentModeKHR present_mode = prefer_present_mode_get(vk_ctx.swapchain.present_mode_mask, mode);
+    if (present_mode != prefer_present_mode_get(~0u, mode))
+    {
+        CEL_WARN("vulkan warning: the surface does not support %s present mode, falling back", celvk_present_mode_name(mode));
     }
+    return present_mode;
+}
 
-    return prefer_present_mode;
+uint32_t prefer_swapchain_image_count_get(VkSurfaceCapabilitiesKHR *surface_capabilities, uint32_t requested_count) {
+    // a max of 0 means the surface sets no upper limit
+    uint32_t count = requested_count ? requested_count : surface_capabilities->minImageCount + 1;
+    if (count < surface_capabilities->minImageCount) { count = surface_capabilities->minImageCount; }
+    if (surface_capabilities->maxImageCount && count > surface_capabilities->maxImageCount) { count = surface_capabilities->maxImageCount; }
+    if (count > CELVK_MAX_SWAPCHAIN_IMAGE_COUNT) { count = CELVK_MAX_SWAPCHAIN_IMAGE_COUNT; }
+    return count;
 }
 
 VkExtent2D prefer_swapchain_extent_get(VkSurfaceCapabilitiesKHR *surface_capabilities, GLFWwindow *window) {
+    // the surface dictates the extent unless it reports the special value, then the framebuffer picks it
+    if (surface_capabilities->currentExtent.width != UINT32_MAX) { return surface_capabilities->currentExtent; }
+
     int fbo_width  = 0;
     int fbo_height = 0;
     glfwGetFramebufferSize(window, &fbo_width, &fbo_height);
 
-    VkExtent2D prefer_swapchain_extent;
-    if (surface_capabilities->currentExtent.width < fbo_width) { prefer_swapchain_extent.width = surface_capabilities->currentExtent.width; }
-    else { prefer_swapchain_extent.width = fbo_width; }
-
-    if (surface_capabilities->currentExtent.height < fbo_height) { prefer_swapchain_extent.height = surface_capabilities->currentExtent.height; }
-    else { prefer_swapchain_extent.height = fbo_height; }
+    VkExtent2D prefer_swapchain_extent = {(uint32_t) fbo_width, (uint32_t) fbo_height};
+    if (prefer_swapchain_extent.width < surface_capabilities->minImageExtent.width) { prefer_swapchain_extent.width = surface_capabilities->minImageExtent.width; }
+    if (prefer_swapchain_extent.width > surface_capabilities->maxImageExtent.width) { prefer_swapchain_extent.width = surface_capabilities->maxImageExtent.width; }
+    if (prefer_swapchain_extent.height < surface_capabilities->minImageExtent.height) { prefer_swapchain_extent.height = surface_capabilities->minImageExtent.height; }
+    if (prefer_swapchain_extent.height > surface_capabilities->maxImageExtent.height) { prefer_swapchain_extent.height = surface_capabilities->maxImageExtent.height; }
 
     return prefer_swapchain_extent;
 }
 
-VkSwapchainKHR swapchain_create(VkDevice *device, VkSurfaceKHR *surface, VkSurfaceCapabilitiesKHR *surface_capabilities, VkSurfaceFormatKHR *surface_format, VkExtent2D *swapchain_extent, const VkPresentModeKHR *present_mode, uint32_t image_array_layers, uint32_t graphics_queue_mode) {
-    VkSharingMode image_sharing_mode  = VK_SHARING_MODE_EXCLUSIVE;
-    uint32_t queue_family_index_count = 0;
-    uint32_t *p_queue_family_indices  = NULL;
-    uint32_t que_family_indices[]     = {0, 1};
-
-    if (graphics_queue_mode == 1)
-    {
-        image_sharing_mode       = VK_SHARING_MODE_CONCURRENT;
-        queue_family_index_count = 2;
-        p_queue_family_indices   = que_family_indices;
-    }
+bool swapchain_setup(GLFWwindow *window) {
+    vk_ctx.surface.handle            = window_surface_create(window, &vk_ctx.instance);
+    vk_ctx.surface.surface_supported = window_surface_support_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle, vk_ctx.device.graphics_queue_family_index);
+    if (!vk_ctx.surface.surface_supported) { return false; }
+
+    vk_ctx.swapchain.surface_capabilities = window_surface_capabilities_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
+    vk_ctx.swapchain.surface_format       = prefer_surface_format_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
+    vk_ctx.swapchain.present_mode_mask    = present_mode_mask_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
+    vk_ctx.swapchain.present_mode         = present_mode_resolve(vk_ctx.swapchain.requested_mode);
+    vk_ctx.swapchain.min_image_count      = prefer_swapchain_image_count_get(&vk_ctx.swapchain.surface_capabilities, vk_ctx.swapchain.requested_image_count);
+    vk_ctx.swapchain.swapchain_extent     = prefer_swapchain_extent_get(&vk_ctx.swapchain.surface_capabilities, window);
+    vk_ctx.swapchain.image_array_layers   = 1;
+    vk_ctx.swapchain.image_count          = 0;
+
+    vk_ctx.swapchain.handle = swapchain_create(&vk_ctx.device.handle, &vk_ctx.surface.handle, &vk_ctx.swapchain.surface_capabilities, &vk_ctx.swapchain.surface_format, &vk_ctx.swapchain.swapchain_extent, &vk_ctx.swapchain.present_mode, vk_ctx.swapchain.min_image_count, vk_ctx.swapchain.image_array_layers, vk_ctx.device.graphics_queue_family_index, VK_NULL_HANDLE);
+    swapchain_images_bind(&vk_ctx.device.handle, &vk_ctx.swapchain);
+
+
+    return true;
+}
+
+bool swapchain_recreate() {
+    // a minimized window has no extent to build for, stay dirty until it comes back
+    vk_ctx.swapchain.surface_capabilities = window_surface_capabilities_get(&vk_ctx.surface.handle, &vk_ctx.physical_device.handle);
+    VkExtent2D extent                     = prefer_swapchain_extent_get(&vk_ctx.swapchain.surface_capabilities, vk_ctx.window);
+    if (extent.width == 0 || extent.height == 0) { return false; }
+
+    CEL_PROFILE_BEGIN("swapchain recreate");
+    vk_ctx.swapchain.swapchain_extent = extent;
+    vk_ctx.swapchain.present_mode     = present_mode_resolve(vk_ctx.swapchain.requested_mode);
+    vk_ctx.swapchain.min_image_count  = prefer_swapchain_image_count_get(&vk_ctx.swapchain.surface_capabilities, vk_ctx.swapchain.requested_image_count);
+
+    // the old swapchain retires the moment the new one is created, but frames still in flight may present from it.
+    // it is destroyed once every frame submitted before it has retired
+    VkSwapchainKHR old_swapchain = vk_ctx.swapchain.handle;
+    vk_ctx.swapchain.handle      = swapchain_create(&vk_ctx.device.handle, &vk_ctx.surface.handle, &vk_ctx.swapchain.surface_capabilities, &vk_ctx.swapchain.surface_format, &vk_ctx.swapchain.swapchain_extent, &vk_ctx.swapchain.present_mode, vk_ctx.swapchain.min_image_count, vk_ctx.swapchain.image_array_layers, vk_ctx.device.graphics_queue_family_index, old_swapchain);
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_SWAPCHAIN_KHR, .handle.swapchain = old_swapchain});
+
+    swapchain_images_bind(&vk_ctx.device.handle, &vk_ctx.swapchain);
+    vk_ctx.swapchain.dirty = false;
+    CEL_PROFILE_END();
+
+    CEL_INFO("swapchain recreated at %ux%u with %u images, %s", extent.width, extent.height, vk_ctx.swapchain.image_count, celvk_present_mode_name(celvk_present_mode_get()));
+    return true;
+}
+
+VkSwapchainKHR swapchain_create(VkDevice *device, VkSurfaceKHR *surface, VkSurfaceCapabilitiesKHR *surface_capabilities, VkSurfaceFormatKHR *surface_format, VkExtent2D *swapchain_extent, const VkPresentModeKHR *present_mode, uint32_t min_image_count, uint32_t image_array_layers, uint32_t graphics_queue_mode, VkSwapchainKHR old_swapchain) {
+    VkSharingMode image_sharing_mode  = VK_SHARING_MODE_EXCLUSIVE;
+    uint32_t queue_family_index_count = 0;
+    uint32_t *p_queue_family_indices  = NULL;
+    uint32_t que_family_indices[]     = {0, 1};
+
+    if (graphics_queue_mode == 1)
+    {
+        image_sharing_mode       = VK_SHARING_MODE_CONCURRENT;
+        queue_family_index_count = 2;
+        p_queue_family_indices   = que_family_indices;
+    }
 
     VkSwapchainCreateInfoKHR create_info = {VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR};
     create_info.pNext                    = NULL;
     create_info.flags                    = 0;
     create_info.surface                  = *surface;
-    create_info.minImageCount            = surface_capabilities->minImageCount + 1;
+    create_info.minImageCount            = min_image_count;
     create_info.imageFormat              = surface_format->format;
     create_info.imageColorSpace          = surface_format->colorSpace;
     create_info.imageExtent              = *swapchain_extent;
@@ -858,7 +1654,7 @@ VkSwapchainKHR swapchain_create(VkDevice *device, VkSurfaceKHR *surface, VkSurfa
     create_info.compositeAlpha           = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     create_info.presentMode              = *present_mode;
     create_info.clipped                  = VK_TRUE;
-    create_info.oldSwapchain             = NULL;
+    create_info.oldSwapchain             = old_swapchain;
 
     VkSwapchainKHR swapchain = NULL;
     VK_CHECK(vkCreateSwapchainKHR(*device, &create_info, NULL, &swapchain));
@@ -870,56 +1666,114 @@ void swapchain_destroy(VkDevice *device, CELvk_swapchain *swapchain) {
     vkDestroySwapchainKHR(*device, swapchain->handle, NULL);
 }
 
-uint32_t swapchain_image_count_get(VkDevice *device, VkSwapchainKHR *swapchain) {
-    uint32_t swapchain_image_count = 0;
-    vkGetSwapchainImagesKHR(*device, *swapchain, &swapchain_image_count, NULL);
-    return swapchain_image_count;
-}
+void swapchain_images_bind(VkDevice *device, CELvk_swapchain *swapchain) {
+    VkImage images[CELVK_MAX_SWAPCHAIN_IMAGE_COUNT];
+    uint32_t image_count = CELVK_MAX_SWAPCHAIN_IMAGE_COUNT;
+    VkResult result      = vkGetSwapchainImagesKHR(*device, swapchain->handle, &image_count, images);
+    if (result == VK_INCOMPLETE) { CEL_WARN("vulkan warning: swapchain has more than %u images, using the first ones", CELVK_MAX_SWAPCHAIN_IMAGE_COUNT); }
+    else { VK_CHECK(result); }
+
+    CELvk_image_create_info create_info = {
+        .format            = swapchain->surface_format.format,
+        .usages            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        .base_array_layers = swapchain->image_array_layers,
+        .extent            = (VkExtent3D){swapchain->swapchain_extent.width, swapchain->swapchain_extent.height, 1},
+    };
 
-VkImage *swapchain_images_get(VkDevice *device, VkSwapchainKHR *swapchain, uint32_t swapchain_image_count) {
-    VkImage *swapchain_images = cel_arena_alloc(&vk_arena, sizeof(VkImage) * swapchain_image_count);
-    vkGetSwapchainImagesKHR(*device, *swapchain, &swapchain_image_count, swapchain_images);
-    return swapchain_images;
+    // handles that already wrap an image of the old swapchain are rebound in place, so they stay valid across a rebuild
+    for (uint32_t i = 0; i < image_count; ++i)
+    {
+        if (i < swapchain->image_count) { image_rebind(device, &swapchain->swapchain_images[i], &create_info, images[i]); }
+        else { swapchain->swapchain_images[i] = celvk_image_create_w_handle(device, &vk_ctx.allocator, &create_info, images[i]); }
+    }
+    for (uint32_t i = image_count; i < swapchain->image_count; ++i)
+    {
+        celvk_image_destroy(device, &vk_ctx.allocator, &swapchain->swapchain_images[i]);
+    }
+    swapchain->image_count = image_count;
 }
 
-CELimage_handle swapchain_acquire_next_image(VkDevice *device, uint32_t current_frame_index, uint32_t *image_index) {
+bool swapchain_acquire_next_image(VkDevice *device, uint32_t current_frame_index, uint32_t *image_index) {
     CELvk_frame_data *frame = &vk_ctx.frames[current_frame_index];
     VkResult result         = vkAcquireNextImageKHR(*device, vk_ctx.swapchain.handle, UINT64_MAX, frame->swapchain_semaphore, NULL, image_index);
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+
+    // suboptimal still acquired the image and signals the semaphore, so the frame goes on and the rebuild waits
+    if (result == VK_SUBOPTIMAL_KHR) { vk_ctx.swapchain.dirty = true; }
+    else if (result == VK_ERROR_OUT_OF_DATE_KHR)
     {
         vk_ctx.swapchain.dirty = true;
+        *image_index           = CELVK_INVALID_INDEX;
+        return false;
     }
     else if (result != VK_SUCCESS)
     {
         CEL_ERROR("vulkan error: failed to acquire next swapchain image");
         abort();
     }
-    return vk_ctx.swapchain.swapchain_images[*image_index];
+    return true;
 }
 
 void submit_and_present(VkCommandBuffer cmd, uint32_t current_frame_index, uint32_t image_index) {
-    const CELvk_frame_data *frame = &vk_ctx.frames[current_frame_index];
+    CELvk_frame_data *frame = &vk_ctx.frames[current_frame_index];
+    frame->timeline_value   = vk_ctx.frame_count + 1;
+
+    // the ring may be host visible without being coherent, so everything written into it this frame is flushed in one go
+    if (frame->ring_head > 0)
+    {
+        VK_CHECK(vmaFlushAllocation(vk_ctx.allocator, vk_buffer_get(&vk_ctx.frame_ring.buffer)->allocation, frame->ring_offset, frame->ring_head));
+    }
 
     VkCommandBufferSubmitInfo buffer_submit_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
     buffer_submit_info.commandBuffer             = cmd;
 
-    VkSemaphoreSubmitInfo wait_info = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
-    wait_info.semaphore             = frame->swapchain_semaphore;
-    wait_info.stageMask             = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+    // headless frames, and frames that could not acquire, have no image to wait for or present.
+    // they still signal the timeline so the slot retires like any other
+    bool present                        = image_index != CELVK_INVALID_INDEX;
+    VkSemaphoreSubmitInfo wait_infos[2] = {{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO}, {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO}};
+    uint32_t wait_info_count            = 0;
+    if (present)
+    {
+        wait_infos[wait_info_count].semaphore = frame->swapchain_semaphore;
+        wait_infos[wait_info_count].stageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        wait_info_count++;
+    }
 
-    VkSemaphoreSubmitInfo signal_info = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
-    signal_info.semaphore             = frame->render_semaphore;
-    signal_info.stageMask             = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+    if (frame->upload_wait_value > 0)
+    {
+        wait_infos[wait_info_count].semaphore = vk_ctx.upload.timeline;
+        wait_infos[wait_info_count].value     = frame->upload_wait_value;
+        wait_infos[wait_info_count].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        wait_info_count++;
+    }
+
+    VkSemaphoreSubmitInfo signal_infos[2] = {{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO}, {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO}};
+    uint32_t signal_info_count            = 0;
+
+    signal_infos[signal_info_count].semaphore = vk_ctx.frame_timeline;
+    signal_infos[signal_info_count].value     = frame->timeline_value;
+    signal_infos[signal_info_count].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    signal_info_count++;
+
+    if (present)
+    {
+        signal_infos[signal_info_count].semaphore = frame->render_semaphore;
+        signal_infos[signal_info_count].stageMask = VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT;
+        signal_info_count++;
+    }
 
     VkSubmitInfo2 submit_info_2            = {VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
-    submit_info_2.waitSemaphoreInfoCount   = 1;
-    submit_info_2.pWaitSemaphoreInfos      = &wait_info;
+    submit_info_2.waitSemaphoreInfoCount   = wait_info_count;
+    submit_info_2.pWaitSemaphoreInfos      = wait_infos;
     submit_info_2.commandBufferInfoCount   = 1;
     submit_info_2.pCommandBufferInfos      = &buffer_submit_info;
-    submit_info_2.signalSemaphoreInfoCount = 1;
-    submit_info_2.pSignalSemaphoreInfos    = &signal_info;
+    submit_info_2.signalSemaphoreInfoCount = signal_info_count;
+    submit_info_2.pSignalSemaphoreInfos    = signal_infos;
 
-    VK_CHECK(vkQueueSubmit2(vk_ctx.device.graphics_queue, 1, &submit_info_2, frame->render_fence));
+    CEL_PROFILE_BEGIN("submit");
+    VK_CHECK(vkQueueSubmit2(vk_ctx.device.graphics_queue, 1, &submit_info_2, VK_NULL_HANDLE));
+    CEL_PROFILE_END();
+
+    if (!present) { return; }
 
     VkPresentInfoKHR present_info   = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
     present_info.waitSemaphoreCount = 1;
@@ -928,19 +1782,93 @@ void submit_and_present(VkCommandBuffer cmd, uint32_t current_frame_index, uint3
     present_info.pSwapchains        = &vk_ctx.swapchain.handle;
     present_info.pImageIndices      = &image_index;
 
+    CEL_PROFILE_BEGIN("present");
     VkResult result = vkQueuePresentKHR(vk_ctx.device.present_queue, &present_info);
-    if (result != VK_SUCCESS)
+    CEL_PROFILE_END();
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) { vk_ctx.swapchain.dirty = true; }
+    else if (result != VK_SUCCESS)
     {
-        CEL_ERROR("vulkan error: fail to present image");
+        CEL_ERROR("vulkan error: fail to present image, %s", vk_result_string(result));
         vk_ctx.swapchain.dirty = true;
     }
 }
 
-CELvk_frame_data *perframes_create(VkDevice *device, uint32_t family_queue_index) {
-    CELvk_frame_data *frames = cel_arena_alloc(&vk_arena, sizeof(CELvk_frame_data) * CELVK_MAX_FRAME_OVERLAP);
+CELvk_frame_data *current_frame_get() {
+    return &vk_ctx.frames[vk_ctx.frame_count % vk_ctx.frames_in_flight];
+}
 
-    VkFenceCreateInfo fence_create_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
-    fence_create_info.flags             = VK_FENCE_CREATE_SIGNALED_BIT;
+uint64_t frame_timeline_value_get() {
+    uint64_t value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(vk_ctx.device.handle, vk_ctx.frame_timeline, &value));
+    return value;
+}
+
+uint64_t frame_wait_value_get() {
+    // the slot's previous frame has to retire before it is reused, and with a shorter lead
+    // so does the frame that many submissions back. frame n signals n + 1
+    uint64_t wait_value = current_frame_get()->timeline_value;
+    if (vk_ctx.frame_count >= vk_ctx.frame_lead)
+    {
+        uint64_t lead_value = vk_ctx.frame_count - vk_ctx.frame_lead + 1;
+        if (lead_value > wait_value) { wait_value = lead_value; }
+    }
+    return wait_value;
+}
+
+uint32_t gpu_pass_begin(VkCommandBuffer cmd, CELvk_gpu_pass pass) {
+    CELvk_frame_data *frame = current_frame_get();
+
+    // the query pool belongs to the frame, passes recorded into any other command buffer go untimed
+    if (!frame->timestamp_pool || cmd != frame->primary_command_buffer) { return CELVK_INVALID_INDEX; }
+    if (frame->timestamp_count + 2 > CELVK_MAX_GPU_TIMESTAMP_COUNT)
+    {
+        CEL_WARN_ONCE("vulkan warning: more than %u gpu passes in a frame, the rest go untimed", CELVK_MAX_GPU_TIMESTAMP_COUNT / 2);
+        return CELVK_INVALID_INDEX;
+    }
+
+    uint32_t query                     = frame->timestamp_count;
+    frame->timestamp_passes[query / 2] = pass;
+    frame->timestamp_count             = query + 2;
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frame->timestamp_pool, query);
+    return query;
+}
+
+void gpu_pass_end(VkCommandBuffer cmd, uint32_t query) {
+    if (query == CELVK_INVALID_INDEX) { return; }
+    vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, current_frame_get()->timestamp_pool, query + 1);
+}
+
+void gpu_timestamps_collect(CELvk_frame_data *frame) {
+    uint32_t query_count   = frame->timestamp_count;
+    frame->timestamp_count = 0;
+    if (!frame->timestamp_pool || query_count == 0) { return; }
+
+    // no wait bit: the slot has retired so the results should be there, and if not the frame is skipped rather than stalled on
+    uint64_t timestamps[CELVK_MAX_GPU_TIMESTAMP_COUNT];
+    VkResult result = vkGetQueryPoolResults(vk_ctx.device.handle, frame->timestamp_pool, 0, query_count, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) { return; }
+
+    double ms_per_tick         = (double) vk_ctx.timestamp_period / 1e6;
+    CELvk_gpu_timings *timings = &vk_ctx.gpu_timings;
+    *timings                   = (CELvk_gpu_timings){0};
+    timings->frame_index       = frame->timestamp_frame_index;
+
+    // passes can nest (a clear inside the blit), so the frame spans to whichever end came last
+    uint64_t frame_ticks = 0;
+    for (uint32_t i = 0; i < query_count; i += 2)
+    {
+        uint64_t ticks = (timestamps[i + 1] - timestamps[i]) & vk_ctx.timestamp_mask;
+        uint64_t span  = (timestamps[i + 1] - timestamps[0]) & vk_ctx.timestamp_mask;
+        if (span > frame_ticks) { frame_ticks = span; }
+
+        timings->pass_ms[frame->timestamp_passes[i / 2]] += (double) ticks * ms_per_tick;
+    }
+    timings->frame_ms        = (double) frame_ticks * ms_per_tick;
+    vk_ctx.gpu_timings_valid = true;
+}
+
+CELvk_frame_data *perframes_create(VkDevice *device, uint32_t family_queue_index) {
+    CELvk_frame_data *frames = cel_arena_alloc(&vk_arena, sizeof(CELvk_frame_data) * vk_ctx.frames_in_flight);
 
     VkSemaphoreCreateInfo semaphore_create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
 
@@ -948,9 +1876,20 @@ CELvk_frame_data *perframes_create(VkDevice *device, uint32_t family_queue_index
     pool_create_info.flags                   = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
     pool_create_info.queueFamilyIndex        = family_queue_index;
 
-    for (uint32_t i = 0; i < CELVK_MAX_FRAME_OVERLAP; ++i)
+    for (uint32_t i = 0; i < vk_ctx.frames_in_flight; ++i)
     {
-        VK_CHECK(vkCreateFence(*device, &fence_create_info, NULL, &frames[i].render_fence));
+        frames[i].timeline_value    = 0;
+        frames[i].upload_wait_value = 0;
+        frames[i].timestamp_pool    = VK_NULL_HANDLE;
+        frames[i].timestamp_count   = 0;
+
+        if (vk_ctx.timestamp_mask)
+        {
+            VkQueryPoolCreateInfo query_pool_create_info = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+            query_pool_create_info.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+            query_pool_create_info.queryCount            = CELVK_MAX_GPU_TIMESTAMP_COUNT;
+            VK_CHECK(vkCreateQueryPool(*device, &query_pool_create_info, NULL, &frames[i].timestamp_pool));
+        }
 
         VK_CHECK(vkCreateSemaphore(*device, &semaphore_create_info, NULL, &frames[i].render_semaphore));
         VK_CHECK(vkCreateSemaphore(*device, &semaphore_create_info, NULL, &frames[i].swapchain_semaphore));
@@ -964,27 +1903,115 @@ CELvk_frame_data *perframes_create(VkDevice *device, uint32_t family_queue_index
         buffer_allocate_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 
         VK_CHECK(vkAllocateCommandBuffers(*device, &buffer_allocate_info, &frames[i].primary_command_buffer));
+
+        frames[i].ring_offset = vk_ctx.frame_ring.region_size * i;
+        frames[i].ring_head   = 0;
+
+        // one pool per record worker and frame, reset wholesale once the frame retires
+        VkCommandPoolCreateInfo worker_pool_create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        worker_pool_create_info.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        worker_pool_create_info.queueFamilyIndex        = family_queue_index;
+
+        frames[i].workers = cel_arena_alloc(&vk_arena, sizeof(CELvk_worker_commands) * CELVK_MAX_RECORD_WORKER_COUNT);
+        for (uint32_t j = 0; j < CELVK_MAX_RECORD_WORKER_COUNT; ++j)
+        {
+            frames[i].workers[j] = (CELvk_worker_commands){0};
+            VK_CHECK(vkCreateCommandPool(*device, &worker_pool_create_info, NULL, &frames[i].workers[j].command_pool));
+        }
     }
 
     return frames;
 }
 
 void perframes_destroy(VkDevice *device, CELvk_frame_data *frames) {
-    for (uint32_t i = 0; i < CELVK_MAX_FRAME_OVERLAP; ++i)
+    for (uint32_t i = 0; i < vk_ctx.frames_in_flight; ++i)
     {
-        ASSERT_VK_HANDLE(frames[i].render_fence);
-        vkDestroyFence(*device, frames[i].render_fence, NULL);
-
         ASSERT_VK_HANDLE(frames[i].render_semaphore);
         ASSERT_VK_HANDLE(frames[i].swapchain_semaphore);
         vkDestroySemaphore(*device, frames[i].render_semaphore, NULL);
         vkDestroySemaphore(*device, frames[i].swapchain_semaphore, NULL);
 
+        if (frames[i].timestamp_pool) { vkDestroyQueryPool(*device, frames[i].timestamp_pool, NULL); }
+
         ASSERT_VK_HANDLE(frames[i].primary_command_buffer);
         ASSERT_VK_HANDLE(frames[i].primary_command_pool);
         vkFreeCommandBuffers(*device, frames[i].primary_command_pool, 1, &frames[i].primary_command_buffer);
         vkDestroyCommandPool(*device, frames[i].primary_command_pool, NULL);
+
+        // destroying the pool frees the secondaries allocated from it
+        for (uint32_t j = 0; j < CELVK_MAX_RECORD_WORKER_COUNT; ++j)
+        {
+            ASSERT_VK_HANDLE(frames[i].workers[j].command_pool);
+            vkDestroyCommandPool(*device, frames[i].workers[j].command_pool, NULL);
+            free(frames[i].workers[j].secondaries);
+        }
+    }
+}
+
+CELvk_frame_ring frame_ring_create(VmaAllocator *allocator, VkDeviceSize region_size) {
+    CELvk_frame_ring ring = {0};
+    ring.region_size      = region_size;
+
+    // one persistently mapped allocation split into a region per frame in flight,
+    // suballocated with a bump pointer that rewinds once the frame retires
+    VkBufferUsageFlags usages = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+    ring.buffer               = celvk_staging_buffer_create(allocator, region_size * vk_ctx.frames_in_flight, usages);
+
+    CELvk_buffer *buffer = vk_buffer_get(&ring.buffer);
+    ring.mapped          = buffer->allocation_info.pMappedData;
+    ring.device_address  = buffer->device_address;
+    assert(ring.mapped && "vulkan error: frame ring is not host mapped");
+
+    return ring;
+}
+
+void deletion_push(CELvk_deletion deletion) {
+    // nothing can be in flight before the frames exist
+    if (!vk_ctx.frames)
+    {
+        deletion_destroy(&vk_ctx.device.handle, &vk_ctx.allocator, &deletion);
+        return;
+    }
+
+    if (vk_ctx.deletion_count >= CELVK_MAX_DELETION_COUNT)
+    {
+        CEL_WARN("vulkan warning: deletion queue full, waiting for the device to go idle");
+        VK_CHECK(vkDeviceWaitIdle(vk_ctx.device.handle));
+        deletion_queue_flush(&vk_ctx.device.handle, &vk_ctx.allocator, UINT64_MAX);
+    }
+
+    // any frame submitted so far may still use it, and the last of them signals frame_count.
+    // the frame being recorded cannot, destroying what it recorded would invalidate its command buffer
+    deletion.retire_value                     = vk_ctx.frame_count;
+    vk_ctx.deletions[vk_ctx.deletion_count++] = deletion;
+}
+
+void deletion_destroy(VkDevice *device, VmaAllocator *allocator, const CELvk_deletion *deletion) {
+    switch (deletion->type)
+    {
+        case VK_OBJECT_TYPE_BUFFER: vmaDestroyBuffer(*allocator, deletion->handle.buffer, deletion->allocation); break;
+        case VK_OBJECT_TYPE_IMAGE: vmaDestroyImage(*allocator, deletion->handle.image, deletion->allocation); break;
+        case VK_OBJECT_TYPE_IMAGE_VIEW: vkDestroyImageView(*device, deletion->handle.image_view, NULL); break;
+        case VK_OBJECT_TYPE_SAMPLER: vkDestroySampler(*device, deletion->handle.sampler, NULL); break;
+        case VK_OBJECT_TYPE_PIPELINE: vkDestroyPipeline(*device, deletion->handle.pipeline, NULL); break;
+        case VK_OBJECT_TYPE_PIPELINE_LAYOUT: vkDestroyPipelineLayout(*device, deletion->handle.pipeline_layout, NULL); break;
+        case VK_OBJECT_TYPE_SWAPCHAIN_KHR: vkDestroySwapchainKHR(*device, deletion->handle.swapchain, NULL); break;
+        default: CEL_ERROR("vulkan error: unsupported deferred deletion object type %d", deletion->type); break;
+    }
+}
+
+void deletion_queue_flush(VkDevice *device, VmaAllocator *allocator, uint64_t completed_value) {
+    // retire values never decrease along the queue, so what the gpu is done with is its front
+    uint32_t retired_count = 0;
+    while (retired_count < vk_ctx.deletion_count && vk_ctx.deletions[retired_count].retire_value <= completed_value) { ++retired_count; }
+
+    // destroy in reverse push order so views go before the images they reference
+    for (uint32_t i = retired_count; i > 0; --i)
+    {
+        deletion_destroy(device, allocator, &vk_ctx.deletions[i - 1]);
     }
+    vk_ctx.deletion_count -= retired_count;
+    memmove(vk_ctx.deletions, vk_ctx.deletions + retired_count, sizeof(CELvk_deletion) * vk_ctx.deletion_count);
 }
 
 Internal CELvk_immediate_command immediate_command_create(VkDevice *device, uint32_t queue_family_index) {
@@ -1018,6 +2045,393 @@ Internal void immediate_command_destroy(VkDevice *device, CELvk_immediate_comman
     vkDestroyCommandPool(*device, im_cmd->command_pool, NULL);
 }
 
+VkSemaphore timeline_semaphore_create(VkDevice *device, uint64_t initial_value) {
+    VkSemaphoreTypeCreateInfo type_create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    type_create_info.semaphoreType             = VK_SEMAPHORE_TYPE_TIMELINE;
+    type_create_info.initialValue              = initial_value;
+
+    VkSemaphoreCreateInfo semaphore_create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semaphore_create_info.pNext                 = &type_create_info;
+
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateSemaphore(*device, &semaphore_create_info, NULL, &semaphore));
+    return semaphore;
+}
+
+void upload_create(VkDevice *device, VmaAllocator *allocator, uint32_t queue_family_index, CELvk_upload_ctx *upload) {
+    VkCommandPoolCreateInfo pool_create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    pool_create_info.flags                   = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    pool_create_info.queueFamilyIndex        = queue_family_index;
+    VK_CHECK(vkCreateCommandPool(*device, &pool_create_info, NULL, &upload->command_pool));
+
+    for (uint32_t i = 0; i < CELVK_MAX_UPLOAD_BATCH_COUNT; ++i)
+    {
+        VkCommandBufferAllocateInfo buffer_allocate_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        buffer_allocate_info.commandPool                 = upload->command_pool;
+        buffer_allocate_info.commandBufferCount          = 1;
+        buffer_allocate_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        VK_CHECK(vkAllocateCommandBuffers(*device, &buffer_allocate_info, &upload->batches[i].command_buffer));
+
+        upload->batches[i].timeline_value = 0;
+        upload->batches[i].ring_end       = 0;
+    }
+
+    upload->timeline        = timeline_semaphore_create(device, 0);
+    upload->batch_index     = 0;
+    upload->submitted_value = 0;
+    upload->recording       = false;
+
+    upload->staging   = celvk_staging_buffer_create(allocator, CELVK_UPLOAD_RING_SIZE, 0);
+    upload->mapped    = vk_buffer_get(&upload->staging)->allocation_info.pMappedData;
+    upload->ring_size = CELVK_UPLOAD_RING_SIZE;
+    upload->ring_head = 0;
+    upload->ring_tail = 0;
+    assert(upload->mapped && "vulkan error: upload staging ring is not host mapped");
+
+    upload->acquire_count = 0;
+
+    CEL_INFO("vulkan uploads on queue family %u (graphics family %u)", queue_family_index, vk_ctx.device.graphics_queue_family_index);
+}
+
+void upload_destroy(VkDevice *device, CELvk_upload_ctx *upload) {
+    // the staging buffer is released with the rest of the live buffers
+    ASSERT_VK_HANDLE(upload->timeline);
+    vkDestroySemaphore(*device, upload->timeline, NULL);
+
+    ASSERT_VK_HANDLE(upload->command_pool);
+    for (uint32_t i = 0; i < CELVK_MAX_UPLOAD_BATCH_COUNT; ++i)
+    {
+        vkFreeCommandBuffers(*device, upload->command_pool, 1, &upload->batches[i].command_buffer);
+    }
+    vkDestroyCommandPool(*device, upload->command_pool, NULL);
+}
+
+bool upload_stage(const void *data, VkDeviceSize size, VkDeviceSize *staging_offset, VkCommandBuffer *cmd) {
+    CELvk_upload_ctx *upload = &vk_ctx.upload;
+
+    if (size > upload->ring_size)
+    {
+        CEL_ERROR("vulkan error: upload of %llu bytes exceeds the staging ring", (unsigned long long) size);
+        return false;
+    }
+
+    if (upload->acquire_count >= CELVK_MAX_UPLOAD_ACQUIRE_COUNT) { return false; }
+
+    // batches complete in submission order, so the newest completed one bounds the reclaimable staging space
+    uint64_t completed_value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(vk_ctx.device.handle, upload->timeline, &completed_value));
+    for (uint32_t i = 0; i < CELVK_MAX_UPLOAD_BATCH_COUNT; ++i)
+    {
+        const CELvk_upload_batch *batch = &upload->batches[i];
+        if (batch->timeline_value != 0 && batch->timeline_value <= completed_value && batch->ring_end > upload->ring_tail)
+        {
+            upload->ring_tail = batch->ring_end;
+        }
+    }
+
+    // an allocation never straddles the end of the ring, the skipped tail is reclaimed with the batch
+    uint64_t head    = (upload->ring_head + CELVK_UPLOAD_ALIGNMENT - 1) & ~(uint64_t) (CELVK_UPLOAD_ALIGNMENT - 1);
+    uint64_t wrapped = head % upload->ring_size;
+    if (wrapped + size > upload->ring_size) { head += upload->ring_size - wrapped; }
+    if (head + size - upload->ring_tail > upload->ring_size) { return false; }
+
+    if (!upload->recording)
+    {
+        CELvk_upload_batch *batch = &upload->batches[upload->batch_index];
+
+        // only stalls when every batch is still in flight on the transfer queue
+        if (batch->timeline_value > completed_value)
+        {
+            VkSemaphoreWaitInfo wait_info = {VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+            wait_info.semaphoreCount      = 1;
+            wait_info.pSemaphores         = &upload->timeline;
+            wait_info.pValues             = &batch->timeline_value;
+            VK_CHECK(vkWaitSemaphores(vk_ctx.device.handle, &wait_info, UINT64_MAX));
+        }
+
+        VK_CHECK(vkResetCommandBuffer(batch->command_buffer, 0));
+
+        VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(batch->command_buffer, &begin_info));
+
+        batch->timeline_value = upload->submitted_value + 1;
+        upload->recording     = true;
+    }
+
+    memcpy(upload->mapped + (head % upload->ring_size), data, size);
+    VK_CHECK(vmaFlushAllocation(vk_ctx.allocator, vk_buffer_get(&upload->staging)->allocation, head % upload->ring_size, size));
+    upload->ring_head = head + size;
+
+    *staging_offset = head % upload->ring_size;
+    *cmd            = upload->batches[upload->batch_index].command_buffer;
+    return true;
+}
+
+void upload_release(VkCommandBuffer cmd, const CELvk_upload_acquire *acquire) {
+    // with a shared family there is no ownership to move, the release just makes the copy visible to shaders
+    bool shared_family = vk_ctx.device.transfer_queue_family_index == vk_ctx.device.graphics_queue_family_index;
+
+    VkBufferMemoryBarrier2 buffer_barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    VkImageMemoryBarrier2 image_barrier   = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    VkDependencyInfo dependency_info      = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+
+    if (acquire->type == VK_OBJECT_TYPE_BUFFER)
+    {
+        buffer_barrier.srcStageMask        = VK_PIPELINE_STAGE_2_COPY_BIT;
+        buffer_barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        buffer_barrier.dstStageMask        = shared_family ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_2_NONE;
+        buffer_barrier.dstAccessMask       = shared_family ? VK_ACCESS_2_MEMORY_READ_BIT : VK_ACCESS_2_NONE;
+        buffer_barrier.srcQueueFamilyIndex = shared_family ? VK_QUEUE_FAMILY_IGNORED : vk_ctx.device.transfer_queue_family_index;
+        buffer_barrier.dstQueueFamilyIndex = shared_family ? VK_QUEUE_FAMILY_IGNORED : vk_ctx.device.graphics_queue_family_index;
+        buffer_barrier.buffer              = acquire->handle.buffer;
+        buffer_barrier.offset              = 0;
+        buffer_barrier.size                = VK_WHOLE_SIZE;
+
+        dependency_info.bufferMemoryBarrierCount = 1;
+        dependency_info.pBufferMemoryBarriers    = &buffer_barrier;
+    }
+    else
+    {
+        image_barrier.srcStageMask        = VK_PIPELINE_STAGE_2_COPY_BIT;
+        image_barrier.srcAccessMask       = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        image_barrier.dstStageMask        = shared_family ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_2_NONE;
+        image_barrier.dstAccessMask       = shared_family ? VK_ACCESS_2_MEMORY_READ_BIT : VK_ACCESS_2_NONE;
+        image_barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_barrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_barrier.srcQueueFamilyIndex = shared_family ? VK_QUEUE_FAMILY_IGNORED : vk_ctx.device.transfer_queue_family_index;
+        image_barrier.dstQueueFamilyIndex = shared_family ? VK_QUEUE_FAMILY_IGNORED : vk_ctx.device.graphics_queue_family_index;
+        image_barrier.image               = acquire->handle.image;
+        image_barrier.subresourceRange    = (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        dependency_info.imageMemoryBarrierCount = 1;
+        dependency_info.pImageMemoryBarriers    = &image_barrier;
+    }
+
+    vkCmdPipelineBarrier2(cmd, &dependency_info);
+}
+
+void upload_acquire(VkCommandBuffer cmd, const CELvk_upload_acquire *acquire) {
+    // must mirror the release recorded on the transfer queue, src access is covered by the timeline wait
+    VkBufferMemoryBarrier2 buffer_barrier = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    VkImageMemoryBarrier2 image_barrier   = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    VkDependencyInfo dependency_info      = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+
+    if (acquire->type == VK_OBJECT_TYPE_BUFFER)
+    {
+        buffer_barrier.srcStageMask        = VK_PIPELINE_STAGE_2_NONE;
+        buffer_barrier.srcAccessMask       = VK_ACCESS_2_NONE;
+        buffer_barrier.dstStageMask        = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        buffer_barrier.dstAccessMask       = VK_ACCESS_2_MEMORY_READ_BIT;
+        buffer_barrier.srcQueueFamilyIndex = vk_ctx.device.transfer_queue_family_index;
+        buffer_barrier.dstQueueFamilyIndex = vk_ctx.device.graphics_queue_family_index;
+        buffer_barrier.buffer              = acquire->handle.buffer;
+        buffer_barrier.offset              = 0;
+        buffer_barrier.size                = VK_WHOLE_SIZE;
+
+        dependency_info.bufferMemoryBarrierCount = 1;
+        dependency_info.pBufferMemoryBarriers    = &buffer_barrier;
+    }
+    else
+    {
+        image_barrier.srcStageMask        = VK_PIPELINE_STAGE_2_NONE;
+        image_barrier.srcAccessMask       = VK_ACCESS_2_NONE;
+        image_barrier.dstStageMask        = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        image_barrier.dstAccessMask       = VK_ACCESS_2_MEMORY_READ_BIT;
+        image_barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        image_barrier.newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_barrier.srcQueueFamilyIndex = vk_ctx.device.transfer_queue_family_index;
+        image_barrier.dstQueueFamilyIndex = vk_ctx.device.graphics_queue_family_index;
+        image_barrier.image               = acquire->handle.image;
+        image_barrier.subresourceRange    = (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        dependency_info.imageMemoryBarrierCount = 1;
+        dependency_info.pImageMemoryBarriers    = &image_barrier;
+    }
+
+    vkCmdPipelineBarrier2(cmd, &dependency_info);
+}
+
+uint64_t celvk_upload_buffer(const CELbuffer_handle *handle, VkDeviceSize offset, const void *data, VkDeviceSize size) {
+    CELvk_buffer *buffer = vk_buffer_get(handle);
+
+    // a buffer graphics owns keeps its contents only through a release recorded on graphics, which uploads never do.
+    // overwriting all of it needs no transfer, the old contents are discarded anyway
+    if (buffer->graphics_owned && (offset != 0 || size < buffer->size))
+    {
+        CEL_ERROR("vulkan error: partial upload into buffer %u, which graphics already owns", handle->idx);
+        return 0;
+    }
+
+    VkDeviceSize staging_offset;
+    VkCommandBuffer cmd;
+    if (!upload_stage(data, size, &staging_offset, &cmd)) { return 0; }
+
+    VkBufferCopy region = {.srcOffset = staging_offset, .dstOffset = offset, .size = size};
+    vkCmdCopyBuffer(cmd, vk_buffer_get(&vk_ctx.upload.staging)->handle, buffer->handle, 1, &region);
+
+    CELvk_upload_acquire acquire = {.type = VK_OBJECT_TYPE_BUFFER, .handle.buffer = buffer->handle};
+    upload_release(cmd, &acquire);
+    if (vk_ctx.device.transfer_queue_family_index != vk_ctx.device.graphics_queue_family_index)
+    {
+        vk_ctx.upload.acquires[vk_ctx.upload.acquire_count++] = acquire;
+        buffer->graphics_owned                                = true;
+    }
+
+    return vk_ctx.upload.batches[vk_ctx.upload.batch_index].timeline_value;
+}
+
+uint64_t celvk_upload_image(const CELimage_handle *handle, const void *data, VkDeviceSize size) {
+    CELvk_image *image = vk_image_get(handle);
+
+    VkDeviceSize staging_offset;
+    VkCommandBuffer cmd;
+    if (!upload_stage(data, size, &staging_offset, &cmd)) { return 0; }
+
+    VkImageMemoryBarrier2 barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask          = VK_PIPELINE_STAGE_2_NONE;
+    barrier.srcAccessMask         = VK_ACCESS_2_NONE;
+    barrier.dstStageMask          = VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.dstAccessMask         = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    barrier.oldLayout             = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout             = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex   = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                 = image->handle;
+    barrier.subresourceRange      = (VkImageSubresourceRange){VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+    VkDependencyInfo dependency_info        = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dependency_info.imageMemoryBarrierCount = 1;
+    dependency_info.pImageMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(cmd, &dependency_info);
+
+    VkBufferImageCopy region = {
+        .bufferOffset     = staging_offset,
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageExtent      = image->extent,
+    };
+    vkCmdCopyBufferToImage(cmd, vk_buffer_get(&vk_ctx.upload.staging)->handle, image->handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    CELvk_upload_acquire acquire = {.type = VK_OBJECT_TYPE_IMAGE, .handle.image = image->handle};
+    upload_release(cmd, &acquire);
+    if (vk_ctx.device.transfer_queue_family_index != vk_ctx.device.graphics_queue_family_index)
+    {
+        vk_ctx.upload.acquires[vk_ctx.upload.acquire_count++] = acquire;
+    }
+
+    return vk_ctx.upload.batches[vk_ctx.upload.batch_index].timeline_value;
+}
+
+void celvk_upload_flush() {
+    CELvk_upload_ctx *upload = &vk_ctx.upload;
+    if (!upload->recording) { return; }
+
+    CELvk_upload_batch *batch = &upload->batches[upload->batch_index];
+    VK_CHECK(vkEndCommandBuffer(batch->command_buffer));
+    batch->ring_end = upload->ring_head;
+
+    VkCommandBufferSubmitInfo buffer_submit_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    buffer_submit_info.commandBuffer             = batch->command_buffer;
+
+    VkSemaphoreSubmitInfo signal_info = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    signal_info.semaphore             = upload->timeline;
+    signal_info.value                 = batch->timeline_value;
+    signal_info.stageMask             = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo2 submit_info_2            = {VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submit_info_2.commandBufferInfoCount   = 1;
+    submit_info_2.pCommandBufferInfos      = &buffer_submit_info;
+    submit_info_2.signalSemaphoreInfoCount = 1;
+    submit_info_2.pSignalSemaphoreInfos    = &signal_info;
+
+    VK_CHECK(vkQueueSubmit2(vk_ctx.device.transfer_queue, 1, &submit_info_2, VK_NULL_HANDLE));
+
+    upload->submitted_value = batch->timeline_value;
+    upload->batch_index     = (upload->batch_index + 1) % CELVK_MAX_UPLOAD_BATCH_COUNT;
+    upload->recording       = false;
+}
+
+bool celvk_upload_complete(uint64_t ticket) {
+    if (ticket == 0) { return false; }
+
+    uint64_t completed_value = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(vk_ctx.device.handle, vk_ctx.upload.timeline, &completed_value));
+    return completed_value >= ticket;
+}
+
+VkPipelineCache pipeline_cache_create(VkDevice *device, const char *path) {
+    const void *initial_data = NULL;
+    size_t initial_size      = 0;
+
+    CELfile_view view = {0};
+    if (celfs_view_open(&view, path) && celfs_view_size(&view) >= sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        initial_data = celfs_view_map(&view);
+        initial_size = initial_data ? celfs_view_size(&view) : 0;
+    }
+
+    // a cache from another driver or gpu is at best rejected by the driver, so only hand over one that matches
+    if (initial_size > 0)
+    {
+        const VkPipelineCacheHeaderVersionOne *header = (const VkPipelineCacheHeaderVersionOne *) initial_data;
+        const VkPhysicalDeviceProperties *properties  = &vk_ctx.physical_device.properties;
+
+        bool valid = header->headerSize >= sizeof(VkPipelineCacheHeaderVersionOne) && header->headerSize <= initial_size &&
+                     header->headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+                     header->vendorID == properties->vendorID &&
+                     header->deviceID == properties->deviceID &&
+                     memcmp(header->pipelineCacheUUID, properties->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+        if (!valid)
+        {
+            CEL_WARN("vulkan warning: pipeline cache %s was written by another device or driver, starting cold", path);
+            initial_size = 0;
+        }
+    }
+
+    VkPipelineCacheCreateInfo create_info = {VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO};
+    create_info.initialDataSize           = initial_size;
+    create_info.pInitialData              = initial_size > 0 ? initial_data : NULL;
+
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+    VK_CHECK(vkCreatePipelineCache(*device, &create_info, NULL, &pipeline_cache));
+    celfs_view_unmap(&view);
+
+    CEL_INFO("vulkan pipeline cache %s (%zu bytes)", initial_size > 0 ? "warm" : "cold", initial_size);
+    return pipeline_cache;
+}
+
+void pipeline_cache_save(VkDevice *device, VkPipelineCache pipeline_cache, const char *path) {
+    size_t size = 0;
+    VK_CHECK(vkGetPipelineCacheData(*device, pipeline_cache, &size, NULL));
+    if (size == 0) { return; }
+
+    void *data = malloc(size);
+    if (!data) { return; }
+    VK_CHECK(vkGetPipelineCacheData(*device, pipeline_cache, &size, data));
+
+    // write next to the real file and swap it in, so a crash mid write never leaves a torn cache behind
+    char temp_path[FS_PATH_MAX];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+
+    FILE *file = fopen(temp_path, "wb");
+    if (!file)
+    {
+        CEL_WARN("vulkan warning: failed to write pipeline cache %s", temp_path);
+        free(data);
+        return;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size;
+    written      = fclose(file) == 0 && written;
+    free(data);
+
+    if (!written || !celfs_replace(temp_path, path))
+    {
+        CEL_WARN("vulkan warning: failed to write pipeline cache %s", path);
+        remove(temp_path);
+    }
+}
+
 CELvk_bindless_descriptor bindless_descriptor_create(VkDevice *device) {
     CELvk_bindless_descriptor descriptor = {0};
 
@@ -1037,8 +2451,8 @@ CELvk_bindless_descriptor bindless_descriptor_create(VkDevice *device) {
     VK_CHECK(vkCreateDescriptorPool(*device, &descriptor_pool_create_info, NULL, &descriptor.pool));
 
     VkDescriptorSetLayoutBinding bindings[CELVK_DESCRIPTOR_COUNT] = {
-        {.binding = CELVK_TEXTURE_BINDING, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .stageFlags = VK_SHADER_STAGE_ALL, .descriptorCount = 1},
-        {.binding = CELVK_SAMPLER_BINDING, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .stageFlags = VK_SHADER_STAGE_ALL, .descriptorCount = 1},
+        {.binding = CELVK_TEXTURE_BINDING, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, .stageFlags = VK_SHADER_STAGE_ALL, .descriptorCount = CELVK_MAX_IMAGE_COUNT},
+        {.binding = CELVK_SAMPLER_BINDING, .descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER, .stageFlags = VK_SHADER_STAGE_ALL, .descriptorCount = CELVK_MAX_SAMPLER_COUNT},
     };
 
     VkDescriptorBindingFlags binding_flags[CELVK_DESCRIPTOR_COUNT] = {
@@ -1081,8 +2495,56 @@ void bindless_descriptor_destroy(VkDevice *device, CELvk_bindless_descriptor *de
     vkDestroyDescriptorPool(*device, descriptor->pool, NULL);
 }
 
+void bindless_texture_write(VkDevice *device, uint32_t index, VkImageView image_view) {
+    VkDescriptorImageInfo image_info = {
+        .sampler     = VK_NULL_HANDLE,
+        .imageView   = image_view,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet               = vk_ctx.descriptor.set;
+    write.dstBinding           = CELVK_TEXTURE_BINDING;
+    write.dstArrayElement      = index;
+    write.descriptorCount      = 1;
+    write.descriptorType       = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo           = &image_info;
+
+    vkUpdateDescriptorSets(*device, 1, &write, 0, NULL);
+}
+
+void bindless_sampler_write(VkDevice *device, uint32_t index, VkSampler sampler) {
+    VkDescriptorImageInfo image_info = {.sampler = sampler};
+
+    VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet               = vk_ctx.descriptor.set;
+    write.dstBinding           = CELVK_SAMPLER_BINDING;
+    write.dstArrayElement      = index;
+    write.descriptorCount      = 1;
+    write.descriptorType       = VK_DESCRIPTOR_TYPE_SAMPLER;
+    write.pImageInfo           = &image_info;
+
+    vkUpdateDescriptorSets(*device, 1, &write, 0, NULL);
+}
+
+Internal VkDeviceAddress buffer_device_address_get(VkBuffer buffer, VkBufferUsageFlags usages) {
+    if ((usages & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) == 0) { return 0; }
+
+    VkBufferDeviceAddressInfo address_info = {VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
+    address_info.buffer                    = buffer;
+    return vkGetBufferDeviceAddress(vk_ctx.device.handle, &address_info);
+}
+
 CELbuffer_handle celvk_staging_buffer_create(VmaAllocator *allocator, VkDeviceSize size, VkBufferUsageFlags usages) {
-    CELvk_buffer buffer;
+    CELbuffer_handle handle = {0};
+    if (!handle_pool_alloc(&vk_buffer_pool, &handle.idx, &handle.generation))
+    {
+        assert(false && "vulkan error: exceeded max buffer count");
+        return handle;
+    }
+
+    CELvk_buffer buffer = {0};
+    buffer.size         = size;
 
     VkBufferCreateInfo buffer_create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     buffer_create_info.pNext              = NULL;
@@ -1095,14 +2557,22 @@ CELbuffer_handle celvk_staging_buffer_create(VmaAllocator *allocator, VkDeviceSi
     allocation_create_info.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
 
     vmaCreateBuffer(*allocator, &buffer_create_info, &allocation_create_info, &buffer.handle, &buffer.allocation, &buffer.allocation_info);
+    buffer.device_address = buffer_device_address_get(buffer.handle, usages);
 
-    uint32_t index    = vk_buffer_count++;
-    vk_buffers[index] = buffer;
-    return (CELbuffer_handle){.idx = index};
+    vk_buffers[handle.idx] = buffer;
+    return handle;
 }
 
 CELbuffer_handle celvk_gpu_buffer_create(VmaAllocator *allocator, VkDeviceSize size, VkBufferUsageFlags usages) {
-    CELvk_buffer buffer;
+    CELbuffer_handle handle = {0};
+    if (!handle_pool_alloc(&vk_buffer_pool, &handle.idx, &handle.generation))
+    {
+        assert(false && "vulkan error: exceeded max buffer count");
+        return handle;
+    }
+
+    CELvk_buffer buffer = {0};
+    buffer.size         = size;
 
     VkBufferCreateInfo buffer_create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
     buffer_create_info.pNext              = NULL;
@@ -1114,22 +2584,66 @@ CELbuffer_handle celvk_gpu_buffer_create(VmaAllocator *allocator, VkDeviceSize s
     allocation_create_info.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
 
     vmaCreateBuffer(*allocator, &buffer_create_info, &allocation_create_info, &buffer.handle, &buffer.allocation, &buffer.allocation_info);
-    uint32_t index    = vk_buffer_count++;
-    vk_buffers[index] = buffer;
-    return (CELbuffer_handle){.idx = index};
+    buffer.device_address = buffer_device_address_get(buffer.handle, usages);
+
+    vk_buffers[handle.idx] = buffer;
+    return handle;
 }
 
 void celvk_buffer_destroy(VmaAllocator *allocator, const CELbuffer_handle *handle) {
+    if (!handle_pool_valid(&vk_buffer_pool, handle->idx, handle->generation))
+    {
+        CEL_WARN("vulkan warning: destroying stale or invalid buffer handle %u", handle->idx);
+        return;
+    }
+
     CELvk_buffer *buffer = &vk_buffers[handle->idx];
-    vmaDestroyBuffer(*allocator, buffer->handle, buffer->allocation);
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_BUFFER, .handle.buffer = buffer->handle, .allocation = buffer->allocation});
     *buffer = (CELvk_buffer){0};
+
+    handle_pool_free(&vk_buffer_pool, handle->idx, handle->generation);
+}
+
+bool celvk_buffer_valid(const CELbuffer_handle *handle) {
+    return handle_pool_valid(&vk_buffer_pool, handle->idx, handle->generation);
+}
+
+VkDeviceAddress celvk_buffer_device_address(const CELbuffer_handle *handle) {
+    return vk_buffer_get(handle)->device_address;
+}
+
+CELvk_buffer *vk_buffer_get(const CELbuffer_handle *handle) {
+    assert(handle_pool_valid(&vk_buffer_pool, handle->idx, handle->generation) && "vulkan error: stale or invalid buffer handle");
+    return &vk_buffers[handle->idx];
+}
+
+CELvk_image *vk_image_get(const CELimage_handle *handle) {
+    assert(handle_pool_valid(&vk_image_pool, handle->idx, handle->generation) && "vulkan error: stale or invalid image handle");
+    return &vk_images[handle->idx];
+}
+
+CELvk_sampler *vk_sampler_get(const CELsampler_handle *handle) {
+    assert(handle_pool_valid(&vk_sampler_pool, handle->idx, handle->generation) && "vulkan error: stale or invalid sampler handle");
+    return &vk_samplers[handle->idx];
+}
+
+CELvk_program *vk_program_get(const CELprogram_handle *handle) {
+    assert(handle_pool_valid(&vk_program_pool, handle->idx, handle->generation) && "vulkan error: stale or invalid program handle");
+    return &vk_programs[handle->idx];
 }
 
 CELimage_handle celvk_image_create(const CELvk_image_create_info *create_info, const VmaAllocationCreateInfo *allocation_info) {
-    assert(vk_image_count < CELVK_MAX_IMAGE_COUNT && "vulkan error: exceeded max image count");
+    CELimage_handle handle = {0};
+    if (!handle_pool_alloc(&vk_image_pool, &handle.idx, &handle.generation))
+    {
+        assert(false && "vulkan error: exceeded max image count");
+        return handle;
+    }
 
     CELvk_image image = {};
     image.own_image   = true;
+    image.format      = create_info->format;
+    image.extent      = create_info->extent;
 
     VkImageCreateInfo image_create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
     image_create_info.pNext             = NULL;
@@ -1165,15 +2679,39 @@ CELimage_handle celvk_image_create(const CELvk_image_create_info *create_info, c
 
     VK_CHECK(vkCreateImageView(vk_ctx.device.handle, &image_view_create_info, NULL, &image.image_view));
 
-    uint32_t index   = vk_image_count++;
-    vk_images[index] = image;
-    return (CELimage_handle){.idx = index};
+    vk_images[handle.idx] = image;
+
+    // sampled images are visible to every shader at their slot index in the bindless texture array
+    if (create_info->usages & VK_IMAGE_USAGE_SAMPLED_BIT) { bindless_texture_write(&vk_ctx.device.handle, handle.idx, image.image_view); }
+
+    return handle;
 }
 
-CELimage_handle celvk_image_create_w_handle(VkDevice *device, VmaAllocator *allocator, const CELvk_image_create_info *create_info, VkImage handle) {
-    assert(vk_image_count < CELVK_MAX_IMAGE_COUNT && "vulkan error: exceeded max image count");
+CELimage_handle celvk_image_create_w_handle(VkDevice *device, VmaAllocator *allocator, const CELvk_image_create_info *create_info, VkImage vk_image) {
+    CELimage_handle handle = {0};
+    if (!handle_pool_alloc(&vk_image_pool, &handle.idx, &handle.generation))
+    {
+        assert(false && "vulkan error: exceeded max image count");
+        return handle;
+    }
+
+    image_wrap(device, &handle, create_info, vk_image);
+    return handle;
+}
+
+void image_rebind(VkDevice *device, const CELimage_handle *handle, const CELvk_image_create_info *create_info, VkImage vk_image) {
+    assert(handle_pool_valid(&vk_image_pool, handle->idx, handle->generation) && !vk_images[handle->idx].own_image && "vulkan error: only live wrapped images can be rebound");
+
+    // the old view may still be referenced by frames in flight
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_IMAGE_VIEW, .handle.image_view = vk_images[handle->idx].image_view});
+    image_wrap(device, handle, create_info, vk_image);
+}
+
+void image_wrap(VkDevice *device, const CELimage_handle *handle, const CELvk_image_create_info *create_info, VkImage vk_image) {
     CELvk_image image = {};
-    image.handle      = handle;
+    image.handle      = vk_image;
+    image.format      = create_info->format;
+    image.extent      = create_info->extent;
     image.own_image   = false;
 
     VkImageViewCreateInfo image_view_create_info           = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
@@ -1193,113 +2731,163 @@ CELimage_handle celvk_image_create_w_handle(VkDevice *device, VmaAllocator *allo
     image_view_create_info.subresourceRange.layerCount     = 1;
     VK_CHECK(vkCreateImageView(*device, &image_view_create_info, NULL, &image.image_view));
 
-    uint32_t index   = vk_image_count++;
-    vk_images[index] = image;
-    return (CELimage_handle){.idx = index};
+    vk_images[handle->idx] = image;
 }
 
 void celvk_image_destroy(VkDevice *device, VmaAllocator *allocator, const CELimage_handle *handle) {
+    if (!handle_pool_valid(&vk_image_pool, handle->idx, handle->generation))
+    {
+        CEL_WARN("vulkan warning: destroying stale or invalid image handle %u", handle->idx);
+        return;
+    }
+
     CELvk_image *image = &vk_images[handle->idx];
-    vkDestroyImageView(*device, image->image_view, NULL);
-    if (image->own_image) { vmaDestroyImage(*allocator, image->handle, image->allocation); }
+    if (image->own_image) { deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_IMAGE, .handle.image = image->handle, .allocation = image->allocation}); }
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_IMAGE_VIEW, .handle.image_view = image->image_view});
     *image = (CELvk_image){0};
+
+    handle_pool_free(&vk_image_pool, handle->idx, handle->generation);
+}
+
+bool celvk_image_valid(const CELimage_handle *handle) {
+    return handle_pool_valid(&vk_image_pool, handle->idx, handle->generation);
 }
 
 CELsampler_handle celvk_sampler_create(VkDevice *device, const VkSamplerCreateInfo *create_info) {
-    assert(vk_sampler_count < CELVK_MAX_SAMPLER_COUNT && "vulkan error: exceeded max sampler count");
+    CELsampler_handle handle = {0};
+    if (!handle_pool_alloc(&vk_sampler_pool, &handle.idx, &handle.generation))
+    {
+        assert(false && "vulkan error: exceeded max sampler count");
+        return handle;
+    }
 
     CELvk_sampler sampler = {0};
 
     VK_CHECK(vkCreateSampler(*device, create_info, NULL, &sampler.handle));
-    uint32_t index     = vk_sampler_count++;
-    vk_samplers[index] = sampler;
-    return (CELsampler_handle){.idx = index};
+    vk_samplers[handle.idx] = sampler;
+
+    bindless_sampler_write(device, handle.idx, sampler.handle);
+    return handle;
 }
 
 void celvk_sampler_destroy(VkDevice *device, const CELsampler_handle *handle) {
-    CELvk_sampler *sampler = &vk_samplers[handle->idx];
-    vkDestroySampler(*device, sampler->handle, NULL);
+    if (!handle_pool_valid(&vk_sampler_pool, handle->idx, handle->generation))
+    {
+        CEL_WARN("vulkan warning: destroying stale or invalid sampler handle %u", handle->idx);
+        return;
+    }
+
+    CELvk_sampler *sampler = vk_sampler_get(handle);
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_SAMPLER, .handle.sampler = sampler->handle});
     *sampler = (CELvk_sampler){0};
+
+    handle_pool_free(&vk_sampler_pool, handle->idx, handle->generation);
+}
+
+bool celvk_sampler_valid(const CELsampler_handle *handle) {
+    return handle_pool_valid(&vk_sampler_pool, handle->idx, handle->generation);
 }
 
 void vk_images_destroy(VkDevice *device, VmaAllocator *allocator) {
-    for (uint32_t i = 0; i < vk_image_count; ++i)
+    for (uint32_t i = 0; i < vk_image_pool.count; ++i)
     {
-        celvk_image_destroy(device, allocator, &(CELimage_handle){.idx = i});
+        if (!handle_pool_live(&vk_image_pool, i)) { continue; }
+        celvk_image_destroy(device, allocator, &(CELimage_handle){.idx = i, .generation = vk_image_slots[i].generation});
     }
 }
 
 void vk_buffers_destroy(VmaAllocator *allocator) {
-    for (uint32_t i = 0; i < vk_buffer_count; ++i)
+    for (uint32_t i = 0; i < vk_buffer_pool.count; ++i)
     {
-        celvk_buffer_destroy(allocator, &(CELbuffer_handle){.idx = i});
+        if (!handle_pool_live(&vk_buffer_pool, i)) { continue; }
+        celvk_buffer_destroy(allocator, &(CELbuffer_handle){.idx = i, .generation = vk_buffer_slots[i].generation});
     }
 }
 
 void vk_samplers_destroy(VkDevice *device) {
-    for (uint32_t i = 0; i < vk_sampler_count; ++i)
+    for (uint32_t i = 0; i < vk_sampler_pool.count; ++i)
     {
-        celvk_sampler_destroy(device, &(CELsampler_handle){.idx = i});
+        if (!handle_pool_live(&vk_sampler_pool, i)) { continue; }
+        celvk_sampler_destroy(device, &(CELsampler_handle){.idx = i, .generation = vk_sampler_slots[i].generation});
     }
 }
 
-uint32_t *celvk_load_shader_w_spv(const char *path, size_t *size) {
-    char cwd[FS_PATH_MAX];
-    getcwd(cwd, sizeof(cwd));
-    printf("current workider: %s\n", cwd);
-    FILE *file;
-    fopen_s(&file, path, "rb");
-    if (!file)
+void vk_programs_destroy(VkDevice *device) {
+    for (uint32_t i = 0; i < vk_program_pool.count; ++i)
     {
-        perror("io error: failed to open .spv file");
-        return NULL;
+        if (!handle_pool_live(&vk_program_pool, i)) { continue; }
+        celvk_program_destroy(device, &(CELprogram_handle){.idx = i, .generation = vk_program_slots[i].generation});
     }
+}
 
-    fseek(file, 0, SEEK_END);
-    size_t s = ftell(file);
-    rewind(file);
+bool celvk_load_shader_w_spv(const char *path, CELfile_view *view) {
+    return shader_view_open(path, true, view);
+}
 
-    if (s % 4 != 0)
+bool resource_view_open(const char *path, bool use_pak, CELfile_view *view) {
+    // the pak names files relative to the engine path with '/' separators
+    size_t engine_path_length = strlen(vk_ctx.engine_path);
+    if (use_pak && vk_ctx.pak && strncmp(path, vk_ctx.engine_path, engine_path_length) == 0 && (path[engine_path_length] == '/' || path[engine_path_length] == '\\'))
     {
-        CEL_ERROR("io error: spirv size is not a multiple of 4");
-        fclose(file);
-        return NULL;
+        char name[FS_PATH_MAX];
+        snprintf(name, sizeof(name), "%s", path + engine_path_length + 1);
+        for (char *c = name; *c; ++c)
+        {
+            if (*c == '\\') { *c = '/'; }
+        }
+
+        if (celpak_find(vk_ctx.pak, name, view)) { return true; }
     }
 
-    uint32_t *buffer = cel_arena_alloc(&vk_arena, s);
-    if (!buffer)
+    return celfs_view_open(view, path);
+}
+
+bool shader_view_open(const char *path, bool use_pak, CELfile_view *view) {
+    if (!resource_view_open(path, use_pak, view))
     {
-        fclose(file);
-        return NULL;
+        CEL_ERROR("io error: failed to open %s", path);
+        return false;
     }
 
-    size_t read_size = fread(buffer, 1, s, file);
-    fclose(file);
-
-    if (read_size != s)
+    // a shader caught halfway through being written is rejected here instead of reaching the driver
+    const uint32_t *code = celfs_view_map(view);
+    size_t size          = celfs_view_size(view);
+    if (!code || size < sizeof(uint32_t) || size % 4 != 0 || code[0] != CELVK_SPIRV_MAGIC)
     {
-        CEL_ERROR("io error: failed read entire .spv file");
-        return NULL;
+        CEL_ERROR("io error: %s is not a spirv module", path);
+        celfs_view_unmap(view);
+        return false;
     }
 
-    *size = s;
-    return buffer;
+    return true;
 }
 
 VkPipeline celvk_graphics_pipeline_create(VkDevice *device, const VkPipelineRenderingCreateInfo *rendering_create_info, const CELprogram_handle *program_handle) {
-    VkGraphicsPipelineCreateInfo create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
-
-    CELvk_program *program = &vk_programs[program_handle->idx];
+    CELvk_program *program = vk_program_get(program_handle);
     assert(program->stage_count > 0 && "failed shader stage should larger than 0");
     if (program->stage_count <= 0) { return NULL; }
 
-    VkPipelineShaderStageCreateInfo *stages = cel_arena_alloc(&vk_arena, sizeof(VkPipelineShaderStageCreateInfo) * program->stage_count);
-    for (uint32_t i = 0; i < program->stage_count; ++i)
+    uint64_t start_ns   = time_now_ns();
+    VkPipeline pipeline = NULL;
+    VK_CHECK(graphics_pipeline_build(device, rendering_create_info, program->layout, program->shader_modules, program->shader_stages, program->stage_count, &pipeline));
+    CEL_DEBUG("graphics pipeline created in %.3f ms", (double) (time_now_ns() - start_ns) / 1e6);
+
+    for (uint32_t i = 0; i < program->stage_count; ++i) { vkDestroyShaderModule(*device, program->shader_modules[i], NULL); }
+
+    return pipeline;
+}
+
+// touches no shared engine state, so the shader watcher can build on its own thread
+VkResult graphics_pipeline_build(VkDevice *device, const VkPipelineRenderingCreateInfo *rendering_create_info, VkPipelineLayout layout, const VkShaderModule *shader_modules, const VkShaderStageFlags *shader_stages, uint32_t stage_count, VkPipeline *pipeline) {
+    assert(stage_count <= CELVK_MAX_PROGRAM_STAGE_COUNT);
+
+    VkPipelineShaderStageCreateInfo stages[CELVK_MAX_PROGRAM_STAGE_COUNT];
+    for (uint32_t i = 0; i < stage_count; ++i)
     {
         stages[i] = (VkPipelineShaderStageCreateInfo){
             .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage  = program->shader_stages[i],
-            .module = program->shader_modules[i],
+            .stage  = (VkShaderStageFlagBits) shader_stages[i],
+            .module = shader_modules[i],
             .pName  = "main",
         };
     }
@@ -1353,12 +2941,12 @@ VkPipeline celvk_graphics_pipeline_create(VkDevice *device, const VkPipelineRend
     depth_stencil_state.maxDepthBounds                        = 1.0f;
 
     VkPipelineColorBlendAttachmentState color_attachment = {
-        .blendEnable         = false,
-        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
-        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .blendEnable         = true,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .colorBlendOp        = VK_BLEND_OP_ADD,
-        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
-        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
         .alphaBlendOp        = VK_BLEND_OP_ADD,
         .colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
     };
@@ -1382,7 +2970,7 @@ VkPipeline celvk_graphics_pipeline_create(VkDevice *device, const VkPipelineRend
 
     VkGraphicsPipelineCreateInfo pipeline_create_info = {VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO};
     pipeline_create_info.pNext                        = rendering_create_info;
-    pipeline_create_info.stageCount                   = program->stage_count;
+    pipeline_create_info.stageCount                   = stage_count;
     pipeline_create_info.pStages                      = stages;
     pipeline_create_info.pVertexInputState            = &vertex_input_state;
     pipeline_create_info.pInputAssemblyState          = &input_assembly_state;
@@ -1393,36 +2981,378 @@ VkPipeline celvk_graphics_pipeline_create(VkDevice *device, const VkPipelineRend
     pipeline_create_info.pDepthStencilState           = &depth_stencil_state;
     pipeline_create_info.pColorBlendState             = &color_blend_state;
     pipeline_create_info.pDynamicState                = &dynamic_state;
-    pipeline_create_info.layout                       = program->layout;
+    pipeline_create_info.layout                       = layout;
 
-    VkPipeline pipeline = NULL;
+    return vkCreateGraphicsPipelines(*device, vk_ctx.pipeline_cache, 1, &pipeline_create_info, NULL, pipeline);
+}
 
-    for (uint32_t i = 0; i < program->stage_count; ++i) { vkDestroyShaderModule(*device, program->shader_modules[i], NULL); }
+void celvk_pipeline_destroy(VkDevice *device, VkPipeline *pipeline) {
+    if (*pipeline == VK_NULL_HANDLE) { return; }
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_PIPELINE, .handle.pipeline = *pipeline});
+    *pipeline = VK_NULL_HANDLE;
+}
 
-    return pipeline;
+VkShaderStageFlagBits shader_stage_from_path(const char *path) {
+    if (strstr(path, ".vert.")) { return VK_SHADER_STAGE_VERTEX_BIT; }
+    if (strstr(path, ".frag.")) { return VK_SHADER_STAGE_FRAGMENT_BIT; }
+    if (strstr(path, ".comp.")) { return VK_SHADER_STAGE_COMPUTE_BIT; }
+
+    CEL_ERROR("vulkan error: unknown shader stage for %s", path);
+    abort();
 }
 
-void celvk_pipeline_destroy(VkDevice *device, VkPipeline *pipeline) {
+bool shader_module_create(VkDevice *device, const char *path, bool use_pak, VkShaderModule *shader_module) {
+    // the driver copies the code during creation, so the mapping only has to live until then
+    CELfile_view view;
+    if (!shader_view_open(path, use_pak, &view)) { return false; }
+
+    VkShaderModuleCreateInfo create_info = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
+    create_info.codeSize                 = celfs_view_size(&view);
+    create_info.pCode                    = view.data;
+    VkResult result                      = vkCreateShaderModule(*device, &create_info, NULL, shader_module);
+    celfs_view_unmap(&view);
+
+    if (result != VK_SUCCESS)
+    {
+        CEL_ERROR("vulkan error: failed to create shader module %s: %s", path, vk_result_string(result));
+        return false;
+    }
+    return true;
+}
+
+#if defined(CELVK_USE_SHADER_HOT_RELOAD)
+
+Internal int shader_watcher_main(void *data);
+Internal bool shader_watcher_poll(uint32_t timeout_ms);
+Internal void shader_watcher_rebuild();
+Internal int64_t shader_mtime_get(const char *path);
+
+void shader_watcher_create() {
+    vk_shader_watcher.notify_fd = -1;
+    vk_shader_watcher.pending   = 0;
+    vk_shader_watcher.building  = 0;
+    vk_shader_watcher.running   = 1;
+    mutex_init(&vk_shader_watcher.mutex);
+
+    #if defined(__linux__)
+    vk_shader_watcher.notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (vk_shader_watcher.notify_fd < 0) { CEL_WARN("vulkan warning: inotify unavailable, shader hot reload disabled"); }
+    #endif
+
+    if (!thread_create(&vk_shader_watcher.thread, shader_watcher_main, NULL))
+    {
+        CEL_WARN("vulkan warning: failed to start the shader watcher, shader hot reload disabled");
+        vk_shader_watcher.running = 0;
+    }
+}
+
+void shader_watcher_destroy() {
+    if (cel_atomic_load_i32(&vk_shader_watcher.running))
+    {
+        cel_atomic_store_i32(&vk_shader_watcher.running, 0);
+        thread_join(&vk_shader_watcher.thread);
+    }
+
+    // rebuilds that never made it to a frame boundary were never used by the gpu
+    for (uint32_t i = 0; i < CELVK_MAX_PROGRAM_COUNT; ++i)
+    {
+        CELvk_program_source *source = &vk_program_sources[i];
+        if (source->rebuilt) { vkDestroyPipeline(vk_ctx.device.handle, source->rebuilt, NULL); }
+        *source = (CELvk_program_source){0};
+    }
+
+    #if defined(__linux__)
+    if (vk_shader_watcher.notify_fd >= 0) { close(vk_shader_watcher.notify_fd); }
+    #endif
+    mutex_fini(&vk_shader_watcher.mutex);
+}
+
+void shader_watcher_register(const CELprogram_handle *handle, VkPipelineLayout layout, const VkPipelineRenderingCreateInfo *rendering_create_info, const char **shader_paths, uint32_t shader_count) {
+    if (rendering_create_info->colorAttachmentCount > CELVK_MAX_PROGRAM_COLOR_FORMAT_COUNT)
+    {
+        CEL_WARN("vulkan warning: program %u has too many color attachments to hot reload", handle->idx);
+        return;
+    }
+
+    mutex_lock(&vk_shader_watcher.mutex);
+
+    CELvk_program_source *source = &vk_program_sources[handle->idx];
+    *source                      = (CELvk_program_source){0};
+    source->program              = *handle;
+    source->layout               = layout;
+    source->stage_count          = shader_count;
+    source->color_format_count   = rendering_create_info->colorAttachmentCount;
+    source->depth_format         = rendering_create_info->depthAttachmentFormat;
+    source->stencil_format       = rendering_create_info->stencilAttachmentFormat;
+    source->view_mask            = rendering_create_info->viewMask;
+    if (source->color_format_count > 0) { memcpy(source->color_formats, rendering_create_info->pColorAttachmentFormats, sizeof(VkFormat) * source->color_format_count); }
+
+    for (uint32_t i = 0; i < shader_count; ++i)
+    {
+        snprintf(source->shader_paths[i], FS_PATH_MAX, "%s", shader_paths[i]);
+        source->shader_mtimes[i] = shader_mtime_get(shader_paths[i]);
+        source->watch_ids[i]     = -1;
+
+    #if defined(__linux__)
+        // watch the directory rather than the file, compilers usually replace the output instead of rewriting it
+        if (vk_shader_watcher.notify_fd < 0) { continue; }
+
+        char directory[FS_PATH_MAX];
+        snprintf(directory, sizeof(directory), "%s", shader_paths[i]);
+        char *separator = strrchr(directory, '/');
+        if (separator) { *separator = '\0'; }
+        else { snprintf(directory, sizeof(directory), "."); }
+
+        source->watch_ids[i] = inotify_add_watch(vk_shader_watcher.notify_fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO);
+    #endif
+    }
+    source->live = true;
+
+    mutex_unlock(&vk_shader_watcher.mutex);
+}
+
+void shader_watcher_unregister(const CELprogram_handle *handle) {
+    mutex_lock(&vk_shader_watcher.mutex);
+
+    CELvk_program_source *source = &vk_program_sources[handle->idx];
+    if (source->rebuilt) { vkDestroyPipeline(vk_ctx.device.handle, source->rebuilt, NULL); }
+    *source = (CELvk_program_source){0};
+
+    mutex_unlock(&vk_shader_watcher.mutex);
+
+    // a compile in flight still uses the program's layout, the watcher drops its result once it sees the program gone
+    while (cel_atomic_load_i32(&vk_shader_watcher.building) == (int32_t) handle->idx + 1) { thread_yield(); }
+}
+
+void shader_watcher_swap() {
+    if (!cel_atomic_load_i32(&vk_shader_watcher.pending)) { return; }
+
+    mutex_lock(&vk_shader_watcher.mutex);
+    cel_atomic_store_i32(&vk_shader_watcher.pending, 0);
+
+    // nothing has been recorded for this frame yet, so every batch from here on uses the new pipeline.
+    // the old one goes through the deletion queue, which outlives the frames still using it
+    for (uint32_t i = 0; i < vk_program_pool.count; ++i)
+    {
+        CELvk_program_source *source = &vk_program_sources[i];
+        if (!source->rebuilt) { continue; }
+
+        CELvk_program *program = &vk_programs[i];
+        celvk_pipeline_destroy(&vk_ctx.device.handle, &program->pipeline);
+        program->pipeline = source->rebuilt;
+        source->rebuilt   = VK_NULL_HANDLE;
+        CEL_INFO("vulkan: reloaded program %u", i);
+    }
+
+    mutex_unlock(&vk_shader_watcher.mutex);
+}
+
+int shader_watcher_main(void *data) {
+    (void) data;
+
+    while (cel_atomic_load_i32(&vk_shader_watcher.running))
+    {
+        if (!shader_watcher_poll(CELVK_SHADER_WATCH_INTERVAL_MS)) { continue; }
+
+        // a program usually has several stages compiled back to back, let them all land before rebuilding
+        thread_sleep_ms(CELVK_SHADER_SETTLE_MS);
+        shader_watcher_poll(0);
+        shader_watcher_rebuild();
+    }
+
+    return 0;
+}
+
+bool shader_watcher_poll(uint32_t timeout_ms) {
+    bool changed = false;
+
+    #if defined(__linux__)
+    if (vk_shader_watcher.notify_fd >= 0)
+    {
+        struct pollfd poll_fd = {.fd = vk_shader_watcher.notify_fd, .events = POLLIN};
+        if (poll(&poll_fd, 1, (int) timeout_ms) <= 0) { return false; }
+
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+        while ((length = read(vk_shader_watcher.notify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            mutex_lock(&vk_shader_watcher.mutex);
+            for (char *cursor = buffer; cursor < buffer + length;)
+            {
+                const struct inotify_event *event = (const struct inotify_event *) cursor;
+                cursor += sizeof(struct inotify_event) + event->len;
+                if (event->len == 0) { continue; }
+
+                for (uint32_t i = 0; i < CELVK_MAX_PROGRAM_COUNT; ++i)
+                {
+                    CELvk_program_source *source = &vk_program_sources[i];
+                    if (!source->live) { continue; }
+
+                    for (uint32_t j = 0; j < source->stage_count; ++j)
+                    {
+                        const char *separator = strrchr(source->shader_paths[j], '/');
+                        const char *file_name = separator ? separator + 1 : source->shader_paths[j];
+                        if (source->watch_ids[j] == event->wd && strcmp(file_name, event->name) == 0)
+                        {
+                            source->dirty = true;
+                            changed       = true;
+                        }
+                    }
+                }
+            }
+            mutex_unlock(&vk_shader_watcher.mutex);
+        }
+        return changed;
+    }
+    #endif
+
+    // no change notifications on this platform, fall back to polling modification times
+    thread_sleep_ms(timeout_ms);
+
+    mutex_lock(&vk_shader_watcher.mutex);
+    for (uint32_t i = 0; i < CELVK_MAX_PROGRAM_COUNT; ++i)
+    {
+        CELvk_program_source *source = &vk_program_sources[i];
+        if (!source->live) { continue; }
+
+        for (uint32_t j = 0; j < source->stage_count; ++j)
+        {
+            int64_t mtime = shader_mtime_get(source->shader_paths[j]);
+            if (mtime == source->shader_mtimes[j]) { continue; }
+
+            source->shader_mtimes[j] = mtime;
+            source->dirty            = true;
+            changed                  = true;
+        }
+    }
+    mutex_unlock(&vk_shader_watcher.mutex);
+
+    return changed;
+}
+
+void shader_watcher_rebuild() {
+    VkDevice *device = &vk_ctx.device.handle;
+
+    for (uint32_t i = 0; i < CELVK_MAX_PROGRAM_COUNT; ++i)
+    {
+        // the sources are copied under the lock and compiled without it, so the frame loop never waits on a compile
+        mutex_lock(&vk_shader_watcher.mutex);
+        CELvk_program_source *source = &vk_program_sources[i];
+        if (!source->live || !source->dirty)
+        {
+            mutex_unlock(&vk_shader_watcher.mutex);
+            continue;
+        }
+        source->dirty                 = false;
+        CELvk_program_source snapshot = *source;
+        cel_atomic_store_i32(&vk_shader_watcher.building, (int32_t) i + 1);
+        mutex_unlock(&vk_shader_watcher.mutex);
+
+        uint64_t start_ns = time_now_ns();
+
+        VkShaderModule shader_modules[CELVK_MAX_PROGRAM_STAGE_COUNT] = {0};
+        VkShaderStageFlags shader_stages[CELVK_MAX_PROGRAM_STAGE_COUNT];
+        bool loaded = true;
+        for (uint32_t j = 0; j < snapshot.stage_count && loaded; ++j)
+        {
+            // the watcher saw the loose file change, so that is what gets rebuilt even when a pak is mounted
+            loaded           = shader_module_create(device, snapshot.shader_paths[j], false, &shader_modules[j]);
+            shader_stages[j] = shader_stage_from_path(snapshot.shader_paths[j]);
+        }
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (loaded)
+        {
+            VkPipelineRenderingCreateInfo rendering_create_info = {VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+            rendering_create_info.viewMask                      = snapshot.view_mask;
+            rendering_create_info.colorAttachmentCount          = snapshot.color_format_count;
+            rendering_create_info.pColorAttachmentFormats       = snapshot.color_formats;
+            rendering_create_info.depthAttachmentFormat         = snapshot.depth_format;
+            rendering_create_info.stencilAttachmentFormat       = snapshot.stencil_format;
+
+            VkResult result = graphics_pipeline_build(device, &rendering_create_info, snapshot.layout, shader_modules, shader_stages, snapshot.stage_count, &pipeline);
+            if (result != VK_SUCCESS)
+            {
+                CEL_ERROR("vulkan error: failed to rebuild program %u: %s", i, vk_result_string(result));
+                pipeline = VK_NULL_HANDLE;
+            }
+        }
+
+        for (uint32_t j = 0; j < snapshot.stage_count; ++j)
+        {
+            if (shader_modules[j]) { vkDestroyShaderModule(*device, shader_modules[j], NULL); }
+        }
+
+        // the program may have been destroyed, or its slot reused, while the pipeline compiled
+        mutex_lock(&vk_shader_watcher.mutex);
+        bool still_live = source->live && source->program.idx == snapshot.program.idx && source->program.generation == snapshot.program.generation;
+        if (pipeline && !still_live)
+        {
+            vkDestroyPipeline(*device, pipeline, NULL);
+            pipeline = VK_NULL_HANDLE;
+        }
+
+        // a broken shader keeps the last good pipeline running. a second save before the frame boundary
+        // supersedes the first rebuild, which the gpu never saw
+        if (pipeline)
+        {
+            if (source->rebuilt) { vkDestroyPipeline(*device, source->rebuilt, NULL); }
+            source->rebuilt = pipeline;
+            cel_atomic_store_i32(&vk_shader_watcher.pending, 1);
+        }
+        cel_atomic_store_i32(&vk_shader_watcher.building, 0);
+        mutex_unlock(&vk_shader_watcher.mutex);
+
+        if (pipeline) { CEL_INFO("vulkan: rebuilt program %u in %.2f ms", i, (double) (time_now_ns() - start_ns) / 1e6); }
+    }
 }
 
-CELprogram_handle celvk_program_create(VkDevice *device, VkPipelineBindPoint bind_point, size_t push_constant_size, const char **shader_paths, uint32_t shader_count) {
-    assert(vk_program_count < CELVK_MAX_PROGRAM_COUNT && "vulkan error: exceeded max program count");
+int64_t shader_mtime_get(const char *path) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0) { return -1; }
+    return (int64_t) file_stat.st_mtime;
+}
+
+#else
+
+void shader_watcher_create() {}
+void shader_watcher_destroy() {}
+void shader_watcher_register(const CELprogram_handle *handle, VkPipelineLayout layout, const VkPipelineRenderingCreateInfo *rendering_create_info, const char **shader_paths, uint32_t shader_count) {
+    (void) handle;
+    (void) layout;
+    (void) rendering_create_info;
+    (void) shader_paths;
+    (void) shader_count;
+}
+void shader_watcher_unregister(const CELprogram_handle *handle) { (void) handle; }
+void shader_watcher_swap() {}
+
+#endif// CELVK_USE_SHADER_HOT_RELOAD
+
+CELprogram_handle celvk_program_create(VkDevice *device, VkPipelineBindPoint bind_point, size_t push_constant_size, const VkPipelineRenderingCreateInfo *rendering_create_info, const char **shader_paths, uint32_t shader_count) {
+    CELprogram_handle handle = {0};
+    if (!handle_pool_alloc(&vk_program_pool, &handle.idx, &handle.generation))
+    {
+        assert(false && "vulkan error: exceeded max program count");
+        return handle;
+    }
+
+    assert(shader_count <= CELVK_MAX_PROGRAM_STAGE_COUNT && "vulkan error: exceeded max program stage count");
 
     CELvk_program program = {0};
     program.stage_count   = shader_count;
 
-    program.shader_modules = cel_arena_alloc(&vk_arena, sizeof(VkShaderModule) * shader_count);
-    uint32_t **shader_code = cel_arena_alloc(&vk_arena, sizeof(uint32_t *) * shader_count);
-    size_t *shader_sizes   = cel_arena_alloc(&vk_arena, sizeof(size_t) * shader_count);
+    // the modules are destroyed once the pipeline is built, so the arrays only live for this call
+    CELarena_temp scratch  = cel_arena_scratch_get(NULL, 0);
+    program.shader_modules = cel_arena_alloc(scratch.arena, sizeof(VkShaderModule) * shader_count);
+    program.shader_stages  = cel_arena_alloc(scratch.arena, sizeof(VkShaderStageFlags) * shader_count);
     for (uint32_t i = 0; i < shader_count; ++i)
     {
-        shader_code[i] = celvk_load_shader_w_spv(shader_paths[i], &shader_sizes[i]);
-        assert(shader_code[i] && "vulkan error: failed to load shader from path");
+        bool loaded = shader_module_create(device, shader_paths[i], true, &program.shader_modules[i]);
+        assert(loaded && "vulkan error: failed to load shader from path");
+        (void) loaded;
 
-        VkShaderModuleCreateInfo shader_module_create_info = {VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO};
-        shader_module_create_info.codeSize                 = shader_sizes[i];
-        shader_module_create_info.pCode                    = shader_code[i];
-        VK_CHECK(vkCreateShaderModule(*device, &shader_module_create_info, NULL, &program.shader_modules[i]));
+        program.shader_stages[i] = shader_stage_from_path(shader_paths[i]);
     }
 
     program.bind_point = bind_point;
@@ -1436,33 +3366,60 @@ CELprogram_handle celvk_program_create(VkDevice *device, VkPipelineBindPoint bin
     pipeline_layout_create_info.pNext                      = NULL;
     pipeline_layout_create_info.flags                      = 0;
     pipeline_layout_create_info.setLayoutCount             = 1;
-    pipeline_layout_create_info.pSetLayouts                = NULL;
+    pipeline_layout_create_info.pSetLayouts                = &vk_ctx.descriptor.set_layout;
     pipeline_layout_create_info.pushConstantRangeCount     = push_constant_size > 0 ? 1 : 0;
     pipeline_layout_create_info.pPushConstantRanges        = push_constant_size > 0 ? &push_constant_range : NULL;
 
     VK_CHECK(vkCreatePipelineLayout(*device, &pipeline_layout_create_info, NULL, &program.layout));
-    uint32_t index     = vk_program_count++;
-    vk_programs[index] = program;
+    vk_programs[handle.idx] = program;
+
+    vk_programs[handle.idx].pipeline       = celvk_graphics_pipeline_create(device, rendering_create_info, &handle);
+    vk_programs[handle.idx].shader_modules = NULL;
+    vk_programs[handle.idx].shader_stages  = NULL;
+    cel_arena_scratch_release(scratch);
 
-    program.pipeline = celvk_graphics_pipeline_create(device, &(VkPipelineRenderingCreateInfo){}, &(CELprogram_handle){.idx = index});
+    shader_watcher_register(&handle, program.layout, rendering_create_info, shader_paths, shader_count);
 
-    return (CELprogram_handle){.idx = index};
+    return handle;
 }
 
 CELAPI CELprogram_handle celvk_sprite_renderer_create(VkFormat format) {
-    char *vert = cel_arena_alloc(&vk_arena, FS_PATH_MAX);
-    char *frag = cel_arena_alloc(&vk_arena, FS_PATH_MAX);
-    snprintf(vert, sizeof(vert), "%s/%s", vk_ctx.engine_path, "/builtin_sprite.vert.glsl.spv");
-    snprintf(vert, sizeof(frag), "%s/%s", vk_ctx.engine_path, "/builtin_sprite.frag.glsl.spv");
+    // the program loads the modules and the watcher copies the paths, so they only live for this call
+    CELarena_temp scratch = cel_arena_scratch_get(NULL, 0);
+    char *vert            = cel_arena_alloc(scratch.arena, FS_PATH_MAX);
+    char *frag            = cel_arena_alloc(scratch.arena, FS_PATH_MAX);
+    snprintf(vert, FS_PATH_MAX, "%s/shaders/%s", vk_ctx.engine_path, "builtin_sprite.vert.glsl.spv");
+    snprintf(frag, FS_PATH_MAX, "%s/shaders/%s", vk_ctx.engine_path, "builtin_sprite.frag.glsl.spv");
     const char *shader_paths[2] = {vert, frag};
 
-    return celvk_program_create(&vk_ctx.device.handle, VK_PIPELINE_BIND_POINT_GRAPHICS, sizeof(CELsprite_renderer_pc), shader_paths, 2);
+    VkPipelineRenderingCreateInfo rendering_create_info = {VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+    rendering_create_info.colorAttachmentCount          = 1;
+    rendering_create_info.pColorAttachmentFormats       = &format;
+
+    CELprogram_handle program = celvk_program_create(&vk_ctx.device.handle, VK_PIPELINE_BIND_POINT_GRAPHICS, sizeof(CELsprite_renderer_pc), &rendering_create_info, shader_paths, 2);
+    cel_arena_scratch_release(scratch);
+    return program;
 }
 
 CELAPI void celvk_program_destroy(VkDevice *device, const CELprogram_handle *handle) {
+    if (!handle_pool_valid(&vk_program_pool, handle->idx, handle->generation))
+    {
+        CEL_WARN("vulkan warning: destroying stale or invalid program handle %u", handle->idx);
+        return;
+    }
+
+    shader_watcher_unregister(handle);
+
     CELvk_program *program = &vk_programs[handle->idx];
-    vkDestroyPipelineLayout(*device, program->layout, NULL);
+    deletion_push((CELvk_deletion){.type = VK_OBJECT_TYPE_PIPELINE_LAYOUT, .handle.pipeline_layout = program->layout});
+    celvk_pipeline_destroy(device, &program->pipeline);
     *program = (CELvk_program){0};
+
+    handle_pool_free(&vk_program_pool, handle->idx, handle->generation);
+}
+
+bool celvk_program_valid(const CELprogram_handle *handle) {
+    return handle_pool_valid(&vk_program_pool, handle->idx, handle->generation);
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL debug_utils_messenger_callback(VkDebugUtilsMessageSeverityFlagBitsEXT message_severity, VkDebugUtilsMessageTypeFlagsEXT message_type, const VkDebugUtilsMessengerCallbackDataEXT *callback_data, void *user_data) {
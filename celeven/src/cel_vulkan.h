@@ -31,6 +31,12 @@ const char *vk_result_string(VkResult result);
         }                                \
     } while (0)
 
+#define CELVK_INVALID_INDEX UINT32_MAX
+
+#define CELVK_MAX_RECORD_WORKER_COUNT CEL_MAX_JOB_THREAD_COUNT// a record worker per job thread
+#define CELVK_WORKER_SECONDARY_COUNT 8// per worker and frame to start with, doubled whenever a worker records more
+#define CELVK_MAX_GPU_TIMESTAMP_COUNT 64// per frame, a pair for every pass recorded into it
+
 struct GLFWwindow;
 
 CEL_HANDLE_DEFINE(buffer_handle);
@@ -38,10 +44,42 @@ CEL_HANDLE_DEFINE(image_handle);
 CEL_HANDLE_DEFINE(sampler_handle);
 CEL_HANDLE_DEFINE(program_handle);
 
+// modes the surface does not support fall back towards fifo, which every surface has
+typedef enum CELvk_present_mode
+{
+    CELVK_PRESENT_MODE_FIFO,     // vsync, the cpu blocks on acquire once every image is queued
+    CELVK_PRESENT_MODE_MAILBOX,  // vsync, a newer frame replaces the queued one, falls back to fifo
+    CELVK_PRESENT_MODE_IMMEDIATE,// no vsync and may tear, falls back to mailbox
+    CELVK_PRESENT_MODE_COUNT
+} CELvk_present_mode;
+
 typedef struct CELvk_state CELvk_state;
 struct CELvk_state {
     const char *app_name;
     const char *engine_path;
+    const char *user_path;          // writable, the pipeline cache is kept here so it never lands in the packed resources
+    const CELpak *pak;              // resources under engine_path are read from here first, NULL reads loose files
+    uint32_t frames_in_flight;      // 0 picks the default
+    uint32_t frame_lead;            // frames the cpu may record ahead of the gpu, 0 allows every frame in flight
+    uint32_t swapchain_image_count; // 0 asks for one above the surface minimum
+    CELvk_present_mode present_mode;// see celvk_present_mode_set
+    bool headless;                  // no surface or swapchain, the window passed to cel_vulkan_init is NULL
+};
+
+// passes are timed on the gpu when they are recorded into the frame's primary command buffer
+typedef enum CELvk_gpu_pass
+{
+    CELVK_GPU_PASS_CLEAR,
+    CELVK_GPU_PASS_SPRITES,
+    CELVK_GPU_PASS_BLIT,
+    CELVK_GPU_PASS_COUNT
+} CELvk_gpu_pass;
+
+typedef struct CELvk_gpu_timings CELvk_gpu_timings;
+struct CELvk_gpu_timings {
+    uint64_t frame_index;                // the retired frame these were measured on
+    double pass_ms[CELVK_GPU_PASS_COUNT];// summed over every time the pass ran that frame
+    double frame_ms;                     // first pass begin to last pass end
 };
 
 typedef struct CELrgba CELrgba;
@@ -52,13 +90,69 @@ struct CELrgba {
     float a;
 };
 
+typedef struct CELsprite CELsprite;
+struct CELsprite {
+    float position[2];// center, in render target pixels
+    float size[2];
+    float uv[4];// min.xy, max.xy
+    CELrgba color;
+    float rotation;// radians
+    float padding[3];
+};
+
+// a vulkan object whose destruction waits until the frame that last used it has retired
+typedef struct CELvk_deletion CELvk_deletion;
+struct CELvk_deletion {
+    VkObjectType type;
+    union {
+        VkBuffer buffer;
+        VkImage image;
+        VkImageView image_view;
+        VkSampler sampler;
+        VkPipeline pipeline;
+        VkPipelineLayout pipeline_layout;
+        VkSwapchainKHR swapchain;
+    } handle;
+    VmaAllocation allocation;
+    uint64_t retire_value;// frame timeline value after which no submitted frame can still use it
+};
+
+// secondary command buffers a single record worker owns for one frame
+typedef struct CELvk_worker_commands CELvk_worker_commands;
+struct CELvk_worker_commands {
+    VkCommandPool command_pool;
+    VkCommandBuffer *secondaries;
+    uint32_t secondary_count;// recorded this frame
+    uint32_t allocated_count;
+    uint32_t secondary_capacity;
+};
+
 typedef struct CELvk_frame_data CELvk_frame_data;
 struct CELvk_frame_data {
-    VkFence render_fence;
+    uint64_t timeline_value;// frame timeline value signaled when this slot's last submit retires
     VkSemaphore swapchain_semaphore;
     VkSemaphore render_semaphore;
     VkCommandBuffer primary_command_buffer;
     VkCommandPool primary_command_pool;
+    CELvk_worker_commands *workers;
+
+    VkDeviceSize ring_offset;// start of this frame's region in the frame ring
+    VkDeviceSize ring_head;
+
+    uint64_t upload_wait_value;// upload timeline value this frame's submit waits on
+
+    VkQueryPool timestamp_pool;// VK_NULL_HANDLE when the graphics queue cannot write timestamps
+    uint32_t timestamp_count;
+    uint64_t timestamp_frame_index;
+    CELvk_gpu_pass timestamp_passes[CELVK_MAX_GPU_TIMESTAMP_COUNT / 2];
+};
+
+typedef struct CELvk_transient_allocation CELvk_transient_allocation;
+struct CELvk_transient_allocation {
+    void *data;// written until the frame is submitted, which flushes it
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    VkDeviceAddress device_address;
 };
 
 typedef struct CELvk_buffer CELvk_buffer;
@@ -66,6 +160,9 @@ struct CELvk_buffer {
     VkBuffer handle;
     VmaAllocation allocation;
     VmaAllocationInfo allocation_info;
+    VkDeviceAddress device_address;
+    VkDeviceSize size;
+    bool graphics_owned;// an upload released it to the graphics family, only whole-buffer uploads may follow
 };
 
 typedef struct CELvk_image_create_info CELvk_image_create_info;
@@ -83,6 +180,8 @@ struct CELvk_image {
 
     VkImage handle;
     VkImageView image_view;
+    VkFormat format;
+    VkExtent3D extent;
     bool own_image;
 };
 
@@ -99,7 +198,7 @@ struct CELvk_program {
     VkPipelineLayout layout;
     VkDescriptorSetLayout set_layout;
 
-    VkShaderModule *shader_modules;
+    VkShaderModule *shader_modules;// only set while celvk_program_create builds the pipeline
     VkShaderStageFlags *shader_stages;
     uint32_t stage_count;
 };
@@ -107,34 +206,91 @@ struct CELvk_program {
 typedef struct CELsprite_renderer_pc CELsprite_renderer_pc;
 struct CELsprite_renderer_pc {
     VkDeviceAddress buffer_device_address;
+    uint32_t texture_idx;// CELVK_INVALID_INDEX draws untextured
+    uint32_t sampler_idx;
+    float screen_size[2];
 };
 
 CELAPI CELbuffer_handle celvk_staging_buffer_create(VmaAllocator *allocator, VkDeviceSize size, VkBufferUsageFlags usages);
 CELAPI CELbuffer_handle celvk_gpu_buffer_create(VmaAllocator *allocator, VkDeviceSize size, VkBufferUsageFlags usages);
 CELAPI void celvk_buffer_destroy(VmaAllocator *allocator, const CELbuffer_handle *handle);
+CELAPI bool celvk_buffer_valid(const CELbuffer_handle *handle);
+CELAPI VkDeviceAddress celvk_buffer_device_address(const CELbuffer_handle *handle);
+
+CELAPI bool celvk_transient_alloc(VkDeviceSize size, VkDeviceSize alignment, CELvk_transient_allocation *allocation);
+
+// uploads are staged and copied on the transfer queue, then handed to graphics at the next celvk_begin_draw.
+// they return a ticket for celvk_upload_complete, or 0 when the staging ring is full and the upload should be retried later.
+// the destination must not be in use by the gpu, uploads are meant to fill freshly created resources.
+// once a buffer has been handed to graphics it only takes uploads that overwrite all of it, partial ones fail with 0.
+CELAPI uint64_t celvk_upload_buffer(const CELbuffer_handle *handle, VkDeviceSize offset, const void *data, VkDeviceSize size);
+CELAPI uint64_t celvk_upload_image(const CELimage_handle *handle, const void *data, VkDeviceSize size);
+CELAPI void celvk_upload_flush();
+CELAPI bool celvk_upload_complete(uint64_t ticket);
 
 CELAPI CELimage_handle celvk_image_create(const CELvk_image_create_info *create_info, const VmaAllocationCreateInfo *allocation_info);
 CELAPI CELimage_handle celvk_image_create_w_handle(VkDevice *device, VmaAllocator *allocator, const CELvk_image_create_info *create_info, VkImage image);
 CELAPI void celvk_image_destroy(VkDevice *device, VmaAllocator *allocator, const CELimage_handle *image);
+CELAPI bool celvk_image_valid(const CELimage_handle *handle);
 
 CELAPI CELsampler_handle celvk_sampler_create(VkDevice *device, const VkSamplerCreateInfo *create_info);
 CELAPI void celvk_sampler_destroy(VkDevice *device, const CELsampler_handle *handle);
+CELAPI bool celvk_sampler_valid(const CELsampler_handle *handle);
 
-CELAPI uint32_t *celvk_load_shader_w_spv(const char *path, size_t *size);
+// maps the module without copying it, the view must be unmapped once vulkan has consumed it
+CELAPI bool celvk_load_shader_w_spv(const char *path, CELfile_view *view);
 
 CELAPI VkPipeline celvk_graphics_pipeline_create(VkDevice *device, const VkPipelineRenderingCreateInfo *rendering_create_info, const CELprogram_handle *program);
 CELAPI void celvk_pipeline_destroy(VkDevice *device, VkPipeline *pipeline);
 CELAPI CELprogram_handle celvk_sprite_renderer_create(VkFormat format);
 
-CELAPI CELprogram_handle celvk_program_create(VkDevice *device, VkPipelineBindPoint bind_point, size_t push_constant_size, const char **shader_paths, uint32_t shader_count);
+CELAPI CELprogram_handle celvk_program_create(VkDevice *device, VkPipelineBindPoint bind_point, size_t push_constant_size, const VkPipelineRenderingCreateInfo *rendering_create_info, const char **shader_paths, uint32_t shader_count);
 CELAPI void celvk_program_destroy(VkDevice *device, const CELprogram_handle *handle);
+CELAPI bool celvk_program_valid(const CELprogram_handle *handle);
 
 bool cel_vulkan_init(struct GLFWwindow *window, CELvk_state *state);
 void cel_vulkan_fini();
 
 CELAPI VkCommandBuffer celvk_begin_draw();
-CELAPI void celvk_draw();
+CELAPI void celvk_draw_sprites(const CELprogram_handle *program, const CELimage_handle *texture, const CELsprite *sprites, uint32_t sprite_count);
+CELAPI void celvk_draw(VkCommandBuffer cmd, const CELimage_handle *render_target, CELrgba clear_color);
+
+// parallel recording: split [0, celvk_sprite_count()) into slices, record each one from its own worker
+// (a worker index is owned by one thread at a time), then execute the secondaries in slice order
+CELAPI uint32_t celvk_sprite_count();
+CELAPI VkCommandBuffer celvk_record_sprites(uint32_t worker_index, const CELimage_handle *render_target, uint32_t first_sprite, uint32_t sprite_count);
+CELAPI void celvk_draw_secondaries(VkCommandBuffer cmd, const CELimage_handle *render_target, CELrgba clear_color, const VkCommandBuffer *secondaries, uint32_t secondary_count);
+// scales the render texture to fit the swapchain image, keeping its aspect, and presents it.
+// the texture must have been rendered to this frame. headless, the frame is only submitted
 CELAPI void celvk_end_draw(VkCommandBuffer cmd, CELimage_handle render_texture_handle);
 
+// marks the swapchain stale, it is rebuilt at the next celvk_end_draw without waiting for the gpu
+CELAPI void celvk_swapchain_invalidate();
+
+// the present mode and image count take effect when the swapchain is next rebuilt, which a change schedules.
+// the getters report what the surface actually granted, after fallback and clamping
+CELAPI void celvk_present_mode_set(CELvk_present_mode mode);
+CELAPI CELvk_present_mode celvk_present_mode_get();
+CELAPI const char *celvk_present_mode_name(CELvk_present_mode mode);
+CELAPI void celvk_swapchain_image_count_set(uint32_t count);// 0 asks for one above the surface minimum
+CELAPI uint32_t celvk_swapchain_image_count_get();
+
+// caps how many submitted frames celvk_begin_draw lets the gpu trail by, from 1 to the frames in flight.
+// a lower lead trades throughput for input latency, it applies from the next celvk_begin_draw
+CELAPI void celvk_frame_lead_set(uint32_t lead);// 0 allows every frame in flight
+CELAPI uint32_t celvk_frame_lead_get();
+
+// frames are numbered from 0 in submission order, celvk_frame_index is the one being recorded next.
+// celvk_frame_ready reports whether celvk_begin_draw would return without waiting on the gpu
+CELAPI uint64_t celvk_frame_index();
+CELAPI bool celvk_frame_retired(uint64_t frame_index);
+CELAPI bool celvk_frame_ready();
+CELAPI void celvk_frame_wait(uint64_t frame_index);// blocks until the frame has retired
+
+// per pass gpu time of the most recent frame whose timestamps were read back, which trails the
+// frame being recorded by the frames in flight. false until one has been read or without timestamp support
+CELAPI bool celvk_gpu_timings_get(CELvk_gpu_timings *timings);
+CELAPI const char *celvk_gpu_pass_name(CELvk_gpu_pass pass);
+
 CELAPI void celvk_clear_background(VkCommandBuffer cmd, const CELimage_handle *handle, CELrgba color);
 CELAPI void celvk_transition_image(VkCommandBuffer cmd, const CELimage_handle *handle, VkImageLayout old_layout, VkImageLayout new_layout);
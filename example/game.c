@@ -1,6 +1,11 @@
 #include "game.h"
 #include <cel.h>
 
+static void record_sprites_range(uint32_t begin, uint32_t end, uint32_t thread_index, void *data) {
+    GameState *state                                = (GameState *) data;
+    state->secondaries[begin / SPRITE_RECORD_GRAIN] = celvk_record_sprites(thread_index, &state->draw_texture, begin, end - begin);
+}
+
 bool game_init(CELgame *game) {
     GameState *state    = cel_arena_alloc(&game->state.persistent_arena, sizeof(GameState));
     state->format       = VK_FORMAT_R16G16B16A16_SFLOAT;
@@ -14,7 +19,7 @@ bool game_init(CELgame *game) {
             .usage         = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
             .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
 
-    state->sprite_renderer = celvk_sprite_renderer_create();
+    state->sprite_renderer = celvk_sprite_renderer_create(state->format);
 
     game->user_data        = state;
     return true;
@@ -30,7 +35,28 @@ bool game_draw(CELgame *game) {
 
     VkCommandBuffer cmd = celvk_begin_draw();
 
-    celvk_draw();
+    float tile_w = (float) game->config.render_width / SPRITE_GRID_X;
+    float tile_h = (float) game->config.render_height / SPRITE_GRID_Y;
+    for (uint32_t y = 0; y < SPRITE_GRID_Y; ++y)
+    {
+        for (uint32_t x = 0; x < SPRITE_GRID_X; ++x)
+        {
+            state->sprites[y * SPRITE_GRID_X + x] = (CELsprite){
+                .position = {(x + 0.5f) * tile_w, (y + 0.5f) * tile_h},
+                .size     = {tile_w * 0.8f, tile_h * 0.8f},
+                .uv       = {0.0f, 0.0f, 1.0f, 1.0f},
+                .color    = {(float) x / SPRITE_GRID_X, (float) y / SPRITE_GRID_Y, 1.0f, 1.0f},
+            };
+        }
+    }
+    celvk_draw_sprites(&state->sprite_renderer, NULL, state->sprites, SPRITE_GRID_X * SPRITE_GRID_Y);
+
+    // each slice is recorded into a secondary on whichever job thread picks it up
+    uint32_t sprite_count = celvk_sprite_count();
+    uint32_t slice_count  = (sprite_count + SPRITE_RECORD_GRAIN - 1) / SPRITE_RECORD_GRAIN;
+    job_parallel_for(sprite_count, SPRITE_RECORD_GRAIN, record_sprites_range, state);
+
+    celvk_draw_secondaries(cmd, &state->draw_texture, (CELrgba){0.0f, 0.0f, 0.0f, 1.0f}, state->secondaries, slice_count);
 
     celvk_end_draw(cmd, state->draw_texture);
 
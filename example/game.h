@@ -3,11 +3,18 @@
 #include <cel.h>
 #include <cel_vulkan.h>
 
+#define SPRITE_GRID_X 32
+#define SPRITE_GRID_Y 18
+#define SPRITE_RECORD_GRAIN 128
+#define SPRITE_RECORD_SLICE_COUNT ((SPRITE_GRID_X * SPRITE_GRID_Y + SPRITE_RECORD_GRAIN - 1) / SPRITE_RECORD_GRAIN)
+
 typedef struct GameState GameState;
 struct GameState {
     VkFormat format;
     CELimage_handle draw_texture;
     CELprogram_handle sprite_renderer;
+    CELsprite sprites[SPRITE_GRID_X * SPRITE_GRID_Y];
+    VkCommandBuffer secondaries[SPRITE_RECORD_SLICE_COUNT];
 };
 
 bool game_init(CELgame *game);
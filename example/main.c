@@ -2,10 +2,9 @@
 
 #include "game.h"
 
-#define PERSISTENT_STORAGE_SIZE (64 * 1024 * 1024)
-#define TRANSIENT_STORAGE_SIZE (64 * 1024 * 1024)
-
-GlobalVariable unsigned char buffer[PERSISTENT_STORAGE_SIZE + TRANSIENT_STORAGE_SIZE];
+// address space only, pages are committed as the arenas grow into it
+#define PERSISTENT_STORAGE_SIZE (1024ull * 1024 * 1024)
+#define TRANSIENT_STORAGE_SIZE (256ull * 1024 * 1024)
 
 bool game_create(CELgame *game) {
     game->config.title         = "CEL";
@@ -20,11 +19,8 @@ bool game_create(CELgame *game) {
     game->game_draw    = game_draw;
     game->game_destroy = game_destroy;
 
-    void *persistent_memory = buffer;
-    void *transient_memory  = buffer + PERSISTENT_STORAGE_SIZE;
-
-    cel_arena_init(&game->state.persistent_arena, persistent_memory, PERSISTENT_STORAGE_SIZE);
-    cel_arena_init(&game->state.transient_arena, transient_memory, TRANSIENT_STORAGE_SIZE);
+    if (!cel_arena_init_virtual(&game->state.persistent_arena, PERSISTENT_STORAGE_SIZE, CEL_ARENA_HUGE_PAGES)) { return false; }
+    if (!cel_arena_init_virtual(&game->state.transient_arena, TRANSIENT_STORAGE_SIZE, 0)) { return false; }
 
     return true;
 }
\ No newline at end of file
@@ -1,6 +1,24 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(set = 0, binding = 0) uniform texture2D textures[];
+layout(set = 0, binding = 1) uniform sampler samplers[];
+
+layout(push_constant) uniform PushConstants {
+    layout(offset = 8) uint texture_idx;
+    uint sampler_idx;
+} pc;
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 1) in vec4 in_color;
 
 layout(location = 0) out vec4 out_color;
+
 void main() {
-    out_color = vec4(0.0, 0.2, 1, 1.0);
-}
\ No newline at end of file
+    if (pc.texture_idx == 0xFFFFFFFFu)
+    {
+        out_color = in_color;
+        return;
+    }
+    out_color = texture(sampler2D(textures[pc.texture_idx], samplers[pc.sampler_idx]), in_uv) * in_color;
+}
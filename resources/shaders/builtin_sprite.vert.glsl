@@ -1,10 +1,47 @@
 #version 450
+#extension GL_EXT_buffer_reference : require
+
+struct Sprite {
+    vec2 position;
+    vec2 size;
+    vec4 uv;
+    vec4 color;
+    float rotation;
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer SpriteBuffer {
+    Sprite sprites[];
+};
+
+layout(push_constant) uniform PushConstants {
+    SpriteBuffer sprite_buffer;
+    uint texture_idx;
+    uint sampler_idx;
+    vec2 screen_size;
+} pc;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec4 out_color;
 
 void main() {
-    vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
+    const vec2 corners[6] = vec2[](
+    vec2(0.0, 0.0),
+    vec2(1.0, 0.0),
+    vec2(0.0, 1.0),
+    vec2(0.0, 1.0),
+    vec2(1.0, 0.0),
+    vec2(1.0, 1.0)
     );
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-}
\ No newline at end of file
+
+    Sprite sprite = pc.sprite_buffer.sprites[gl_InstanceIndex];
+    vec2 corner   = corners[gl_VertexIndex];
+
+    float s       = sin(sprite.rotation);
+    float c       = cos(sprite.rotation);
+    vec2 local    = (corner - 0.5) * sprite.size;
+    vec2 position = sprite.position + vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    gl_Position = vec4(position / pc.screen_size * 2.0 - 1.0, 0.0, 1.0);
+    out_uv      = mix(sprite.uv.xy, sprite.uv.zw, corner);
+    out_color   = sprite.color;
+}
@@ -0,0 +1,124 @@
+#include "cel.h"
+
+#include <stdlib.h>
+
+// celbench_atomic_pool [ops per thread]
+// alloc/free contention at 1 to 64 threads, the lock-free pool against a mutex around a CELpool
+
+#define ATOMIC_POOL_BENCH_CHUNK_SIZE 48
+#define ATOMIC_POOL_BENCH_CHUNK_COUNT (1 << 16)
+#define ATOMIC_POOL_BENCH_HELD_COUNT 64// chunks a thread holds at most, so frees interleave with allocs
+#define ATOMIC_POOL_BENCH_MAX_THREADS 64
+
+typedef struct CELbench_worker CELbench_worker;
+struct CELbench_worker {
+    CELthread thread;
+    uint32_t seed;
+    bool locked;
+};
+
+GlobalVariable CEL_ALIGN(64) unsigned char pool_buffer[ATOMIC_POOL_BENCH_CHUNK_SIZE * ATOMIC_POOL_BENCH_CHUNK_COUNT];
+GlobalVariable CELatomic_pool atomic_pool;
+GlobalVariable CELpool locked_pool;
+GlobalVariable CELmutex locked_pool_mutex;
+GlobalVariable uint32_t op_count = 1000000;
+
+Internal void *bench_alloc(bool locked);
+Internal void bench_free(bool locked, void *ptr);
+Internal int bench_worker_main(void *data);
+Internal double bench_run(uint32_t thread_count, bool locked);
+
+int main(int argc, char **argv) {
+    if (argc > 1) { op_count = (uint32_t) atoi(argv[1]); }
+    mutex_init(&locked_pool_mutex);
+
+    printf("%u alloc or free ops per thread on %u cores\n", op_count, cpu_core_count());
+    for (uint32_t thread_count = 1; thread_count <= ATOMIC_POOL_BENCH_MAX_THREADS; thread_count *= 2)
+    {
+        double atomic_ns = bench_run(thread_count, false);
+        double locked_ns = bench_run(thread_count, true);
+        printf("%2u threads: atomic pool %7.1f ns/op (%5.1f Mops/s), mutex + CELpool %7.1f ns/op (%5.1f Mops/s)\n",
+               thread_count, atomic_ns, thread_count * 1e3 / atomic_ns, locked_ns, thread_count * 1e3 / locked_ns);
+    }
+
+    mutex_fini(&locked_pool_mutex);
+    return 0;
+}
+
+void *bench_alloc(bool locked) {
+    if (!locked) { return atomic_pool_alloc(&atomic_pool); }
+
+    mutex_lock(&locked_pool_mutex);
+    void *ptr = pool_alloc(&locked_pool, ATOMIC_POOL_BENCH_CHUNK_SIZE);
+    mutex_unlock(&locked_pool_mutex);
+    return ptr;
+}
+
+void bench_free(bool locked, void *ptr) {
+    if (!locked)
+    {
+        atomic_pool_free(&atomic_pool, ptr);
+        return;
+    }
+
+    mutex_lock(&locked_pool_mutex);
+    pool_free(&locked_pool, ptr);
+    mutex_unlock(&locked_pool_mutex);
+}
+
+int bench_worker_main(void *data) {
+    CELbench_worker *worker = (CELbench_worker *) data;
+    void *held[ATOMIC_POOL_BENCH_HELD_COUNT];
+    uint32_t held_count = 0;
+    uint32_t random     = worker->seed;
+
+    for (uint32_t i = 0; i < op_count; ++i)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        if (held_count < ATOMIC_POOL_BENCH_HELD_COUNT && (held_count == 0 || (random & 1)))
+        {
+            void *ptr = bench_alloc(worker->locked);
+            if (ptr == NULL) { return 1; }
+            held[held_count++] = ptr;
+        }
+        else { bench_free(worker->locked, held[--held_count]); }
+    }
+    while (held_count > 0) { bench_free(worker->locked, held[--held_count]); }
+
+    atomic_pool_thread_fini();
+    return 0;
+}
+
+double bench_run(uint32_t thread_count, bool locked) {
+    if (locked) { pool_init(&locked_pool, pool_buffer, sizeof(pool_buffer), ATOMIC_POOL_BENCH_CHUNK_SIZE, 16); }
+    else { atomic_pool_init(&atomic_pool, pool_buffer, sizeof(pool_buffer), ATOMIC_POOL_BENCH_CHUNK_SIZE, 16); }
+
+    CELbench_worker workers[ATOMIC_POOL_BENCH_MAX_THREADS];
+    uint64_t start = time_now_ns();
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        workers[i] = (CELbench_worker){.seed = 0x9e3779b9u * (i + 1), .locked = locked};
+        if (!thread_create(&workers[i].thread, bench_worker_main, &workers[i]))
+        {
+            fprintf(stderr, "celbench_atomic_pool: failed to create thread %u\n", i);
+            exit(1);
+        }
+    }
+
+    int failed = 0;
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        failed |= thread_join(&workers[i].thread);
+    }
+    double elapsed_ns = (double) (time_now_ns() - start);
+
+    if (failed)
+    {
+        fprintf(stderr, "celbench_atomic_pool: a worker ran out of chunks\n");
+        exit(1);
+    }
+    if (!locked) { atomic_pool_fini(&atomic_pool); }
+    return elapsed_ns / op_count;
+}
@@ -0,0 +1,123 @@
+#include "cel.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// celbench_file_view [file_count] [rounds]
+// loading shader sized files through celfs_view against the fopen + fread into an arena it replaced.
+// the files are written to the current directory and removed afterwards, so both runs read from a warm page cache
+
+#define FILE_BENCH_MAX_FILE_COUNT 4096
+#define FILE_BENCH_MIN_SIZE (2 * 1024)
+#define FILE_BENCH_MAX_SIZE (64 * 1024)
+#define FILE_BENCH_RESERVE_SIZE (1024ull * 1024 * 1024)
+
+GlobalVariable char paths[FILE_BENCH_MAX_FILE_COUNT][32];
+
+Internal bool files_write(uint32_t file_count, size_t *total_size);
+Internal uint32_t words_sum(const void *data, size_t size);
+Internal uint32_t fread_run(CELarena *arena, uint32_t file_count);
+Internal uint32_t view_run(uint32_t file_count);
+
+int main(int argc, char **argv) {
+    uint32_t file_count = argc > 1 ? (uint32_t) atoi(argv[1]) : 300;
+    uint32_t rounds     = argc > 2 ? (uint32_t) atoi(argv[2]) : 50;
+    if (file_count == 0) { file_count = 1; }
+    if (file_count > FILE_BENCH_MAX_FILE_COUNT) { file_count = FILE_BENCH_MAX_FILE_COUNT; }
+
+    CELarena arena;
+    if (!cel_arena_init_virtual(&arena, FILE_BENCH_RESERVE_SIZE, 0))
+    {
+        fprintf(stderr, "celbench_file_view: failed to reserve the arena\n");
+        return 1;
+    }
+
+    size_t total_size = 0;
+    bool ok           = files_write(file_count, &total_size);
+    if (ok)
+    {
+        // one untimed pass of each pulls the files into the page cache and faults in the arena
+        uint32_t fread_sum = fread_run(&arena, file_count);
+        uint32_t view_sum  = view_run(file_count);
+        ok                 = fread_sum == view_sum;
+
+        uint64_t start = time_now_ns();
+        for (uint32_t r = 0; r < rounds && ok; ++r) { ok = fread_run(&arena, file_count) == fread_sum; }
+        uint64_t fread_ns = time_now_ns() - start;
+
+        start = time_now_ns();
+        for (uint32_t r = 0; r < rounds && ok; ++r) { ok = view_run(file_count) == view_sum; }
+        uint64_t view_ns = time_now_ns() - start;
+
+        double loads = (double) rounds * file_count;
+        double bytes = (double) rounds * (double) total_size;
+        printf("%u rounds of %u files, %.1f KB average\n", rounds, file_count, (double) total_size / file_count / 1024.0);
+        printf("fopen + fread into an arena: %.2f us/file, %.0f MB/s\n", (double) fread_ns / loads / 1e3, bytes / ((double) fread_ns / 1e9) / 1e6);
+        printf("celfs_view:                  %.2f us/file, %.0f MB/s\n", (double) view_ns / loads / 1e3, bytes / ((double) view_ns / 1e9) / 1e6);
+    }
+    if (!ok) { fprintf(stderr, "celbench_file_view: failed to write or load the files\n"); }
+
+    for (uint32_t i = 0; i < file_count; ++i) { remove(paths[i]); }
+    cel_arena_fini(&arena);
+    return ok ? 0 : 1;
+}
+
+bool files_write(uint32_t file_count, size_t *total_size) {
+    srand(1);
+    LocalPersistent uint32_t words[FILE_BENCH_MAX_SIZE / sizeof(uint32_t)];
+    for (uint32_t i = 0; i < FILE_BENCH_MAX_SIZE / sizeof(uint32_t); ++i) { words[i] = (uint32_t) rand(); }
+
+    for (uint32_t i = 0; i < file_count; ++i)
+    {
+        snprintf(paths[i], sizeof(paths[i]), "celbench_%04u.spv", i);
+        size_t size = FILE_BENCH_MIN_SIZE + (size_t) rand() % (FILE_BENCH_MAX_SIZE - FILE_BENCH_MIN_SIZE + 1);
+        size &= ~(size_t) 3;// spir-v is whole words
+
+        FILE *file = fopen(paths[i], "wb");
+        if (!file) { return false; }
+        bool written = fwrite(words, 1, size, file) == size;
+        written      = fclose(file) == 0 && written;
+        if (!written) { return false; }
+        *total_size += size;
+    }
+    return true;
+}
+
+// stands in for vkCreateShaderModule, which reads every word of the code it is handed
+uint32_t words_sum(const void *data, size_t size) {
+    const uint32_t *words = (const uint32_t *) data;
+    uint32_t sum          = 0;
+    for (size_t i = 0; i < size / sizeof(uint32_t); ++i) { sum += words[i]; }
+    return sum;
+}
+
+uint32_t fread_run(CELarena *arena, uint32_t file_count) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < file_count; ++i)
+    {
+        FILE *file = fopen(paths[i], "rb");
+        if (!file) { return 0; }
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        void *buffer = cel_arena_alloc(arena, (size_t) size);
+        if (buffer && fread(buffer, 1, (size_t) size, file) == (size_t) size) { sum += words_sum(buffer, (size_t) size); }
+        fclose(file);
+    }
+    cel_arena_free_all(arena);
+    return sum;
+}
+
+uint32_t view_run(uint32_t file_count) {
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < file_count; ++i)
+    {
+        CELfile_view view;
+        if (!celfs_view_open(&view, paths[i])) { return 0; }
+        const void *data = celfs_view_map(&view);
+        if (data) { sum += words_sum(data, celfs_view_size(&view)); }
+        celfs_view_unmap(&view);
+    }
+    return sum;
+}
@@ -0,0 +1,89 @@
+#include "cel.h"
+
+#include <stdlib.h>
+
+// celbench_handle_pool [rounds]
+// creates and destroys a million handles, the way a scene churns entities and resources
+
+#define HANDLE_BENCH_COUNT 1000000
+
+GlobalVariable CELhandle_slot slots[HANDLE_BENCH_COUNT];
+GlobalVariable uint32_t idxs[HANDLE_BENCH_COUNT];
+GlobalVariable uint32_t generations[HANDLE_BENCH_COUNT];
+GlobalVariable uint32_t order[HANDLE_BENCH_COUNT];
+
+int main(int argc, char **argv) {
+    uint32_t rounds = argc > 1 ? (uint32_t) atoi(argv[1]) : 20;
+
+    CELhandle_pool hp;
+    handle_pool_init(&hp, slots, HANDLE_BENCH_COUNT);
+
+    // a shuffled destroy order scatters the free list, so later creates hop around the slot array
+    srand(1);
+    for (uint32_t i = 0; i < HANDLE_BENCH_COUNT; ++i) { order[i] = i; }
+    for (uint32_t i = HANDLE_BENCH_COUNT - 1; i > 0; --i)
+    {
+        uint32_t j = (uint32_t) rand() % (i + 1);
+        uint32_t t = order[i];
+        order[i]   = order[j];
+        order[j]   = t;
+    }
+
+    uint64_t alloc_ns = 0;
+    uint64_t valid_ns = 0;
+    uint64_t free_ns  = 0;
+    uint32_t failed   = 0;
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        uint64_t start = time_now_ns();
+        for (uint32_t i = 0; i < HANDLE_BENCH_COUNT; ++i)
+        {
+            failed += !handle_pool_alloc(&hp, &idxs[i], &generations[i]);
+        }
+        alloc_ns += time_now_ns() - start;
+
+        start = time_now_ns();
+        for (uint32_t i = 0; i < HANDLE_BENCH_COUNT; ++i)
+        {
+            uint32_t k = order[i];
+            failed += !handle_pool_valid(&hp, idxs[k], generations[k]);
+        }
+        valid_ns += time_now_ns() - start;
+
+        start = time_now_ns();
+        for (uint32_t i = 0; i < HANDLE_BENCH_COUNT; ++i)
+        {
+            uint32_t k = order[i];
+            failed += !handle_pool_free(&hp, idxs[k], generations[k]);
+        }
+        free_ns += time_now_ns() - start;
+    }
+
+    // a handle freed once must stay dead, however many times its slot is reused
+    for (uint32_t i = 0; i < HANDLE_BENCH_COUNT; ++i)
+    {
+        failed += handle_pool_valid(&hp, idxs[i], generations[i]);
+    }
+
+    // one handle created and destroyed over and over stays in cache, so this is the bookkeeping alone
+    uint64_t start = time_now_ns();
+    for (uint32_t i = 0; i < HANDLE_BENCH_COUNT; ++i)
+    {
+        uint32_t idx, generation;
+        failed += !handle_pool_alloc(&hp, &idx, &generation);
+        failed += !handle_pool_free(&hp, idx, generation);
+    }
+    double churn_ns = (double) (time_now_ns() - start) / HANDLE_BENCH_COUNT;
+
+    double count = (double) rounds * HANDLE_BENCH_COUNT;
+    printf("%u rounds of %d handles, destroyed in shuffled order\n", rounds, HANDLE_BENCH_COUNT);
+    printf("create %.1f ns/op, validate %.1f ns/op, destroy %.1f ns/op\n",
+           (double) alloc_ns / count, (double) valid_ns / count, (double) free_ns / count);
+    printf("single handle create + destroy: %.1f ns/op\n", churn_ns);
+    if (failed)
+    {
+        fprintf(stderr, "celbench_handle_pool: %u handle operations failed\n", failed);
+        return 1;
+    }
+    return 0;
+}
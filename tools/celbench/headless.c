@@ -0,0 +1,50 @@
+#include "headless.h"
+
+// address space only, pages are committed as the arenas grow into it
+#define BENCH_PERSISTENT_STORAGE_SIZE (1024ull * 1024 * 1024)
+#define BENCH_TRANSIENT_STORAGE_SIZE (256ull * 1024 * 1024)
+
+Internal bool bench_game_noop(CELgame *game);
+
+bool bench_game_create(CELgame *game, const char *title, uint32_t frame_count) {
+    game->config.title           = title;
+    game->config.width           = BENCH_RENDER_WIDTH;
+    game->config.height          = BENCH_RENDER_HEIGHT;
+    game->config.render_width    = BENCH_RENDER_WIDTH;
+    game->config.render_height   = BENCH_RENDER_HEIGHT;
+    game->config.headless_frames = frame_count;
+
+    game->game_update  = bench_game_noop;
+    game->game_destroy = bench_game_noop;
+
+    if (!cel_arena_init_virtual(&game->state.persistent_arena, BENCH_PERSISTENT_STORAGE_SIZE, 0)) { return false; }
+    if (!cel_arena_init_virtual(&game->state.transient_arena, BENCH_TRANSIENT_STORAGE_SIZE, 0)) { return false; }
+
+    return true;
+}
+
+CELimage_handle bench_render_target_create(VkFormat format) {
+    return celvk_image_create(
+        &(CELvk_image_create_info){
+            .usages            = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+            .format            = format,
+            .base_array_layers = 1,
+            .extent            = (VkExtent3D){.width = BENCH_RENDER_WIDTH, .height = BENCH_RENDER_HEIGHT, 1}},
+        &(VmaAllocationCreateInfo){
+            .usage         = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+            .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
+}
+
+int bench_game_run(CELgame *game) {
+    if (!game->game_init || !game->game_draw) { return -2; }
+
+    if (!application_init(game)) { return 1; }
+    if (!application_run()) { return 2; }
+
+    return 0;
+}
+
+bool bench_game_noop(CELgame *game) {
+    (void) game;
+    return true;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cel.h>
+#include <cel_vulkan.h>
+
+// the gpu benchmarks drive the engine in headless mode, so they run without a display (lavapipe included).
+// like the example they find the engine resources from the build's output directory, so start them there
+
+#define BENCH_RENDER_WIDTH 1280
+#define BENCH_RENDER_HEIGHT 720
+
+bool bench_game_create(CELgame *game, const char *title, uint32_t frame_count);
+CELimage_handle bench_render_target_create(VkFormat format);
+int bench_game_run(CELgame *game);
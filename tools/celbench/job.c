@@ -0,0 +1,93 @@
+#include "cel.h"
+
+#include <stdlib.h>
+
+// celbench_job [worker_count] [trials]
+// what a job costs to hand off: spawn throughput, and how long a spawned job waits before a worker steals it
+
+#define JOB_BENCH_BATCH_COUNT 1000// stays under the deque capacity so no spawn falls back to running inline
+#define JOB_BENCH_MAX_TRIAL_COUNT 100000
+
+typedef struct CELbench_stamp CELbench_stamp;
+struct CELbench_stamp {
+    volatile int64_t started_ns;
+};
+
+GlobalVariable uint64_t latencies[JOB_BENCH_MAX_TRIAL_COUNT];
+
+Internal void empty_job(void *data);
+Internal void stamp_job(void *data);
+Internal uint64_t steal_latency_run(uint32_t trials, uint32_t idle_ms);
+Internal int latency_compare(const void *a, const void *b);
+
+int main(int argc, char **argv) {
+    uint32_t worker_count = argc > 1 ? (uint32_t) atoi(argv[1]) : 0;
+    uint32_t trials       = argc > 2 ? (uint32_t) atoi(argv[2]) : 10000;
+    if (trials == 0) { trials = 1; }
+    if (trials > JOB_BENCH_MAX_TRIAL_COUNT) { trials = JOB_BENCH_MAX_TRIAL_COUNT; }
+
+    job_system_init(worker_count);
+    if (job_thread_count() < 2)
+    {
+        fprintf(stderr, "celbench_job: needs at least one worker thread to steal\n");
+        job_system_fini();
+        return 1;
+    }
+    printf("%u threads, %u trials\n", job_thread_count(), trials);
+
+    // the spawning thread helps in job_wait, so the batch is split between its own takes and the workers' steals
+    uint64_t start = time_now_ns();
+    for (uint32_t t = 0; t < trials; ++t)
+    {
+        CELjob_counter counter = {0};
+        for (uint32_t i = 0; i < JOB_BENCH_BATCH_COUNT; ++i)
+        {
+            job_run(empty_job, NULL, &counter);
+        }
+        job_wait(&counter);
+    }
+    double spawn_ns = (double) (time_now_ns() - start) / ((double) trials * JOB_BENCH_BATCH_COUNT);
+    printf("spawn + run + wait, batches of %d empty jobs: %.1f ns/job\n", JOB_BENCH_BATCH_COUNT, spawn_ns);
+
+    // back to back the workers are still spinning, after an idle millisecond they have gone to sleep
+    uint32_t idle_trials = trials < 1000 ? trials : 1000;
+    printf("spawn to steal, workers spinning: %.0f ns median\n", (double) steal_latency_run(trials, 0));
+    printf("spawn to steal, workers asleep:   %.0f ns median\n", (double) steal_latency_run(idle_trials, 1));
+
+    job_system_fini();
+    return 0;
+}
+
+void empty_job(void *data) {
+    (void) data;
+}
+
+void stamp_job(void *data) {
+    CELbench_stamp *stamp = (CELbench_stamp *) data;
+    cel_atomic_store_i64(&stamp->started_ns, (int64_t) time_now_ns());
+}
+
+uint64_t steal_latency_run(uint32_t trials, uint32_t idle_ms) {
+    for (uint32_t t = 0; t < trials; ++t)
+    {
+        if (idle_ms) { thread_sleep_ms(idle_ms); }
+
+        // spin on the counter instead of job_wait, so the spawning thread never takes the job back itself
+        CELbench_stamp stamp   = {0};
+        CELjob_counter counter = {0};
+        uint64_t spawned_ns    = time_now_ns();
+        job_run(stamp_job, &stamp, &counter);
+        while (cel_atomic_load_i32(&counter.pending) > 0) { cel_cpu_pause(); }
+
+        latencies[t] = (uint64_t) cel_atomic_load_i64(&stamp.started_ns) - spawned_ns;
+    }
+
+    qsort(latencies, trials, sizeof(latencies[0]), latency_compare);
+    return latencies[trials / 2];
+}
+
+int latency_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *) a;
+    uint64_t y = *(const uint64_t *) b;
+    return (x > y) - (x < y);
+}
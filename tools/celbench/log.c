@@ -0,0 +1,71 @@
+#include "cel.h"
+#include "cel_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// celbench_log [text|binary] [message_count]
+// what a CEL_INFO costs the thread that calls it: filtered out, written in place, and queued for the writer thread
+
+#define LOG_BENCH_BURST_COUNT 2048// half the async ring, so a burst never drops
+
+Internal double sync_run(uint32_t count);
+Internal double async_run(uint32_t count);
+
+int main(int argc, char **argv) {
+    bool binary    = argc > 1 && strcmp(argv[1], "binary") == 0;
+    uint32_t count = argc > 2 ? (uint32_t) atoi(argv[2]) : 200000;
+    if (count < LOG_BENCH_BURST_COUNT) { count = LOG_BENCH_BURST_COUNT; }
+
+    // with stderr quiet and no sink yet every call is below the threshold, after that the only sink is a temporary file
+    log_set_quite(true);
+    double filtered_ns = sync_run(count);
+
+    FILE *file = tmpfile();
+    if (!file || (binary ? log_add_binary(file, LOG_INFO) : log_add_fp(file, LOG_INFO)) != 0)
+    {
+        fprintf(stderr, "celbench_log: failed to open the log sink\n");
+        return 1;
+    }
+
+    double sync_ns  = sync_run(count);
+    double async_ns = async_run(count);
+
+    printf("%u messages to a %s file sink\n", count, binary ? "binary" : "text");
+    printf("filtered:           %.1f ns/call\n", filtered_ns);
+    printf("sync:               %.1f ns/call\n", sync_ns);
+    printf("async, caller side: %.1f ns/call, %llu dropped\n", async_ns, (unsigned long long) log_dropped_count());
+
+    fclose(file);
+    return 0;
+}
+
+double sync_run(uint32_t count) {
+    uint64_t start = time_now_ns();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        CEL_INFO("frame %u: %d draws, %s pass in %.2f ms", i, 128, "opaque", 1.25);
+    }
+    return (double) (time_now_ns() - start) / count;
+}
+
+double async_run(uint32_t count) {
+    // switching async off joins the writer once it drained the ring, so each timed burst starts on an empty ring
+    uint64_t elapsed = 0;
+    uint32_t logged  = 0;
+    while (logged + LOG_BENCH_BURST_COUNT <= count)
+    {
+        if (!log_set_async(true)) { return 0.0; }
+
+        uint64_t start = time_now_ns();
+        for (uint32_t i = 0; i < LOG_BENCH_BURST_COUNT; ++i)
+        {
+            CEL_INFO("frame %u: %d draws, %s pass in %.2f ms", logged + i, 128, "opaque", 1.25);
+        }
+        elapsed += time_now_ns() - start;
+
+        log_set_async(false);
+        logged += LOG_BENCH_BURST_COUNT;
+    }
+    return (double) elapsed / logged;
+}
@@ -0,0 +1,129 @@
+#include "headless.h"
+
+#include <stdlib.h>
+
+// celbench_record [worker_count] [batch_count] [frames_per_step]
+// how sprite recording scales with the threads recording it: the same frame is split into 1, 2, 4, ... slices,
+// each recorded into a secondary by whichever job thread picks it up, up to one slice per job thread
+
+#define RECORD_BENCH_MAX_BATCH_COUNT 4096// the renderer's sprite batch limit
+#define RECORD_BENCH_BATCH_SPRITE_COUNT 16
+#define RECORD_BENCH_MAX_STEP_COUNT 8
+#define RECORD_BENCH_WARMUP_FRAMES 10// per step
+
+typedef struct CELbench_record CELbench_record;
+struct CELbench_record {
+    CELimage_handle target;
+    CELprogram_handle renderers[2];// alternated per batch, so no two neighbours merge into one draw
+    CELsprite *sprites;
+    uint32_t batch_count;
+    VkCommandBuffer secondaries[CEL_MAX_JOB_THREAD_COUNT];
+    uint32_t grain;
+
+    uint32_t slice_counts[RECORD_BENCH_MAX_STEP_COUNT];
+    uint64_t record_ns[RECORD_BENCH_MAX_STEP_COUNT];
+    uint32_t step_count;
+    uint32_t step_frames;
+    uint32_t frame;
+};
+
+GlobalVariable CELbench_record bench = {0};
+
+Internal bool record_init(CELgame *game);
+Internal bool record_draw(CELgame *game);
+Internal void record_range(uint32_t begin, uint32_t end, uint32_t thread_index, void *data);
+
+int main(int argc, char **argv) {
+    uint32_t worker_count = argc > 1 ? (uint32_t) atoi(argv[1]) : 0;
+    bench.batch_count     = argc > 2 ? (uint32_t) atoi(argv[2]) : 4000;
+    bench.step_frames     = argc > 3 ? (uint32_t) atoi(argv[3]) : 200;
+    if (bench.batch_count == 0) { bench.batch_count = 1; }
+    if (bench.batch_count > RECORD_BENCH_MAX_BATCH_COUNT) { bench.batch_count = RECORD_BENCH_MAX_BATCH_COUNT; }
+    if (bench.step_frames <= RECORD_BENCH_WARMUP_FRAMES) { bench.step_frames = RECORD_BENCH_WARMUP_FRAMES + 1; }
+
+    // the same count job_system_init will settle on
+    if (worker_count == 0)
+    {
+        uint32_t core_count = cpu_core_count();
+        worker_count        = core_count > 1 ? core_count - 1 : 0;
+    }
+    if (worker_count > CEL_MAX_JOB_THREAD_COUNT - 1) { worker_count = CEL_MAX_JOB_THREAD_COUNT - 1; }
+
+    uint32_t thread_count = worker_count + 1;
+    for (uint32_t slice_count = 1; slice_count < thread_count; slice_count *= 2)
+    {
+        bench.slice_counts[bench.step_count++] = slice_count;
+    }
+    bench.slice_counts[bench.step_count++] = thread_count;
+
+    CELgame game = {0};
+    if (!bench_game_create(&game, "celbench_record", bench.step_count * bench.step_frames)) { return -1; }
+    game.config.worker_count = worker_count;
+    game.game_init           = record_init;
+    game.game_draw           = record_draw;
+
+    return bench_game_run(&game);
+}
+
+bool record_init(CELgame *game) {
+    bench.target       = bench_render_target_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+    bench.renderers[0] = celvk_sprite_renderer_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+    bench.renderers[1] = celvk_sprite_renderer_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+
+    uint32_t sprite_count = bench.batch_count * RECORD_BENCH_BATCH_SPRITE_COUNT;
+    bench.sprites         = cel_arena_alloc(&game->state.persistent_arena, sizeof(CELsprite) * sprite_count);
+    if (!bench.sprites) { return false; }
+
+    srand(1);
+    for (uint32_t i = 0; i < sprite_count; ++i)
+    {
+        bench.sprites[i] = (CELsprite){
+            .position = {(float) (rand() % BENCH_RENDER_WIDTH), (float) (rand() % BENCH_RENDER_HEIGHT)},
+            .size     = {8.0f, 8.0f},
+            .uv       = {0.0f, 0.0f, 1.0f, 1.0f},
+            .color    = {1.0f, 1.0f, 1.0f, 1.0f},
+        };
+    }
+    return true;
+}
+
+bool record_draw(CELgame *game) {
+    uint32_t step        = bench.frame / bench.step_frames;
+    uint32_t slice_count = bench.slice_counts[step];
+
+    VkCommandBuffer cmd = celvk_begin_draw();
+    for (uint32_t i = 0; i < bench.batch_count; ++i)
+    {
+        celvk_draw_sprites(&bench.renderers[i & 1], NULL, &bench.sprites[i * RECORD_BENCH_BATCH_SPRITE_COUNT], RECORD_BENCH_BATCH_SPRITE_COUNT);
+    }
+
+    // only the recording is timed, submitting the sprites and executing the secondaries are the same for every step
+    uint32_t sprite_count = celvk_sprite_count();
+    bench.grain           = (sprite_count + slice_count - 1) / slice_count;
+    slice_count           = (sprite_count + bench.grain - 1) / bench.grain;
+
+    uint64_t start_ns = time_now_ns();
+    job_parallel_for(sprite_count, bench.grain, record_range, NULL);
+    if (bench.frame % bench.step_frames >= RECORD_BENCH_WARMUP_FRAMES) { bench.record_ns[step] += time_now_ns() - start_ns; }
+
+    celvk_draw_secondaries(cmd, &bench.target, (CELrgba){0.0f, 0.0f, 0.0f, 1.0f}, bench.secondaries, slice_count);
+    celvk_end_draw(cmd, bench.target);
+
+    if (++bench.frame < game->config.headless_frames) { return true; }
+
+    uint32_t timed_frames = bench.step_frames - RECORD_BENCH_WARMUP_FRAMES;
+    double serial_ms      = (double) bench.record_ns[0] / 1e6 / timed_frames;
+    printf("%u batches of %d sprites on %u job threads, %u frames per step\n", bench.batch_count, RECORD_BENCH_BATCH_SPRITE_COUNT,
+           job_thread_count(), timed_frames);
+    for (uint32_t i = 0; i < bench.step_count; ++i)
+    {
+        double record_ms = (double) bench.record_ns[i] / 1e6 / timed_frames;
+        printf("%2u record threads: %.3f ms/frame, %.2fx\n", bench.slice_counts[i], record_ms, serial_ms / record_ms);
+    }
+    return true;
+}
+
+void record_range(uint32_t begin, uint32_t end, uint32_t thread_index, void *data) {
+    (void) data;
+    bench.secondaries[begin / bench.grain] = celvk_record_sprites(thread_index, &bench.target, begin, end - begin);
+}
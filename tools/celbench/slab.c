@@ -0,0 +1,95 @@
+#include "cel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// celbench_slab [rounds]
+// slab against glibc malloc, with and without the memset that matches the slab zeroing what it hands out
+
+#define SLAB_BENCH_LIVE_COUNT 200000
+#define SLAB_BENCH_CHURN_COUNT 10000000
+#define SLAB_BENCH_RESERVE_SIZE (4ull * 1024 * 1024 * 1024)
+
+GlobalVariable void *ptrs[SLAB_BENCH_LIVE_COUNT];
+GlobalVariable size_t sizes[SLAB_BENCH_LIVE_COUNT];
+
+Internal void sizes_fill(size_t min, size_t max);
+Internal double slab_run(CELslab *s, uint32_t rounds);
+Internal double malloc_run(uint32_t rounds, bool zero);
+
+int main(int argc, char **argv) {
+    uint32_t rounds = argc > 1 ? (uint32_t) atoi(argv[1]) : 20;
+
+    CELarena backing;
+    if (!cel_arena_init_virtual(&backing, SLAB_BENCH_RESERVE_SIZE, 0))
+    {
+        fprintf(stderr, "celbench_slab: failed to reserve the backing arena\n");
+        return 1;
+    }
+    CELslab s;
+    slab_init(&s, &backing);
+
+    srand(1);
+    printf("%u rounds of %d live blocks, allocated in order and freed in reverse\n", rounds, SLAB_BENCH_LIVE_COUNT);
+
+    sizes_fill(16, 4096);
+    printf("16-4096 bytes: slab %.1f ns/op, malloc + memset %.1f ns/op, malloc %.1f ns/op\n",
+           slab_run(&s, rounds), malloc_run(rounds, true), malloc_run(rounds, false));
+
+    sizes_fill(16, 128);
+    printf("16-128 bytes:  slab %.1f ns/op, malloc + memset %.1f ns/op, malloc %.1f ns/op\n",
+           slab_run(&s, rounds), malloc_run(rounds, true), malloc_run(rounds, false));
+
+    // one object alone in its class empties its page on every free, so this is the page recycling path
+    uint64_t start = time_now_ns();
+    for (uint32_t i = 0; i < SLAB_BENCH_CHURN_COUNT; ++i)
+    {
+        slab_free(&s, slab_alloc(&s, 16));
+    }
+    double churn_ns = (double) (time_now_ns() - start) / SLAB_BENCH_CHURN_COUNT;
+    printf("single 16 byte object alloc + free: %.1f ns/op\n", churn_ns);
+
+    slab_debug_print(&s, "celbench");
+    cel_arena_fini(&backing);
+    return 0;
+}
+
+void sizes_fill(size_t min, size_t max) {
+    for (uint32_t i = 0; i < SLAB_BENCH_LIVE_COUNT; ++i)
+    {
+        sizes[i] = min + (size_t) rand() % (max - min + 1);
+    }
+}
+
+double slab_run(CELslab *s, uint32_t rounds) {
+    uint64_t start = time_now_ns();
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        for (uint32_t i = 0; i < SLAB_BENCH_LIVE_COUNT; ++i)
+        {
+            ptrs[i] = slab_alloc(s, sizes[i]);
+        }
+        for (uint32_t i = SLAB_BENCH_LIVE_COUNT; i > 0; --i)
+        {
+            slab_free(s, ptrs[i - 1]);
+        }
+    }
+    return (double) (time_now_ns() - start) / ((double) rounds * SLAB_BENCH_LIVE_COUNT);
+}
+
+double malloc_run(uint32_t rounds, bool zero) {
+    uint64_t start = time_now_ns();
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        for (uint32_t i = 0; i < SLAB_BENCH_LIVE_COUNT; ++i)
+        {
+            ptrs[i] = malloc(sizes[i]);
+            if (zero && ptrs[i]) { memset(ptrs[i], 0, sizes[i]); }
+        }
+        for (uint32_t i = SLAB_BENCH_LIVE_COUNT; i > 0; --i)
+        {
+            free(ptrs[i - 1]);
+        }
+    }
+    return (double) (time_now_ns() - start) / ((double) rounds * SLAB_BENCH_LIVE_COUNT);
+}
@@ -0,0 +1,81 @@
+#include "headless.h"
+
+#include <stdlib.h>
+
+// celbench_sprites [sprite_count] [frames]
+// headless sprite throughput: the whole set goes through one celvk_draw_sprites, so the batched path draws it instanced
+
+#define SPRITE_BENCH_MAX_COUNT 250000// 64 byte sprites, about what the renderer's 16 MB frame ring holds
+#define SPRITE_BENCH_WARMUP_FRAMES 10
+
+typedef struct CELbench_sprites CELbench_sprites;
+struct CELbench_sprites {
+    CELimage_handle target;
+    CELprogram_handle renderer;
+    CELsprite *sprites;
+    uint32_t sprite_count;
+    uint32_t frame;
+    uint64_t start_ns;
+};
+
+GlobalVariable CELbench_sprites bench = {0};
+
+Internal bool sprites_init(CELgame *game);
+Internal bool sprites_draw(CELgame *game);
+
+int main(int argc, char **argv) {
+    uint32_t sprite_count = argc > 1 ? (uint32_t) atoi(argv[1]) : 100000;
+    uint32_t frame_count  = argc > 2 ? (uint32_t) atoi(argv[2]) : 500;
+    if (sprite_count == 0) { sprite_count = 1; }
+    if (sprite_count > SPRITE_BENCH_MAX_COUNT) { sprite_count = SPRITE_BENCH_MAX_COUNT; }
+    if (frame_count <= SPRITE_BENCH_WARMUP_FRAMES) { frame_count = SPRITE_BENCH_WARMUP_FRAMES + 1; }
+
+    CELgame game = {0};
+    if (!bench_game_create(&game, "celbench_sprites", frame_count)) { return -1; }
+    game.game_init     = sprites_init;
+    game.game_draw     = sprites_draw;
+    bench.sprite_count = sprite_count;
+
+    return bench_game_run(&game);
+}
+
+bool sprites_init(CELgame *game) {
+    bench.target   = bench_render_target_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+    bench.renderer = celvk_sprite_renderer_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+    bench.sprites  = cel_arena_alloc(&game->state.persistent_arena, sizeof(CELsprite) * bench.sprite_count);
+    if (!bench.sprites) { return false; }
+
+    // small sprites scattered over the target, so the vertex and instance work dominates rather than fill
+    srand(1);
+    for (uint32_t i = 0; i < bench.sprite_count; ++i)
+    {
+        bench.sprites[i] = (CELsprite){
+            .position = {(float) (rand() % BENCH_RENDER_WIDTH), (float) (rand() % BENCH_RENDER_HEIGHT)},
+            .size     = {4.0f, 4.0f},
+            .uv       = {0.0f, 0.0f, 1.0f, 1.0f},
+            .color    = {(float) (i & 255) / 255.0f, 0.5f, 1.0f, 1.0f},
+            .rotation = (float) (i % 628) / 100.0f,
+        };
+    }
+    return true;
+}
+
+bool sprites_draw(CELgame *game) {
+    if (bench.frame == SPRITE_BENCH_WARMUP_FRAMES) { bench.start_ns = time_now_ns(); }
+
+    VkCommandBuffer cmd = celvk_begin_draw();
+    celvk_draw_sprites(&bench.renderer, NULL, bench.sprites, bench.sprite_count);
+    celvk_draw(cmd, &bench.target, (CELrgba){0.0f, 0.0f, 0.0f, 1.0f});
+    celvk_end_draw(cmd, bench.target);
+
+    if (++bench.frame == game->config.headless_frames)
+    {
+        // the last frames may still be on the gpu, the time has to cover them too
+        celvk_frame_wait(celvk_frame_index() - 1);
+        uint32_t timed_frames = bench.frame - SPRITE_BENCH_WARMUP_FRAMES;
+        double elapsed_s      = (double) (time_now_ns() - bench.start_ns) / 1e9;
+        printf("%u sprites, %u frames: %.3f ms/frame, %.2f M sprites/s\n", bench.sprite_count, timed_frames,
+               elapsed_s * 1e3 / timed_frames, (double) bench.sprite_count * timed_frames / elapsed_s / 1e6);
+    }
+    return true;
+}
@@ -0,0 +1,92 @@
+#include "headless.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// celbench_startup [--cold]
+// time from main to the first retired frame, with a set of distinct pipelines built during init.
+// --cold deletes the engine's pipeline cache first, a plain run then starts warm from the cache that one saved.
+// drivers keep their own shader cache too, on mesa set MESA_SHADER_CACHE_DISABLE=true to leave only the engine's
+
+#define STARTUP_BENCH_PIPELINE_CACHE_FILE "pipeline_cache.bin"// CELVK_PIPELINE_CACHE_FILE, under the user path
+
+typedef struct CELbench_startup CELbench_startup;
+struct CELbench_startup {
+    CELimage_handle target;
+    uint64_t main_ns;
+    uint64_t init_ns;
+    uint64_t programs_ns;
+    uint64_t first_frame_ns;
+};
+
+GlobalVariable CELbench_startup bench = {0};
+
+// one sprite program per color format, every one of them a separate pipeline
+GlobalVariable const VkFormat program_formats[] = {
+    VK_FORMAT_R8G8B8A8_UNORM,
+    VK_FORMAT_R8G8B8A8_SRGB,
+    VK_FORMAT_B8G8R8A8_UNORM,
+    VK_FORMAT_B8G8R8A8_SRGB,
+    VK_FORMAT_A2B10G10R10_UNORM_PACK32,
+    VK_FORMAT_R16G16B16A16_UNORM,
+    VK_FORMAT_R16G16B16A16_SFLOAT,
+    VK_FORMAT_R32G32B32A32_SFLOAT,
+};
+
+Internal bool startup_init(CELgame *game);
+Internal bool startup_draw(CELgame *game);
+
+int main(int argc, char **argv) {
+    bench.main_ns = time_now_ns();
+    bool cold     = argc > 1 && strcmp(argv[1], "--cold") == 0;
+
+    if (cold)
+    {
+        // application_init puts the user path at <cwd>/../../<base_path>, and the bench leaves base_path empty
+        char cwd[FS_PATH_MAX];
+        char cache_path[FS_PATH_MAX];
+        celfs_get_current_dir(cwd, sizeof(cwd));
+        snprintf(cache_path, sizeof(cache_path), "%s%c..%c..%c%c%s", cwd, FS_PATH_SEP, FS_PATH_SEP, FS_PATH_SEP, FS_PATH_SEP, STARTUP_BENCH_PIPELINE_CACHE_FILE);
+        remove(cache_path);
+    }
+
+    CELgame game = {0};
+    if (!bench_game_create(&game, "celbench_startup", 1)) { return -1; }
+    game.game_init = startup_init;
+    game.game_draw = startup_draw;
+
+    if (!application_init(&game)) { return 1; }
+    bench.init_ns = time_now_ns();
+    if (!application_run()) { return 2; }
+
+    printf("%s start, %u pipelines\n", cold ? "cold" : "warm", (uint32_t) (sizeof(program_formats) / sizeof(program_formats[0])));
+    printf("init:        %.2f ms, of which pipelines %.2f ms\n", (double) (bench.init_ns - bench.main_ns) / 1e6, (double) bench.programs_ns / 1e6);
+    printf("first frame: %.2f ms after main\n", (double) (bench.first_frame_ns - bench.main_ns) / 1e6);
+    return 0;
+}
+
+bool startup_init(CELgame *game) {
+    (void) game;
+    bench.target = bench_render_target_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+
+    uint64_t start_ns = time_now_ns();
+    for (uint32_t i = 0; i < sizeof(program_formats) / sizeof(program_formats[0]); ++i)
+    {
+        CELprogram_handle program = celvk_sprite_renderer_create(program_formats[i]);
+        if (!celvk_program_valid(&program)) { return false; }
+    }
+    bench.programs_ns = time_now_ns() - start_ns;
+    return true;
+}
+
+bool startup_draw(CELgame *game) {
+    (void) game;
+    VkCommandBuffer cmd = celvk_begin_draw();
+    celvk_draw(cmd, &bench.target, (CELrgba){0.0f, 0.0f, 0.0f, 1.0f});
+    celvk_end_draw(cmd, bench.target);
+
+    celvk_frame_wait(celvk_frame_index() - 1);
+    bench.first_frame_ns = time_now_ns();
+    return true;
+}
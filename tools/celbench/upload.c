@@ -0,0 +1,123 @@
+#include "headless.h"
+
+#include <stdlib.h>
+
+// celbench_upload [total_mb] [frames]
+// streams an atlas set through the transfer queue while frames keep rendering, then reports the upload rate
+// and the slowest frame seen while it loaded, which is the hitch the upload path is meant to remove
+
+#define UPLOAD_BENCH_ATLAS_SIZE 2048
+#define UPLOAD_BENCH_ATLAS_BYTES ((VkDeviceSize) UPLOAD_BENCH_ATLAS_SIZE * UPLOAD_BENCH_ATLAS_SIZE * 4)// rgba8, 16 MB
+#define UPLOAD_BENCH_MAX_ATLAS_COUNT 64
+
+typedef struct CELbench_upload CELbench_upload;
+struct CELbench_upload {
+    CELimage_handle target;
+    CELimage_handle atlases[UPLOAD_BENCH_MAX_ATLAS_COUNT];
+    uint64_t tickets[UPLOAD_BENCH_MAX_ATLAS_COUNT];
+    uint32_t atlas_count;
+    uint32_t staged_count;// atlases handed to celvk_upload_image, the rest wait for room in the staging ring
+    uint32_t *pixels;
+
+    uint32_t frame;
+    uint64_t start_ns;
+    uint64_t done_ns;
+    uint64_t last_frame_ns;
+    uint64_t worst_frame_ns;
+};
+
+GlobalVariable CELbench_upload bench = {0};
+
+Internal bool upload_init(CELgame *game);
+Internal bool upload_draw(CELgame *game);
+Internal bool upload_done();
+
+int main(int argc, char **argv) {
+    uint32_t total_mb    = argc > 1 ? (uint32_t) atoi(argv[1]) : 200;
+    uint32_t frame_count = argc > 2 ? (uint32_t) atoi(argv[2]) : 1000;
+    if (frame_count == 0) { frame_count = 1; }
+
+    uint32_t atlas_mb = (uint32_t) (UPLOAD_BENCH_ATLAS_BYTES / (1024 * 1024));
+    bench.atlas_count = (total_mb + atlas_mb - 1) / atlas_mb;
+    if (bench.atlas_count == 0) { bench.atlas_count = 1; }
+    if (bench.atlas_count > UPLOAD_BENCH_MAX_ATLAS_COUNT) { bench.atlas_count = UPLOAD_BENCH_MAX_ATLAS_COUNT; }
+
+    CELgame game = {0};
+    if (!bench_game_create(&game, "celbench_upload", frame_count)) { return -1; }
+    game.game_init = upload_init;
+    game.game_draw = upload_draw;
+
+    return bench_game_run(&game);
+}
+
+bool upload_init(CELgame *game) {
+    bench.target = bench_render_target_create(VK_FORMAT_R16G16B16A16_SFLOAT);
+    for (uint32_t i = 0; i < bench.atlas_count; ++i)
+    {
+        bench.atlases[i] = celvk_image_create(
+            &(CELvk_image_create_info){
+                .usages            = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                .format            = VK_FORMAT_R8G8B8A8_UNORM,
+                .base_array_layers = 1,
+                .extent            = (VkExtent3D){.width = UPLOAD_BENCH_ATLAS_SIZE, .height = UPLOAD_BENCH_ATLAS_SIZE, 1}},
+            &(VmaAllocationCreateInfo){
+                .usage         = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE,
+                .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT});
+    }
+
+    // every atlas is uploaded from the same pixels, the copy into the staging ring is what costs
+    bench.pixels = cel_arena_alloc(&game->state.persistent_arena, UPLOAD_BENCH_ATLAS_BYTES);
+    if (!bench.pixels) { return false; }
+    for (uint32_t i = 0; i < UPLOAD_BENCH_ATLAS_BYTES / sizeof(uint32_t); ++i) { bench.pixels[i] = i * 2654435761u; }
+
+    return true;
+}
+
+bool upload_draw(CELgame *game) {
+    uint64_t now_ns = time_now_ns();
+    if (bench.frame == 0) { bench.start_ns = now_ns; }
+    else if (!bench.done_ns && now_ns - bench.last_frame_ns > bench.worst_frame_ns) { bench.worst_frame_ns = now_ns - bench.last_frame_ns; }
+    bench.last_frame_ns = now_ns;
+
+    // uploads staged here are submitted by the next celvk_begin_draw
+    VkCommandBuffer cmd = celvk_begin_draw();
+    while (bench.staged_count < bench.atlas_count)
+    {
+        uint64_t ticket = celvk_upload_image(&bench.atlases[bench.staged_count], bench.pixels, UPLOAD_BENCH_ATLAS_BYTES);
+        if (!ticket) { break; }
+        bench.tickets[bench.staged_count++] = ticket;
+    }
+    if (!bench.done_ns && upload_done()) { bench.done_ns = time_now_ns(); }
+
+    celvk_draw(cmd, &bench.target, (CELrgba){0.0f, 0.0f, 0.0f, 1.0f});
+    celvk_end_draw(cmd, bench.target);
+
+    if (++bench.frame < game->config.headless_frames) { return true; }
+
+    if (bench.staged_count < bench.atlas_count)
+    {
+        printf("only %u of %u atlases were staged in %u frames, raise the frame count\n", bench.staged_count, bench.atlas_count, bench.frame);
+        return true;
+    }
+
+    // the tail of the set may still be copying once the frames ran out
+    celvk_upload_flush();
+    while (!bench.done_ns)
+    {
+        if (upload_done()) { bench.done_ns = time_now_ns(); }
+        else { thread_yield(); }
+    }
+    celvk_frame_wait(celvk_frame_index() - 1);
+
+    double mb         = (double) bench.atlas_count * UPLOAD_BENCH_ATLAS_BYTES / (1024.0 * 1024.0);
+    double elapsed_ms = (double) (bench.done_ns - bench.start_ns) / 1e6;
+    printf("%u atlases of %ux%u rgba8 (%.0f MB) in %.2f ms: %.1f MB/s\n", bench.atlas_count, UPLOAD_BENCH_ATLAS_SIZE, UPLOAD_BENCH_ATLAS_SIZE,
+           mb, elapsed_ms, mb / (elapsed_ms / 1e3));
+    printf("slowest frame while loading: %.3f ms\n", (double) bench.worst_frame_ns / 1e6);
+    return true;
+}
+
+// timeline values only grow, so once the last ticket completed every earlier one has too
+bool upload_done() {
+    return bench.staged_count == bench.atlas_count && celvk_upload_complete(bench.tickets[bench.atlas_count - 1]);
+}
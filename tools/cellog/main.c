@@ -0,0 +1,160 @@
+#include "cel_log.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CELLOG_MESSAGE_SIZE 4096
+
+// cellog <input.clog>
+// turns a log written by log_add_binary back into the text log_add_fp would have written
+
+typedef struct CELlog_site CELlog_site;
+struct CELlog_site {
+    char *file;
+    char *fmt;
+    uint32_t line;
+};
+
+typedef struct CELlog_site_table CELlog_site_table;
+struct CELlog_site_table {
+    CELlog_site *sites;
+    uint32_t capacity;
+};
+
+Internal bool leb128_get(FILE *in, uint64_t *value);
+Internal char *string_get(FILE *in);
+Internal bool site_set(CELlog_site_table *table, uint32_t id, CELlog_site site);
+
+int main(int argc, char **argv) {
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: cellog <input.clog>\n");
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (!in)
+    {
+        fprintf(stderr, "cellog: failed to open %s\n", argv[1]);
+        return 1;
+    }
+
+    CELlog_binary_header header;
+    if (fread(&header, sizeof(header), 1, in) != 1 || header.magic != CEL_LOG_BINARY_MAGIC || header.version != CEL_LOG_BINARY_VERSION)
+    {
+        fprintf(stderr, "cellog: %s is not a binary log\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    CELlog_site_table table = {0};
+    uint64_t timestamp_ns   = header.clock_base_ns;
+    uint64_t message_count  = 0;
+    bool ok                 = true;
+
+    int tag;
+    while (ok && (tag = fgetc(in)) != EOF)
+    {
+        if (tag == CEL_LOG_BINARY_SITE)
+        {
+            uint64_t id;
+            uint64_t line;
+            CELlog_site site = {0};
+            ok               = leb128_get(in, &id) && leb128_get(in, &line) && (site.file = string_get(in)) && (site.fmt = string_get(in));
+            site.line        = (uint32_t) line;
+            ok               = ok && site_set(&table, (uint32_t) id, site);
+            continue;
+        }
+
+        if ((tag & 0x0f) != CEL_LOG_BINARY_MESSAGE)
+        {
+            ok = false;
+            break;
+        }
+
+        uint64_t id;
+        uint64_t zigzag;
+        uint64_t args_size;
+        unsigned char args[CELLOG_MESSAGE_SIZE];
+        ok = leb128_get(in, &id) && leb128_get(in, &zigzag) && leb128_get(in, &args_size) &&
+             args_size <= sizeof(args) && fread(args, 1, (size_t) args_size, in) == args_size &&
+             id < table.capacity && table.sites[id].fmt;
+        if (!ok) { break; }
+
+        timestamp_ns += (uint64_t) ((int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1));
+        const CELlog_site *site = &table.sites[id];
+
+        char message[CELLOG_MESSAGE_SIZE];
+        log_args_format(message, sizeof(message), site->fmt, args, (size_t) args_size);
+
+        uint64_t elapsed_ns = timestamp_ns - header.clock_base_ns;
+        time_t t            = (time_t) header.wall_base + (time_t) (elapsed_ns / 1000000000ull);
+        struct tm time_info;
+#if defined(_WIN32)
+        localtime_s(&time_info, &t);
+#else
+        localtime_r(&t, &time_info);
+#endif
+        char time_buffer[64];
+        strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &time_info);
+
+        printf("%s.%03u %-5s %s:%u: %s\n", time_buffer, (unsigned) (elapsed_ns / 1000000ull % 1000), log_level_string(tag >> 4), site->file, site->line, message);
+        ++message_count;
+    }
+
+    fclose(in);
+    if (!ok)
+    {
+        fprintf(stderr, "cellog: %s is truncated or corrupt after %llu messages\n", argv[1], (unsigned long long) message_count);
+        return 1;
+    }
+    return 0;
+}
+
+bool leb128_get(FILE *in, uint64_t *value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        int byte = fgetc(in);
+        if (byte == EOF) { return false; }
+
+        *value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) { return true; }
+    }
+    return false;
+}
+
+char *string_get(FILE *in) {
+    uint64_t length;
+    if (!leb128_get(in, &length) || length > CELLOG_MESSAGE_SIZE) { return NULL; }
+
+    char *string = malloc((size_t) length + 1);
+    if (!string) { return NULL; }
+    if (fread(string, 1, (size_t) length, in) != length)
+    {
+        free(string);
+        return NULL;
+    }
+    string[length] = '\0';
+    return string;
+}
+
+bool site_set(CELlog_site_table *table, uint32_t id, CELlog_site site) {
+    if (id >= table->capacity)
+    {
+        uint32_t capacity = table->capacity ? table->capacity : 256;
+        while (capacity <= id) { capacity *= 2; }
+
+        CELlog_site *sites = realloc(table->sites, sizeof(CELlog_site) * capacity);
+        if (!sites) { return false; }
+        memset(sites + table->capacity, 0, sizeof(CELlog_site) * (capacity - table->capacity));
+        table->sites    = sites;
+        table->capacity = capacity;
+    }
+
+    // sites that overflowed the writer's table are defined again, keep the latest
+    free(table->sites[id].file);
+    free(table->sites[id].fmt);
+    table->sites[id] = site;
+    return true;
+}
@@ -0,0 +1,314 @@
+#include "cel.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <dirent.h>
+#endif
+
+#define CELPAK_COPY_BUFFER_SIZE (64 * 1024)
+
+// celpak <input_dir> <output.pak>
+// packs every file under input_dir, named by its '/' separated path relative to input_dir
+
+typedef struct CELpak_file CELpak_file;
+struct CELpak_file {
+    char *name;
+    char *path;
+    uint64_t size;
+    uint64_t offset;
+    uint32_t name_offset;
+};
+
+typedef struct CELpak_file_list CELpak_file_list;
+struct CELpak_file_list {
+    CELpak_file *files;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+Internal bool path_format(char *out, const char *format, const char *a, const char *b);
+Internal bool file_list_add(CELpak_file_list *list, const char *path, const char *name);
+Internal bool directory_walk(CELpak_file_list *list, const char *directory, const char *prefix);
+Internal int file_compare(const void *a, const void *b);
+Internal bool pad_to(FILE *out, uint64_t *position, uint64_t alignment);
+Internal bool archive_write(const CELpak_file_list *list, const char *output_path);
+
+int main(int argc, char **argv) {
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: celpak <input_dir> <output.pak>\n");
+        return 1;
+    }
+
+    CELpak_file_list list = {0};
+    if (!directory_walk(&list, argv[1], "")) { return 1; }
+
+    // sorted input keeps the archive byte for byte reproducible
+    qsort(list.files, list.count, sizeof(CELpak_file), file_compare);
+
+    if (!archive_write(&list, argv[2])) { return 1; }
+
+    // read the archive back through the runtime to make sure every entry resolves
+    CELpak pak;
+    if (!celpak_open(&pak, argv[2]))
+    {
+        fprintf(stderr, "celpak: %s failed validation\n", argv[2]);
+        return 1;
+    }
+    for (uint32_t i = 0; i < list.count; ++i)
+    {
+        CELfile_view view;
+        if (!celpak_find(&pak, list.files[i].name, &view) || view.size != list.files[i].size)
+        {
+            fprintf(stderr, "celpak: %s does not resolve in %s\n", list.files[i].name, argv[2]);
+            celpak_close(&pak);
+            return 1;
+        }
+    }
+    celpak_close(&pak);
+
+    printf("celpak: packed %u files into %s\n", list.count, argv[2]);
+    return 0;
+}
+
+bool path_format(char *out, const char *format, const char *a, const char *b) {
+    // a truncated path would pack the file under the wrong name, so it fails the pack instead
+    int length = snprintf(out, FS_PATH_MAX, format, a, b);
+    if (length < 0 || length >= FS_PATH_MAX)
+    {
+        fprintf(stderr, "celpak: a path under %s is longer than %d characters\n", a, FS_PATH_MAX - 1);
+        return false;
+    }
+    return true;
+}
+
+bool file_list_add(CELpak_file_list *list, const char *path, const char *name) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0)
+    {
+        fprintf(stderr, "celpak: failed to stat %s\n", path);
+        return false;
+    }
+
+    if (list->count == list->capacity)
+    {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 64;
+        CELpak_file *files = realloc(list->files, sizeof(CELpak_file) * capacity);
+        if (!files) { return false; }
+        list->files    = files;
+        list->capacity = capacity;
+    }
+
+    CELpak_file *file = &list->files[list->count++];
+    *file             = (CELpak_file){0};
+    file->path        = strdup(path);
+    file->name        = strdup(name);
+    file->size        = (uint64_t) file_stat.st_size;
+    return file->path && file->name;
+}
+
+#if defined(_WIN32)
+
+bool directory_walk(CELpak_file_list *list, const char *directory, const char *prefix) {
+    char pattern[FS_PATH_MAX];
+    if (!path_format(pattern, "%s\\%s", directory, "*")) { return false; }
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA(pattern, &find_data);
+    if (find == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "celpak: failed to open %s\n", directory);
+        return false;
+    }
+
+    bool ok = true;
+    do
+    {
+        const char *entry = find_data.cFileName;
+        if (strcmp(entry, ".") == 0 || strcmp(entry, "..") == 0) { continue; }
+
+        char path[FS_PATH_MAX];
+        char name[FS_PATH_MAX];
+        if (!path_format(path, "%s\\%s", directory, entry) || !path_format(name, "%s%s", prefix, entry))
+        {
+            ok = false;
+            break;
+        }
+
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            char child_prefix[FS_PATH_MAX];
+            ok = path_format(child_prefix, "%s%s", name, "/") && directory_walk(list, path, child_prefix);
+        }
+        else { ok = file_list_add(list, path, name); }
+    } while (ok && FindNextFileA(find, &find_data));
+
+    FindClose(find);
+    return ok;
+}
+
+#else
+
+bool directory_walk(CELpak_file_list *list, const char *directory, const char *prefix) {
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        fprintf(stderr, "celpak: failed to open %s\n", directory);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)))
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) { continue; }
+
+        char path[FS_PATH_MAX];
+        char name[FS_PATH_MAX];
+        if (!path_format(path, "%s/%s", directory, entry->d_name) || !path_format(name, "%s%s", prefix, entry->d_name))
+        {
+            ok = false;
+            break;
+        }
+
+        struct stat file_stat;
+        if (stat(path, &file_stat) != 0) { continue; }
+
+        if (S_ISDIR(file_stat.st_mode))
+        {
+            char child_prefix[FS_PATH_MAX];
+            ok = path_format(child_prefix, "%s%s", name, "/") && directory_walk(list, path, child_prefix);
+        }
+        else if (S_ISREG(file_stat.st_mode)) { ok = file_list_add(list, path, name); }
+    }
+
+    closedir(dir);
+    return ok;
+}
+
+#endif// _WIN32
+
+int file_compare(const void *a, const void *b) {
+    return strcmp(((const CELpak_file *) a)->name, ((const CELpak_file *) b)->name);
+}
+
+bool pad_to(FILE *out, uint64_t *position, uint64_t alignment) {
+    LocalPersistent const unsigned char zeros[CEL_PAK_ALIGNMENT] = {0};
+
+    uint64_t padding = (alignment - (*position & (alignment - 1))) & (alignment - 1);
+    if (padding && fwrite(zeros, 1, (size_t) padding, out) != padding) { return false; }
+    *position += padding;
+    return true;
+}
+
+bool archive_write(const CELpak_file_list *list, const char *output_path) {
+    // keep the table at most half full so probes stay short
+    uint32_t bucket_count = 16;
+    while (bucket_count < list->count * 2) { bucket_count *= 2; }
+
+    CELpak_entry *buckets = calloc(bucket_count, sizeof(CELpak_entry));
+    if (!buckets) { return false; }
+
+    uint64_t names_size = 0;
+    for (uint32_t i = 0; i < list->count; ++i)
+    {
+        list->files[i].name_offset = (uint32_t) names_size;
+        names_size += strlen(list->files[i].name);
+    }
+
+    uint64_t names_offset = sizeof(CELpak_header) + (uint64_t) bucket_count * sizeof(CELpak_entry);
+    uint64_t data_offset  = (names_offset + names_size + CEL_PAK_ALIGNMENT - 1) & ~(uint64_t) (CEL_PAK_ALIGNMENT - 1);
+    for (uint32_t i = 0; i < list->count; ++i)
+    {
+        CELpak_file *file = &list->files[i];
+        file->offset      = data_offset;
+        data_offset       = (data_offset + file->size + CEL_PAK_ALIGNMENT - 1) & ~(uint64_t) (CEL_PAK_ALIGNMENT - 1);
+
+        uint64_t hash = celpak_hash(file->name);
+        uint32_t mask = bucket_count - 1;
+        uint32_t slot = (uint32_t) hash & mask;
+        while (buckets[slot].hash != 0) { slot = (slot + 1) & mask; }
+
+        buckets[slot] = (CELpak_entry){
+            .hash        = hash,
+            .offset      = file->offset,
+            .size        = file->size,
+            .name_offset = file->name_offset,
+            .name_length = (uint32_t) strlen(file->name),
+        };
+    }
+
+    CELpak_header header = {
+        .magic        = CEL_PAK_MAGIC,
+        .version      = CEL_PAK_VERSION,
+        .entry_count  = list->count,
+        .bucket_count = bucket_count,
+        .names_offset = names_offset,
+        .names_size   = names_size,
+    };
+
+    FILE *out = fopen(output_path, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "celpak: failed to create %s\n", output_path);
+        free(buckets);
+        return false;
+    }
+
+    uint64_t position = 0;
+    bool ok           = fwrite(&header, sizeof(header), 1, out) == 1 &&
+              fwrite(buckets, sizeof(CELpak_entry), bucket_count, out) == bucket_count;
+    position += sizeof(header) + (uint64_t) bucket_count * sizeof(CELpak_entry);
+    free(buckets);
+
+    for (uint32_t i = 0; ok && i < list->count; ++i)
+    {
+        size_t length = strlen(list->files[i].name);
+        ok            = fwrite(list->files[i].name, 1, length, out) == length;
+        position += length;
+    }
+
+    unsigned char *buffer = malloc(CELPAK_COPY_BUFFER_SIZE);
+    ok                    = ok && buffer;
+    for (uint32_t i = 0; ok && i < list->count; ++i)
+    {
+        const CELpak_file *file = &list->files[i];
+        ok                      = pad_to(out, &position, CEL_PAK_ALIGNMENT);
+
+        FILE *in = ok ? fopen(file->path, "rb") : NULL;
+        if (!in)
+        {
+            fprintf(stderr, "celpak: failed to read %s\n", file->path);
+            ok = false;
+            break;
+        }
+
+        uint64_t copied = 0;
+        size_t read_size;
+        while (ok && (read_size = fread(buffer, 1, CELPAK_COPY_BUFFER_SIZE, in)) > 0)
+        {
+            ok = fwrite(buffer, 1, read_size, out) == read_size;
+            copied += read_size;
+        }
+        fclose(in);
+
+        // the table already promised this size, a file that changed underneath us breaks it
+        if (copied != file->size)
+        {
+            fprintf(stderr, "celpak: %s changed while packing\n", file->path);
+            ok = false;
+        }
+        position += copied;
+    }
+    free(buffer);
+
+    if (fclose(out) != 0) { ok = false; }
+    if (!ok) { fprintf(stderr, "celpak: failed to write %s\n", output_path); }
+    return ok;
+}